@@ -0,0 +1,43 @@
+#ifndef AHRS_H
+#define AHRS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AHRS_Q30_ONE        (1 << 30)
+#define AHRS_Q16(x)         ((int32_t)((x) * 65536.0f + 0.5f))
+#define AHRS_KP_Q16         AHRS_Q16(0.5f)
+#define AHRS_KI_Q16         AHRS_Q16(0.01f)
+#define AHRS_DT_MAX_US      100000
+
+// mdps * pi / 180000 in Q16.
+#define AHRS_MDPS_TO_RAD_Q16 74957
+
+/*
+ * Mahony complementary filter in fixed point. The quaternion (w, x, y, z)
+ * rotates the sensor frame into the earth frame and is kept in Q30; gravity
+ * and, when given, the magnetic field pull it back against gyro drift with
+ * a PI loop. Without a magnetometer yaw is gyro-only and will drift.
+ */
+typedef struct {
+    int32_t q[4];
+    int32_t integral[3];
+    int32_t kp_q16;
+    int32_t ki_q16;
+    int64_t last_us;
+} ahrs_t;
+
+void ahrs_init(ahrs_t *f, int32_t kp_q16, int32_t ki_q16);
+void ahrs_update(ahrs_t *f, int64_t t_us, const int32_t gyro_mdps[3],
+                 const int32_t accel_mg[3], const int16_t *mag);
+void ahrs_get_euler(const ahrs_t *f, int16_t euler_cdeg[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
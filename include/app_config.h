@@ -20,13 +20,19 @@ extern "C" {
 #define BACK_RIGHT_SCK_PIN  GPIO_NUM_38
 #define BACK_RIGHT_DT_PIN   GPIO_NUM_37
 
+#define LOADCELL_BACKEND    LC_BACKEND_DEDIC_GPIO
+#define LOADCELL_SPS        HX711_SPS_LOW
+#define LOADCELL_GAIN       HX711_GAIN_A_128
+
 #define MPU_SPI_HOST        SPI2_HOST
 #define MPU_PIN_NUM_MISO    GPIO_NUM_13
 #define MPU_PIN_NUM_MOSI    GPIO_NUM_11
 #define MPU_PIN_NUM_CLK     GPIO_NUM_12
 #define MPU_PIN_NUM_CS      GPIO_NUM_10
+#define MPU_PIN_NUM_INT     GPIO_NUM_14
 
 #define PRESENCE_THRESHOLD_KG   5
+#define PRESENCE_EXIT_THRESHOLD_KG 3
 #define PRESENCE_DEBOUNCE_COUNT 3
 
 void Error_Handler(void);
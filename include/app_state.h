@@ -0,0 +1,22 @@
+#ifndef APP_STATE_H
+#define APP_STATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_record.h"
+
+void app_state_publish_sample(const sensor_record_t *record);
+void app_state_get_latest(sensor_record_t *record);
+void app_state_set_presence(bool present);
+bool app_state_person_present(void);
+uint32_t app_state_read_retries(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
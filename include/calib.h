@@ -0,0 +1,52 @@
+#ifndef CALIB_H
+#define CALIB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "dsp_filter.h"
+#include "drv_loadcell.h"
+
+#define CALIB_NVS_NAMESPACE   "calib"
+#define CALIB_NVS_KEY         "blob"
+#define CALIB_VERSION         1
+
+#define CALIB_DRIFT_ALPHA_Q15 DSP_Q15(0.002f)
+#define CALIB_DRIFT_WINDOW    20000
+#define CALIB_DRIFT_SAVE_MIN  500
+
+typedef struct {
+    uint16_t version;
+    uint16_t size;
+    int32_t offset[LC_MAX_CHANNELS];
+    float scale[LC_MAX_CHANNELS];
+    int16_t temp_coef_ppm[LC_MAX_CHANNELS];
+    int16_t accel_bias[3];
+    int16_t gyro_bias[3];
+    uint32_t crc;
+} calib_blob_t;
+
+// Tracks slow zero drift of one cell while the bed is empty. Readings that
+// stray more than CALIB_DRIFT_WINDOW counts from the offset are treated as
+// real load and ignored.
+typedef struct {
+    dsp_ema_t ema;
+    bool active;
+} calib_drift_t;
+
+void calib_defaults(calib_blob_t *cal);
+esp_err_t calib_load(calib_blob_t *cal);
+esp_err_t calib_save(calib_blob_t *cal);
+
+void calib_drift_init(calib_drift_t *d);
+int32_t calib_drift_update(calib_drift_t *d, int32_t raw, int32_t offset, bool empty);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define CMD_MAX_ARGS        2
+#define CMD_ARENA_SIZE      256
+#define CMD_QUEUE_LEN       8
+#define CMD_TASK_STACK      3072
+#define CMD_TASK_PRIO       4
+#define CMD_TASK_CORE       1
+
+typedef enum {
+    CMD_GET_STATUS = 0,
+    CMD_RESET_FALL,
+    CMD_SET_RATE,
+    CMD_SET_SCALE,
+    CMD_TARE,
+    CMD_SET_TEMPCO,
+    CMD_CAL_IMU,
+    CMD_CAL_SAVE,
+    CMD_COUNT
+} cmd_id_t;
+
+typedef union {
+    int32_t i;
+    float f;
+} cmd_arg_t;
+
+typedef struct {
+    cmd_id_t id;
+    uint8_t argc;
+    cmd_arg_t args[CMD_MAX_ARGS];
+} command_t;
+
+typedef esp_err_t (*command_handler_t)(const command_t *cmd);
+
+typedef struct {
+    uint32_t received;
+    uint32_t executed;
+    uint32_t parse_errors;
+    uint32_t oversize;
+    uint32_t queue_full;
+} command_stats_t;
+
+esp_err_t command_start(void);
+void command_register(cmd_id_t id, command_handler_t handler);
+esp_err_t command_parse(const char *data, size_t len, command_t *cmd);
+esp_err_t command_submit(const char *data, size_t len);
+esp_err_t command_feed(const char *data, int len, int offset, int total);
+esp_err_t command_post(const command_t *cmd);
+const char *command_name(cmd_id_t id);
+void command_get_stats(command_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
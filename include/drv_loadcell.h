@@ -10,26 +10,79 @@ extern "C" {
 #include "driver/gpio.h"
 #include "esp_err.h"
 #include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
-#define LC_TIMEOUT_US   1000
 #define LC_ERROR_CODE   -2147483648
 #define HX711_SIGN_MASK 0xFF000000
 
+#define LC_MAX_CHANNELS     4
+#define LC_ACQ_TASK_STACK   2048
+#define LC_ACQ_TASK_PRIO    6
+#define LC_ACQ_TASK_CORE    0
+#define LC_ALIGN_WINDOW_PCT 110
+#define LC_READY_TIMEOUT_PCT 150
+#define LC_SETTLE_PERIODS   4
+#define LC_STALE_PERIODS    (LC_SETTLE_PERIODS + 2)
+#define LC_NOTIFY_POWER     (1UL << 31)
+
+#define HX711_DATA_BITS         24
+#define HX711_MAX_PULSES        27
+#define HX711_SPS_LOW           10
+#define HX711_SPS_HIGH          80
+#define LC_DEDIC_HALF_PERIOD_NS 500
+
+typedef enum {
+    LC_BACKEND_GPIO = 0,
+    LC_BACKEND_DEDIC_GPIO,
+} loadcell_backend_t;
+
+// Pulses per frame: the ones past the 24 data bits select the channel and
+// gain of the *next* conversion.
+typedef enum {
+    HX711_GAIN_A_128 = 25,
+    HX711_GAIN_B_32  = 26,
+    HX711_GAIN_A_64  = 27,
+} hx711_gain_t;
+
 typedef struct {
     gpio_num_t dout_pin;
     gpio_num_t sck_pin;
     bool is_initialized;
+    loadcell_backend_t backend;
+    uint8_t bundle_ch;
+    hx711_gain_t gain;
+    uint8_t sps;
+    uint32_t period_us;
+    uint32_t timeouts;
     int32_t offset;
     float scale;
+    int32_t weight_per_count_q16;
 } loadcell_t;
 
+typedef struct {
+    int64_t timestamp_us;
+    uint8_t channel;
+    int32_t raw;
+} loadcell_sample_t;
+
 esp_err_t loadcell_init(loadcell_t *sensor, gpio_num_t dout_pin, gpio_num_t sck_pin);
+esp_err_t loadcell_init_backend(loadcell_t *const sensors[], uint8_t count, loadcell_backend_t backend);
+esp_err_t loadcell_configure(loadcell_t *sensor, hx711_gain_t gain, uint8_t sps);
 int32_t loadcell_read_raw(loadcell_t *sensor);
+esp_err_t loadcell_read_raw_multi(loadcell_t *const sensors[], uint8_t count, int32_t raw_out[]);
 int32_t loadcell_read_average(loadcell_t *sensor, uint8_t times);
-void loadcell_tare(loadcell_t *sensor);
-int16_t loadcell_get_weight(loadcell_t *sensor);
+esp_err_t loadcell_tare(loadcell_t *sensor);
+esp_err_t loadcell_get_weight(loadcell_t *sensor, int16_t *weight);
+int16_t loadcell_raw_to_weight(const loadcell_t *sensor, int32_t raw);
 void loadcell_set_scale(loadcell_t *sensor, float scale_value);
 
+esp_err_t loadcell_start_async(loadcell_t *const sensors[], uint8_t count, QueueHandle_t queue);
+void loadcell_stop_async(void);
+uint32_t loadcell_async_dropped(void);
+void loadcell_set_power(bool on);
+bool loadcell_is_powered(void);
+
 #ifdef __cplusplus
 }
 #endif
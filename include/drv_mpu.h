@@ -4,30 +4,128 @@
 #include "app_config.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "dsp_filter.h"
+#include "spsc_ring.h"
 
 #define ACCEL_SENSITIVITY 16384
 #define GYRO_SENSITIVITY  131
-#define BUFFER_SIZE       14
+#define AK8963_DATA_LEN   7
+#define MPU_FRAME_BASE    14
+#define MPU_FRAME_MAG     (MPU_FRAME_BASE + AK8963_DATA_LEN)
+#define BUFFER_SIZE       MPU_FRAME_MAG
 
+#define MPU_FIFO_SIZE          512
+#define MPU_FIFO_BURST_MAX     MPU_FIFO_SIZE
+#define MPU_FIFO_WATERMARK     10
+#define MPU_RING_LEN           64
+#define MPU_FIFO_TASK_STACK    3072
+#define MPU_FIFO_TASK_PRIO     6
+#define MPU_FIFO_TASK_CORE     0
+// spi_master bounces a DMA transfer through a buffer it allocates unless the
+// command byte plus payload is a whole number of words.
+#define MPU_DMA_LEN(n)         (((n) + 1 + 3) & ~3)
+#define MPU_DMA_BUF_SIZE       MPU_DMA_LEN(MPU_FIFO_BURST_MAX)
+#define MPU_ASYNC_BUF_SIZE     MPU_DMA_LEN(BUFFER_SIZE)
+
+#define MPU_SPI_CLOCK_CONFIG_HZ (1 * 1000 * 1000)
+#define MPU_SPI_CLOCK_READ_HZ   (20 * 1000 * 1000)
+#define MPU_SPI_QUEUE_SIZE      2
+
+/*
+ * One sample as laid out from ACCEL_XOUT_H: accel, temperature, gyro and,
+ * when the AK8963 is present, its data as read by the I2C master. The FIFO
+ * is set up to record the same fields in the same order, so both paths share
+ * one decoder. mag is sensitivity-adjusted and rotated into the accel frame.
+ */
 typedef struct {
-    spi_device_handle_t spi_handle;
+    int64_t timestamp_us;
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t mag[3];
+    int16_t temp;
+    bool mag_valid;
+} mpu_sample_t;
+
+typedef void (*mpu_motion_cb_t)(void *ctx, BaseType_t *woken);
+
+typedef enum {
+    MPU_WOM_NONE = 0,
+    MPU_WOM_ENTER,
+    MPU_WOM_EXIT,
+} mpu_wom_request_t;
+
+typedef struct {
+    spi_device_handle_t spi_config;
+    spi_device_handle_t spi_read;
+    spi_host_device_t host;
     gpio_num_t cs_pin;
+    bool fast_reads;
+
+    uint8_t *dma_tx;
+    uint8_t *dma_rx;
+    uint32_t dma_allocs;
+
+    uint8_t *async_buf;
+    spi_transaction_t async_trans[MPU_SPI_QUEUE_SIZE];
+    uint8_t async_slot;
+    uint8_t async_pending;
+    int64_t async_time_us[MPU_SPI_QUEUE_SIZE];
 
     int16_t accel_raw[3];
     int16_t gyro_raw[3];
+    int16_t mag_raw[3];
+    int16_t temp_raw;
+    int16_t accel_bias[3];
+    int16_t gyro_bias[3];
 
     int32_t accel_mg[3];
+    int32_t gyro_mdps[3];
+    int32_t temp_cdeg;
     int32_t accel_ma[3];
     int32_t gyro_ma[3];
+    dsp_median_t accel_median[3];
+    dsp_ema_t accel_ema[3];
     bool data_ready;
+    bool mag_valid;
+    int64_t sample_time_us;
+    mpu_sample_t poll_sample;
 
     uint16_t accel_sens;
     uint16_t gyro_sens;
+
+    bool mag_present;
+    uint8_t mag_asa[3];
+    uint8_t frame_size;
+    uint8_t fifo_en;
+    uint8_t user_ctrl;
+
+    gpio_num_t int_pin;
+    TaskHandle_t fifo_task;
+    volatile uint32_t drdy_count;
+    volatile int64_t drdy_time_us;
+    uint32_t fifo_overflows;
+    uint8_t fifo_carry[MPU_FRAME_MAG];
+    uint8_t fifo_carry_len;
+
+    uint8_t wom_request;
+    volatile bool wom_active;
+    mpu_motion_cb_t motion_cb;
+    void *motion_ctx;
+    volatile int64_t motion_time_us;
+
+    spsc_ring_t ring;
+    mpu_sample_t ring_buf[MPU_RING_LEN];
 } MPU9250_t;
 
 #define MPU_TIME_OUT           100
 
 #define MPU_REG_PWR_MGMT_1    0x6B
+#define MPU_REG_PWR_MGMT_2    0x6C
+#define MPU_REG_LP_ACCEL_ODR  0x1E
+#define MPU_REG_WOM_THR       0x1F
+#define MPU_REG_MOT_DETECT_CTRL 0x69
 #define MPU_REG_ACCEL_CONFIG_2 0x1D
 #define MPU_REG_ACCEL_CONFIG   0x1C
 #define MPU_REG_GYRO_CONFIG    0x1B
@@ -35,6 +133,34 @@ typedef struct {
 #define MPU_REG_WHO_AM_I       0x75
 #define MPU_REG_SMPLRT_DIV     0x19
 #define MPU_REG_ACCEL_XOUT_H   0x3B
+#define MPU_REG_FIFO_EN        0x23
+#define MPU_REG_INT_PIN_CFG    0x37
+#define MPU_REG_INT_ENABLE     0x38
+#define MPU_REG_INT_STATUS     0x3A
+#define MPU_REG_USER_CTRL      0x6A
+#define MPU_REG_FIFO_COUNTH    0x72
+#define MPU_REG_FIFO_R_W       0x74
+#define MPU_REG_EXT_SENS_DATA  0x49
+#define MPU_REG_EXT_SENS_LAST  0x60
+#define MPU_REG_I2C_MST_CTRL   0x24
+#define MPU_REG_I2C_SLV0_ADDR  0x25
+#define MPU_REG_I2C_SLV0_REG   0x26
+#define MPU_REG_I2C_SLV0_CTRL  0x27
+#define MPU_REG_I2C_SLV0_DO    0x63
+
+#define AK8963_I2C_ADDR        0x0C
+#define AK8963_REG_WIA         0x00
+#define AK8963_REG_HXL         0x03
+#define AK8963_REG_CNTL1       0x0A
+#define AK8963_REG_CNTL2       0x0B
+#define AK8963_REG_ASAX        0x10
+#define AK8963_WIA_VALUE       0x48
+#define AK8963_CNTL1_POWER_DOWN 0x00
+#define AK8963_CNTL1_FUSE_ROM  0x0F
+#define AK8963_CNTL1_CONT_100HZ_16BIT 0x16
+#define AK8963_CNTL2_SRST      0x01
+#define AK8963_ST2_HOFL        0x08
+#define AK8963_SETTLE_MS       20
 
 #define MPU_WHO_AM_I_VALUE     0x70
 #define MPU_READ               0x80
@@ -44,11 +170,53 @@ typedef struct {
 #define CONFIG_GYRO            0x00
 #define BANDWIDTH              0x06
 #define SMPLRT_DIV             0x09
-#define ALPHA                  0.1f
+#define ALPHA_Q15              DSP_Q15(0.1f)
+#define MPU_MEDIAN_N           3
 
+#define CONFIG_FIFO_MODE_STOP  0x40
+#define FIFO_EN_ACCEL_GYRO     0x78
+#define FIFO_EN_TEMP           0x80
+#define FIFO_EN_SLV0           0x01
+#define USER_CTRL_FIFO_EN      0x40
+#define USER_CTRL_I2C_MST_EN   0x20
+#define USER_CTRL_I2C_IF_DIS   0x10
+#define USER_CTRL_FIFO_RST     0x04
+#define INT_ENABLE_RAW_RDY     0x01
+#define I2C_MST_WAIT_FOR_ES    0x40
+#define I2C_MST_CLK_400KHZ     0x0D
+#define I2C_SLV_EN             0x80
+#define I2C_SLV_READ           0x80
+#define INT_STATUS_FIFO_OFLOW  0x10
+#define INT_ENABLE_WOM         0x40
+#define PWR_CYCLE              0x20
+#define PWR_MGMT_2_DIS_GYRO    0x07
+#define ACCEL_CONFIG_2_LP      0x09
+#define MOT_DETECT_INTEL       0xC0
+
+#define MPU_WOM_THRESHOLD_MG   40
+#define MPU_WOM_LP_ODR         0x06
+
+#define MPU_SAMPLE_PERIOD_US   ((SMPLRT_DIV + 1) * 1000)
+#define MPU_TEMP_SENS_X100     33387
+#define MPU_TEMP_OFFSET_CDEG   2100
+
+esp_err_t mpu_attach(MPU9250_t *dev, spi_host_device_t host, gpio_num_t cs_pin);
 esp_err_t mpu_init(MPU9250_t *dev);
+void mpu_deinit(MPU9250_t *dev);
+uint32_t mpu_dma_allocs(const MPU9250_t *dev);
+size_t mpu_dma_heap_watermark(void);
 esp_err_t spi_read_byte(MPU9250_t *dev, uint8_t regAddress, uint8_t *data);
 esp_err_t mpu_read_all(MPU9250_t *dev);
+esp_err_t mpu_read_async_start(MPU9250_t *dev);
+esp_err_t mpu_read_async_finish(MPU9250_t *dev, TickType_t wait);
 void moving_average(MPU9250_t *dev);
+void mpu_set_bias(MPU9250_t *dev, const int16_t accel_bias[3], const int16_t gyro_bias[3]);
+
+esp_err_t mpu_fifo_start(MPU9250_t *dev, gpio_num_t int_pin);
+void mpu_fifo_stop(MPU9250_t *dev);
+bool mpu_fifo_pop(MPU9250_t *dev, mpu_sample_t *sample);
+void mpu_apply_sample(MPU9250_t *dev, const mpu_sample_t *sample);
+void mpu_set_motion_cb(MPU9250_t *dev, mpu_motion_cb_t cb, void *ctx);
+esp_err_t mpu_set_wake_on_motion(MPU9250_t *dev, bool enable);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,29 @@
+#ifndef DSP_FFT_H
+#define DSP_FFT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DSP_FFT_N       256
+#define DSP_FFT_LOG2    8
+#define DSP_FFT_BINS    (DSP_FFT_N / 2 + 1)
+
+typedef struct {
+    int16_t re;
+    int16_t im;
+} dsp_cplx_q15_t;
+
+extern const int16_t dsp_fft_sin_q15[DSP_FFT_N / 4 + 1];
+
+// Real FFT of DSP_FFT_N Q15 samples packed in pairs (re = x[2n], im = x[2n+1]).
+// data is transformed in place as scratch; out receives bins 0..N/2 scaled by 1/N.
+void dsp_rfft_q15(dsp_cplx_q15_t *data, dsp_cplx_q15_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef DSP_FILTER_H
+#define DSP_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DSP_Q15_ONE        (1 << 15)
+#define DSP_Q30_SHIFT      30
+#define DSP_EMA_FRAC_BITS  16
+#define DSP_MEDIAN_MAX     5
+
+#define DSP_Q15(x)         ((int32_t)((x) * DSP_Q15_ONE + 0.5f))
+
+typedef enum {
+    DSP_LPF_FS_DIV10 = 0,
+    DSP_LPF_FS_DIV20,
+    DSP_LPF_COUNT
+} dsp_lpf_id_t;
+
+typedef struct {
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+} dsp_biquad_coef_t;
+
+typedef struct {
+    int32_t alpha_q15;
+    int64_t state;
+} dsp_ema_t;
+
+typedef struct {
+    const dsp_biquad_coef_t *coef;
+    int32_t x1, x2;
+    int32_t y1, y2;
+    int64_t err;
+} dsp_biquad_t;
+
+typedef struct {
+    int32_t window[DSP_MEDIAN_MAX];
+    uint8_t n;
+    uint8_t pos;
+} dsp_median_t;
+
+typedef struct {
+    dsp_median_t median;
+    dsp_biquad_t lpf;
+} dsp_channel_t;
+
+extern const dsp_biquad_coef_t dsp_lpf_table[DSP_LPF_COUNT];
+
+void dsp_ema_init(dsp_ema_t *f, int32_t alpha_q15, int32_t initial);
+int32_t dsp_ema_update(dsp_ema_t *f, int32_t x);
+
+void dsp_biquad_init(dsp_biquad_t *f, dsp_lpf_id_t id, int32_t initial);
+int32_t dsp_biquad_update(dsp_biquad_t *f, int32_t x);
+
+void dsp_median_init(dsp_median_t *f, uint8_t n, int32_t initial);
+int32_t dsp_median_update(dsp_median_t *f, int32_t x);
+
+void dsp_channel_init(dsp_channel_t *ch, uint8_t median_n, dsp_lpf_id_t id, int32_t initial);
+int32_t dsp_channel_update(dsp_channel_t *ch, int32_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef EPOCH_FEATURES_H
+#define EPOCH_FEATURES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_record.h"
+#include "dsp_fft.h"
+
+#define EPOCH_DURATION_US   30000000LL
+#define EPOCH_BUCKET_US     200000
+#define EPOCH_MAX_BUCKETS   (EPOCH_DURATION_US / EPOCH_BUCKET_US)
+#define EPOCH_ACTIVITY_MG   20
+#define EPOCH_RESP_LO_MHZ   100
+#define EPOCH_RESP_HI_MHZ   500
+
+typedef struct {
+    int64_t start_us;
+    uint32_t duration_ms;
+    uint32_t samples;
+    uint16_t activity_count;
+    uint8_t presence_pct;
+    uint32_t movement_energy;
+    int32_t weight_mean;
+    uint32_t weight_var;
+    uint32_t resp_power;
+    uint16_t resp_ratio_permille;
+    uint16_t resp_rate_bpm_x10;
+} epoch_features_t;
+
+// Total weight is averaged into EPOCH_BUCKET_US buckets, giving a fixed-rate
+// signal for the respiration spectrum regardless of the sensor rate.
+typedef struct {
+    int64_t start_us;
+    int64_t last_us;
+    int32_t signal[EPOCH_MAX_BUCKETS];
+    uint16_t n_signal;
+    int64_t bucket_sum;
+    uint16_t bucket_n;
+
+    int32_t prev_accel[3];
+    uint32_t samples;
+    uint32_t present;
+    uint32_t activity;
+    uint64_t energy;
+    int64_t w_sum;
+    int64_t w_sum_sq;
+} epoch_t;
+
+void epoch_init(epoch_t *ep);
+bool epoch_update(epoch_t *ep, const sensor_record_t *rec, bool present, epoch_features_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
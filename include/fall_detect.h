@@ -0,0 +1,75 @@
+#ifndef FALL_DETECT_H
+#define FALL_DETECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "dsp_filter.h"
+
+// The accelerometer runs at +-2 g full scale, so the impact threshold sits
+// just under saturation.
+#define FALL_IMPACT_MG          1800
+#define FALL_WINDOW_US          1500000
+#define FALL_LOAD_LOSS_PCT      40
+#define FALL_EDGE_Q15           22938
+#define FALL_EDGE_VEL_Q15       400
+#define FALL_BASELINE_ALPHA_Q15 DSP_Q15(0.02f)
+#define FALL_VEL_ALPHA_Q15      DSP_Q15(0.25f)
+
+typedef enum {
+    FALL_ALERT_FALL = 0,
+    FALL_ALERT_EDGE_EXIT
+} fall_alert_id_t;
+
+typedef struct {
+    fall_alert_id_t id;
+    int64_t timestamp_us;
+    int64_t impact_us;
+    int32_t peak_mg;
+    int16_t cog_x;
+    int16_t cog_y;
+} fall_alert_t;
+
+typedef void (*fall_alert_cb_t)(const fall_alert_t *alert, void *ctx);
+
+typedef struct {
+    int32_t min_total;
+
+    int64_t impact_us;
+    int32_t peak_mg;
+
+    dsp_ema_t baseline;
+    bool baseline_valid;
+    int64_t load_loss_us;
+
+    bool cog_valid;
+    int16_t cog_x;
+    int16_t cog_y;
+    dsp_ema_t vel_x;
+    dsp_ema_t vel_y;
+    int64_t edge_us;
+    bool edge_armed;
+
+    bool latched;
+    bool reset_request;
+    uint32_t alerts;
+
+    fall_alert_cb_t cb;
+    void *ctx;
+} fall_detector_t;
+
+void fall_init(fall_detector_t *fd, int32_t min_total, fall_alert_cb_t cb, void *ctx);
+void fall_update_imu(fall_detector_t *fd, int64_t timestamp_us, const int32_t accel_mg[3]);
+void fall_update_load(fall_detector_t *fd, int64_t timestamp_us, const int16_t weight[4]);
+void fall_reset(fall_detector_t *fd);
+bool fall_is_latched(const fall_detector_t *fd);
+const char *fall_alert_name(fall_alert_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef JOB_SCHED_H
+#define JOB_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SCHED_MAX_JOBS  4
+
+typedef void (*sched_fn_t)(void *arg);
+
+typedef struct {
+    const char *name;
+    sched_fn_t fn;
+    void *arg;
+    volatile uint32_t period_us;
+    int64_t next_us;
+
+    uint32_t runs;
+    uint32_t missed;
+    uint32_t exec_last_us;
+    uint32_t exec_max_us;
+    uint64_t exec_total_us;
+    int32_t jitter_max_us;
+} sched_job_t;
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t runs;
+    uint32_t missed;
+    uint32_t exec_last_us;
+    uint32_t exec_max_us;
+    uint32_t exec_avg_us;
+    int32_t jitter_max_us;
+} sched_stats_t;
+
+typedef struct {
+    sched_job_t jobs[SCHED_MAX_JOBS];
+    uint8_t count;
+    esp_timer_handle_t timer;
+    TaskHandle_t task;
+    uint32_t released;
+} sched_t;
+
+void sched_init(sched_t *s);
+int sched_add(sched_t *s, const char *name, sched_fn_t fn, void *arg, uint32_t period_us);
+void sched_set_period(sched_t *s, int job, uint32_t period_us);
+uint32_t sched_get_period(const sched_t *s, int job);
+void sched_get_stats(const sched_t *s, int job, sched_stats_t *stats);
+void sched_release(sched_t *s, int job);
+void sched_release_from_isr(sched_t *s, int job, BaseType_t *woken);
+void sched_run(sched_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
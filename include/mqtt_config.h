@@ -12,8 +12,24 @@
 
 #define TOPIC_PUB_DATA       "smartcrib/data"
 #define TOPIC_SUB_CMD        "smartcrib/cmd"
+#define TOPIC_PUB_EVENT      "smartcrib/event"
+#define TOPIC_PUB_EPOCH      "smartcrib/epoch"
+#define TOPIC_PUB_STATUS     "smartcrib/status"
 
-#define STRING_LEN 128
+#define MQTT_KEEPALIVE_S     60
+#define MQTT_BACKOFF_MIN_MS  500
+#define MQTT_BACKOFF_MAX_MS  60000
+#define MQTT_OUTBOX_LIMIT    (16 * 1024)
+
+typedef struct {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t resumed_sessions;
+    uint32_t backoff_ms;
+    uint32_t first_connect_ms;
+    uint32_t first_publish_ms;
+    uint32_t last_reconnect_ms;
+} mqtt_stats_t;
 
 extern const uint8_t root_ca_pem_start[] asm("_binary_root_ca_pem_start");
 extern const uint8_t root_ca_pem_end[]   asm("_binary_root_ca_pem_end");
@@ -21,5 +37,11 @@ extern const uint8_t root_ca_pem_end[]   asm("_binary_root_ca_pem_end");
 esp_err_t mqtt_init(void);
 esp_err_t mqtt_start(void);
 esp_err_t mqtt_stop(void);
+bool mqtt_is_connected(void);
+esp_err_t mqtt_publish_telemetry(const uint8_t *data, size_t len);
+esp_err_t mqtt_publish_event(const char *payload, size_t len);
+esp_err_t mqtt_publish_epoch(const char *payload, size_t len);
+esp_err_t mqtt_publish_status(const char *payload, size_t len);
+void mqtt_get_stats(mqtt_stats_t *stats);
 
 #endif
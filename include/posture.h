@@ -0,0 +1,69 @@
+#ifndef POSTURE_H
+#define POSTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_record.h"
+
+#define POSTURE_WINDOW        16
+#define POSTURE_SHIFT_Q15     6554
+
+// Channel order matches sensor_record_t.weight: FL, FR, BL, BR.
+// CoG is reported in Q15 with +x towards the right side and +y towards the head.
+typedef enum {
+    POSTURE_EVT_ENTER = 0,
+    POSTURE_EVT_EXIT,
+    POSTURE_EVT_SHIFT
+} posture_event_id_t;
+
+typedef struct {
+    posture_event_id_t id;
+    int64_t timestamp_us;
+    int32_t total;
+    int16_t cog_x;
+    int16_t cog_y;
+} posture_event_t;
+
+typedef void (*posture_event_cb_t)(const posture_event_t *evt, void *ctx);
+
+typedef struct {
+    int32_t window[POSTURE_WINDOW];
+    uint8_t pos;
+    uint8_t fill;
+    int64_t sum;
+    int64_t sum_sq;
+
+    int32_t total;
+    int32_t mean;
+    int32_t trend;
+    uint32_t variance;
+    int16_t cog_x;
+    int16_t cog_y;
+    int16_t ref_x;
+    int16_t ref_y;
+
+    int32_t enter_threshold;
+    int32_t exit_threshold;
+    uint8_t confirm;
+    uint8_t counter;
+    bool present;
+
+    posture_event_cb_t cb;
+    void *ctx;
+} posture_engine_t;
+
+void posture_init(posture_engine_t *pe, int32_t enter_threshold, int32_t exit_threshold,
+                  uint8_t confirm, posture_event_cb_t cb, void *ctx);
+void posture_update(posture_engine_t *pe, const sensor_record_t *rec);
+bool posture_cog(const int16_t *weight, int16_t *x, int16_t *y);
+const char *posture_event_name(posture_event_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
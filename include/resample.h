@@ -0,0 +1,41 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RESAMPLE_MAX_DIM    3
+#define RESAMPLE_HISTORY    32
+
+typedef struct {
+    int64_t t_us;
+    int32_t v[RESAMPLE_MAX_DIM];
+} resample_point_t;
+
+/*
+ * Short history of one timestamped stream. Readers ask for the value at an
+ * arbitrary time and get it linearly interpolated between the two samples
+ * around it, so streams with unrelated rates and phases can be read on a
+ * common timebase. Timestamps must be pushed in increasing order.
+ */
+typedef struct {
+    resample_point_t hist[RESAMPLE_HISTORY];
+    uint8_t dim;
+    uint8_t head;
+    uint8_t count;
+} resample_stream_t;
+
+void resample_init(resample_stream_t *s, uint8_t dim);
+void resample_push(resample_stream_t *s, int64_t t_us, const int32_t *v);
+bool resample_at(const resample_stream_t *s, int64_t t_us, int32_t *out);
+bool resample_latest(const resample_stream_t *s, int64_t *t_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
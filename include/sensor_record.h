@@ -0,0 +1,23 @@
+#ifndef SENSOR_RECORD_H
+#define SENSOR_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SENSOR_RECORD_CHANNELS 4
+
+typedef struct {
+    int64_t timestamp_us;
+    int16_t weight[SENSOR_RECORD_CHANNELS];
+    int32_t accel_filtered[3];
+} sensor_record_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
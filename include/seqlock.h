@@ -0,0 +1,23 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    uint32_t seq;
+    uint32_t retries;
+} seqlock_t;
+
+void seqlock_write(seqlock_t *lock, void *dst, const void *src, size_t len);
+void seqlock_read(seqlock_t *lock, void *dst, const void *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
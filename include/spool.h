@@ -0,0 +1,38 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define SPOOL_PARTITION_LABEL   "spiffs"
+#define SPOOL_SECTOR_SIZE       4096
+#define SPOOL_SECTOR_MAGIC      0x4C505331
+#define SPOOL_MAX_SECTORS       128
+#define SPOOL_DRAIN_PER_PERIOD  10
+
+typedef struct {
+    uint32_t appended;
+    uint32_t drained;
+    uint32_t corrupt;
+    uint32_t dropped_sectors;
+    uint32_t max_erase_count;
+} spool_stats_t;
+
+esp_err_t spool_init(void);
+esp_err_t spool_append(const uint8_t *data, size_t len);
+esp_err_t spool_peek(uint8_t *buf, size_t buf_len, size_t *len);
+esp_err_t spool_consume(void);
+bool spool_is_empty(void);
+void spool_get_stats(spool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
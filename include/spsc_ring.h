@@ -0,0 +1,30 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t *storage;
+    uint32_t elem_size;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+} spsc_ring_t;
+
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, uint32_t elem_size, uint32_t capacity);
+bool spsc_ring_push(spsc_ring_t *ring, const void *elem);
+bool spsc_ring_pop(spsc_ring_t *ring, void *elem);
+uint32_t spsc_ring_count(const spsc_ring_t *ring);
+void spsc_ring_reset(spsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
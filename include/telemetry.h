@@ -0,0 +1,44 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sensor_record.h"
+
+#define TELEMETRY_MAGIC          0xB5
+#define TELEMETRY_VERSION        1
+#define TELEMETRY_HEADER_SIZE    14
+#define TELEMETRY_BATCH_SAMPLES  50
+#define TELEMETRY_SAMPLE_MAX     (10 + SENSOR_RECORD_CHANNELS * 3 + 3 * 5)
+#define TELEMETRY_MAX_FRAME      (TELEMETRY_HEADER_SIZE + TELEMETRY_BATCH_SAMPLES * TELEMETRY_SAMPLE_MAX)
+
+/*
+ * Frame layout (little endian):
+ *   u8 magic, u8 version, u16 seq, u8 count, u8 flags, u64 base timestamp (us)
+ *   per sample:
+ *     varint  (timestamp delta << 1) | person_present
+ *     zigzag varint deltas of weight[4] then accel_filtered[3] vs previous sample
+ */
+typedef struct {
+    uint8_t buf[TELEMETRY_MAX_FRAME];
+    size_t len;
+    uint8_t count;
+    uint16_t seq;
+    sensor_record_t prev;
+} telemetry_batch_t;
+
+void telemetry_batch_init(telemetry_batch_t *batch);
+bool telemetry_batch_add(telemetry_batch_t *batch, const sensor_record_t *record, bool present);
+size_t telemetry_batch_finish(telemetry_batch_t *batch, const uint8_t **frame);
+void telemetry_batch_reset(telemetry_batch_t *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
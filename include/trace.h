@@ -0,0 +1,82 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#define TRACE_HIST_SUB_BITS  2
+#define TRACE_HIST_BUCKETS   (32 << TRACE_HIST_SUB_BITS)
+#define TRACE_MAX_TASKS      8
+#define TRACE_REPORT_MAX     768
+
+typedef enum {
+    TRACE_LC_FRAME = 0,
+    TRACE_LC_CRITICAL,
+    TRACE_MPU_READ,
+    TRACE_MPU_FIFO_DRAIN,
+    TRACE_MQTT_ENQUEUE,
+    TRACE_SPOOL_APPEND,
+    TRACE_PROCESS_RECORD,
+    TRACE_PROBE_COUNT
+} trace_probe_t;
+
+#if TRACE_ENABLED
+
+typedef struct {
+    trace_probe_t probe;
+    uint32_t start;
+} trace_scope_t;
+
+void trace_record(trace_probe_t probe, uint32_t cycles);
+void trace_register_task(TaskHandle_t task);
+size_t trace_report(char *buf, size_t len);
+
+static inline uint32_t trace_begin(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static inline void trace_end(trace_probe_t probe, uint32_t start)
+{
+    trace_record(probe, esp_cpu_get_cycle_count() - start);
+}
+
+static inline void trace_scope_exit(trace_scope_t *scope)
+{
+    trace_end(scope->probe, scope->start);
+}
+
+#define TRACE_CAT_(a, b)       a##b
+#define TRACE_CAT(a, b)        TRACE_CAT_(a, b)
+#define TRACE_SCOPE(probe)     trace_scope_t TRACE_CAT(trace_scope_, __LINE__) \
+                                   __attribute__((cleanup(trace_scope_exit))) = { (probe), trace_begin() }
+#define TRACE_BEGIN(var)       uint32_t var = trace_begin()
+#define TRACE_END(probe, var)  trace_end((probe), (var))
+
+#else
+
+#define TRACE_SCOPE(probe)     ((void)0)
+#define TRACE_BEGIN(var)       ((void)0)
+#define TRACE_END(probe, var)  ((void)0)
+
+static inline void trace_register_task(TaskHandle_t task) { (void)task; }
+static inline size_t trace_report(char *buf, size_t len) { if (len) buf[0] = '\0'; return 0; }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,23 +14,46 @@ extern "C" {
 #include "esp_event.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
+#include "nvs.h"
+#include "esp_timer.h"
 #include "wifi_provisioning/manager.h"
 #include "wifi_provisioning/scheme_ble.h"
 #include "esp_netif.h"
 
 #define WIFI_CONNECTED_BIT  BIT0
-#define WIFI_FAIL_BIT       BIT1
 
 #define PROV_SERVICE_NAME   "SMART_BED_PROV"
 #define PROV_POP            "123456"
 
-#define MAX_RETRY_COUNT 5
+#define WIFI_NVS_NAMESPACE  "wifi"
+#define WIFI_NVS_KEY_AP     "ap"
+
+#define WIFI_BACKOFF_MIN_MS 250
+#define WIFI_BACKOFF_MAX_MS 60000
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+} wifi_ap_cache_t;
+
+typedef struct {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t fast_connects;
+    uint32_t fast_misses;
+    uint32_t backoff_ms;
+    uint32_t first_connect_ms;
+    uint32_t last_connect_ms;
+} wifi_stats_t;
 
 extern EventGroupHandle_t s_wifi_event_group;
 
 esp_err_t wifi_init_sta_with_provisioning(void);
 bool wifi_is_connected(void);
 bool wifi_wait_connected(uint32_t timeout_ms);
+void wifi_get_stats(wifi_stats_t *stats);
+esp_err_t wifi_set_power_save(bool save);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,56 @@
+#ifndef WS_STREAM_H
+#define WS_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sensor_record.h"
+
+#define WS_STREAM_URI           "/ws"
+#define WS_MAX_CLIENTS          4
+#define WS_CLIENT_QUEUE_LEN     16
+#define WS_RX_MAX               64
+#define WS_SEND_TIMEOUT_S       1
+
+#define WS_SAMPLE_TYPE          1
+#define WS_FLAG_PRESENT         0x01
+
+/*
+ * One binary WebSocket message carries one or more of these back to back,
+ * little endian, so the dashboard can walk it with a DataView at a fixed
+ * stride. seq counts samples, so a gap means the client's queue overflowed.
+ */
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t seq;
+    uint32_t t_ms;
+    int16_t weight[SENSOR_RECORD_CHANNELS];
+    int32_t accel[3];
+    int16_t cog_x;
+    int16_t cog_y;
+} ws_sample_t;
+
+_Static_assert(sizeof(ws_sample_t) == 32, "ws_sample_t layout is shared with docs/index.html");
+
+typedef struct {
+    uint32_t clients;
+    uint32_t samples_sent;
+    uint32_t frames_sent;
+    uint32_t dropped;
+    uint32_t send_errors;
+} ws_stream_stats_t;
+
+esp_err_t ws_stream_start(void);
+void ws_stream_publish(const sensor_record_t *rec, bool present, int16_t cog_x, int16_t cog_y);
+void ws_stream_get_stats(ws_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+#include "ahrs.h"
+#include <string.h>
+
+static uint64_t isqrt64(uint64_t x)
+{
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+static bool normalize3(const int32_t in[3], int32_t out[3])
+{
+    uint64_t n2 = 0;
+    for (int i = 0; i < 3; i++) n2 += (int64_t)in[i] * in[i];
+
+    int64_t n = (int64_t)isqrt64(n2);
+    if (n == 0) return false;
+
+    for (int i = 0; i < 3; i++) out[i] = (int32_t)(((int64_t)in[i] << 30) / n);
+    return true;
+}
+
+static void cross30(const int32_t a[3], const int32_t b[3], int32_t out[3])
+{
+    out[0] = (int32_t)(((int64_t)a[1] * b[2] - (int64_t)a[2] * b[1]) >> 30);
+    out[1] = (int32_t)(((int64_t)a[2] * b[0] - (int64_t)a[0] * b[2]) >> 30);
+    out[2] = (int32_t)(((int64_t)a[0] * b[1] - (int64_t)a[1] * b[0]) >> 30);
+}
+
+// Rotation matrix of q, sensor to earth, in Q30. Row 2 is gravity as seen
+// by the sensor.
+static void dcm(const int32_t q[4], int32_t r[3][3])
+{
+    int64_t q00 = (int64_t)q[0] * q[0], q11 = (int64_t)q[1] * q[1];
+    int64_t q22 = (int64_t)q[2] * q[2], q33 = (int64_t)q[3] * q[3];
+    int64_t q01 = (int64_t)q[0] * q[1], q02 = (int64_t)q[0] * q[2];
+    int64_t q03 = (int64_t)q[0] * q[3], q12 = (int64_t)q[1] * q[2];
+    int64_t q13 = (int64_t)q[1] * q[3], q23 = (int64_t)q[2] * q[3];
+
+    r[0][0] = (int32_t)((q00 + q11 - q22 - q33) >> 30);
+    r[0][1] = (int32_t)((q12 - q03) >> 29);
+    r[0][2] = (int32_t)((q13 + q02) >> 29);
+    r[1][0] = (int32_t)((q12 + q03) >> 29);
+    r[1][1] = (int32_t)((q00 - q11 + q22 - q33) >> 30);
+    r[1][2] = (int32_t)((q23 - q01) >> 29);
+    r[2][0] = (int32_t)((q13 - q02) >> 29);
+    r[2][1] = (int32_t)((q23 + q01) >> 29);
+    r[2][2] = (int32_t)((q00 - q11 - q22 + q33) >> 30);
+}
+
+void ahrs_init(ahrs_t *f, int32_t kp_q16, int32_t ki_q16)
+{
+    memset(f, 0, sizeof(*f));
+    f->q[0] = AHRS_Q30_ONE;
+    f->kp_q16 = kp_q16;
+    f->ki_q16 = ki_q16;
+}
+
+// The field is projected into the earth frame, flattened onto the north
+// axis and rotated back. The error still has a tilt part wherever the
+// measured field disagrees with the estimated dip (iron nearby, no hard-iron
+// calibration), so only its component about the vertical r[2] is kept and
+// the mag corrects heading alone.
+static void mag_error(const int32_t r[3][3], const int32_t m[3], int32_t e[3])
+{
+    int32_t h[3], w[3];
+
+    for (int i = 0; i < 3; i++) {
+        h[i] = (int32_t)(((int64_t)r[i][0] * m[0] + (int64_t)r[i][1] * m[1] + (int64_t)r[i][2] * m[2]) >> 30);
+    }
+    int32_t bx = (int32_t)isqrt64((uint64_t)((int64_t)h[0] * h[0] + (int64_t)h[1] * h[1]));
+    int32_t bz = h[2];
+
+    for (int i = 0; i < 3; i++) {
+        w[i] = (int32_t)(((int64_t)r[0][i] * bx + (int64_t)r[2][i] * bz) >> 30);
+    }
+    cross30(m, w, e);
+
+    int32_t v = (int32_t)(((int64_t)e[0] * r[2][0] + (int64_t)e[1] * r[2][1] + (int64_t)e[2] * r[2][2]) >> 30);
+    for (int i = 0; i < 3; i++) e[i] = (int32_t)(((int64_t)v * r[2][i]) >> 30);
+}
+
+void ahrs_update(ahrs_t *f, int64_t t_us, const int32_t gyro_mdps[3],
+                 const int32_t accel_mg[3], const int16_t *mag)
+{
+    int64_t dt = t_us - f->last_us;
+    bool first = f->last_us == 0;
+
+    f->last_us = t_us;
+    if (first || dt <= 0) return;
+    if (dt > AHRS_DT_MAX_US) dt = AHRS_DT_MAX_US;
+
+    int32_t r[3][3];
+    int32_t w[3], a[3], e[3] = {0};
+
+    for (int i = 0; i < 3; i++) {
+        w[i] = (int32_t)(((int64_t)gyro_mdps[i] * AHRS_MDPS_TO_RAD_Q16) >> 16);
+    }
+
+    if (normalize3(accel_mg, a)) {
+        dcm(f->q, r);
+        cross30(a, r[2], e);
+
+        int32_t mag32[3], m[3], em[3];
+        if (mag != NULL) {
+            for (int i = 0; i < 3; i++) mag32[i] = mag[i];
+            if (normalize3(mag32, m)) {
+                mag_error(r, m, em);
+                for (int i = 0; i < 3; i++) e[i] += em[i];
+            }
+        }
+
+        for (int i = 0; i < 3; i++) {
+            if (f->ki_q16 > 0) {
+                int64_t rate = ((int64_t)f->ki_q16 * e[i]) >> 22;
+                f->integral[i] += (int32_t)(rate * dt / 1000000);
+            }
+            w[i] += (int32_t)(((int64_t)f->kp_q16 * e[i]) >> 30) + (f->integral[i] >> 8);
+        }
+    }
+
+    // q += 0.5 * q x (0, w) * dt, with w in Q16 rad/s.
+    const int32_t *q = f->q;
+    int64_t d[4];
+    d[0] = -(int64_t)q[1] * w[0] - (int64_t)q[2] * w[1] - (int64_t)q[3] * w[2];
+    d[1] =  (int64_t)q[0] * w[0] + (int64_t)q[2] * w[2] - (int64_t)q[3] * w[1];
+    d[2] =  (int64_t)q[0] * w[1] - (int64_t)q[1] * w[2] + (int64_t)q[3] * w[0];
+    d[3] =  (int64_t)q[0] * w[2] + (int64_t)q[1] * w[1] - (int64_t)q[2] * w[0];
+
+    uint64_t n2 = 0;
+    for (int i = 0; i < 4; i++) {
+        f->q[i] += (int32_t)(((d[i] >> 16) * dt) / 2000000);
+        n2 += (int64_t)f->q[i] * f->q[i];
+    }
+
+    int64_t n = (int64_t)isqrt64(n2);
+    if (n == 0) {
+        ahrs_init(f, f->kp_q16, f->ki_q16);
+        return;
+    }
+    for (int i = 0; i < 4; i++) f->q[i] = (int32_t)(((int64_t)f->q[i] << 30) / n);
+}
+
+// Rational approximation of atan, within about 0.3 degrees.
+static int32_t atan2_cdeg(int32_t y, int32_t x)
+{
+    if (x == 0 && y == 0) return 0;
+
+    int64_t ax = x < 0 ? -(int64_t)x : x;
+    int64_t ay = y < 0 ? -(int64_t)y : y;
+    bool swap = ay > ax;
+    int64_t z = swap ? (ax << 15) / ay : (ay << 15) / ax;
+
+    int32_t a = (int32_t)((4500 * z + ((1564 * z * (32768 - z)) >> 15)) >> 15);
+    if (swap) a = 9000 - a;
+    if (x < 0) a = 18000 - a;
+    return y < 0 ? -a : a;
+}
+
+// Roll, pitch and yaw (Z-Y-X) in hundredths of a degree.
+void ahrs_get_euler(const ahrs_t *f, int16_t euler_cdeg[3])
+{
+    int32_t r[3][3];
+    dcm(f->q, r);
+
+    int32_t horiz = (int32_t)isqrt64((uint64_t)((int64_t)r[2][1] * r[2][1] + (int64_t)r[2][2] * r[2][2]));
+
+    euler_cdeg[0] = (int16_t)atan2_cdeg(r[2][1], r[2][2]);
+    euler_cdeg[1] = (int16_t)atan2_cdeg(-r[2][0], horiz);
+    euler_cdeg[2] = (int16_t)atan2_cdeg(r[1][0], r[0][0]);
+}
@@ -0,0 +1,31 @@
+#include "app_state.h"
+#include "seqlock.h"
+
+static seqlock_t s_latest_lock;
+static sensor_record_t s_latest;
+static bool s_person_present = false;
+
+void app_state_publish_sample(const sensor_record_t *record)
+{
+    seqlock_write(&s_latest_lock, &s_latest, record, sizeof(s_latest));
+}
+
+void app_state_get_latest(sensor_record_t *record)
+{
+    seqlock_read(&s_latest_lock, record, &s_latest, sizeof(s_latest));
+}
+
+void app_state_set_presence(bool present)
+{
+    __atomic_store_n(&s_person_present, present, __ATOMIC_RELEASE);
+}
+
+bool app_state_person_present(void)
+{
+    return __atomic_load_n(&s_person_present, __ATOMIC_ACQUIRE);
+}
+
+uint32_t app_state_read_retries(void)
+{
+    return __atomic_load_n(&s_latest_lock.retries, __ATOMIC_RELAXED);
+}
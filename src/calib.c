@@ -0,0 +1,91 @@
+#include "calib.h"
+#include <string.h>
+#include <stddef.h>
+#include "nvs.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+
+static const char *TAG = "CALIB";
+
+static const int32_t s_default_offset[LC_MAX_CHANNELS] = { 8432156, 8431200, 8433500, 8430800 };
+static const float s_default_scale[LC_MAX_CHANNELS] = { 420.5f, 418.3f, 422.1f, 419.7f };
+
+static uint32_t blob_crc(const calib_blob_t *cal)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)cal, offsetof(calib_blob_t, crc));
+}
+
+void calib_defaults(calib_blob_t *cal)
+{
+    memset(cal, 0, sizeof(*cal));
+    cal->version = CALIB_VERSION;
+    cal->size = sizeof(*cal);
+    memcpy(cal->offset, s_default_offset, sizeof(cal->offset));
+    memcpy(cal->scale, s_default_scale, sizeof(cal->scale));
+}
+
+// One nvs_get_blob() for the whole record. Anything that does not match the
+// current layout exactly falls back to the defaults.
+esp_err_t calib_load(calib_blob_t *cal)
+{
+    nvs_handle_t handle;
+    size_t len = sizeof(*cal);
+
+    esp_err_t ret = nvs_open(CALIB_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, CALIB_NVS_KEY, cal, &len);
+        nvs_close(handle);
+    }
+
+    if (ret == ESP_OK && (len != sizeof(*cal) || cal->version != CALIB_VERSION ||
+                          cal->size != sizeof(*cal) || cal->crc != blob_crc(cal))) {
+        ret = ESP_ERR_INVALID_VERSION;
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No valid calibration (%s), using defaults", esp_err_to_name(ret));
+        calib_defaults(cal);
+    }
+
+    return ret;
+}
+
+esp_err_t calib_save(calib_blob_t *cal)
+{
+    nvs_handle_t handle;
+
+    cal->version = CALIB_VERSION;
+    cal->size = sizeof(*cal);
+    cal->crc = blob_crc(cal);
+
+    esp_err_t ret = nvs_open(CALIB_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    ret = nvs_set_blob(handle, CALIB_NVS_KEY, cal, sizeof(*cal));
+    if (ret == ESP_OK) ret = nvs_commit(handle);
+    nvs_close(handle);
+
+    return ret;
+}
+
+void calib_drift_init(calib_drift_t *d)
+{
+    d->active = false;
+}
+
+int32_t calib_drift_update(calib_drift_t *d, int32_t raw, int32_t offset, bool empty)
+{
+    int32_t delta = raw - offset;
+
+    if (!empty || delta > CALIB_DRIFT_WINDOW || delta < -CALIB_DRIFT_WINDOW) {
+        d->active = false;
+        return offset;
+    }
+
+    if (!d->active) {
+        dsp_ema_init(&d->ema, CALIB_DRIFT_ALPHA_Q15, offset);
+        d->active = true;
+    }
+
+    return dsp_ema_update(&d->ema, raw);
+}
@@ -0,0 +1,132 @@
+#include "command.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "trace.h"
+
+static const char *TAG = "CMD";
+
+static command_handler_t s_handlers[CMD_COUNT];
+static QueueHandle_t s_queue = NULL;
+static command_stats_t s_stats;
+
+static char s_arena[CMD_ARENA_SIZE];
+static int s_arena_len = 0;
+
+// Entry point for every transport. The MQTT and httpd tasks can both be in
+// here at once, so the counters are bumped atomically.
+esp_err_t command_submit(const char *data, size_t len)
+{
+    command_t cmd;
+
+    __atomic_add_fetch(&s_stats.received, 1, __ATOMIC_RELAXED);
+
+    esp_err_t ret = command_parse(data, len, &cmd);
+    if (ret != ESP_OK) {
+        __atomic_add_fetch(&s_stats.parse_errors, 1, __ATOMIC_RELAXED);
+        ESP_LOGW(TAG, "Rejected '%.*s' (%s)", (int)len, data, esp_err_to_name(ret));
+        return ret;
+    }
+
+    return command_post(&cmd);
+}
+
+esp_err_t command_post(const command_t *cmd)
+{
+    if (s_queue == NULL || xQueueSend(s_queue, cmd, 0) != pdTRUE) {
+        __atomic_add_fetch(&s_stats.queue_full, 1, __ATOMIC_RELAXED);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+// Called from the MQTT task. Unfragmented payloads are parsed straight out of
+// the event buffer; fragments are collected in the arena until complete.
+esp_err_t command_feed(const char *data, int len, int offset, int total)
+{
+    if (offset == 0 && len == total) {
+        s_arena_len = 0;
+        return command_submit(data, (size_t)len);
+    }
+
+    // A first fragment starts a new message; whatever an abandoned one left
+    // in the arena must not make it look out of sequence.
+    if (offset == 0) s_arena_len = 0;
+
+    if (total > CMD_ARENA_SIZE) {
+        if (offset == 0) {
+            s_stats.oversize++;
+            ESP_LOGW(TAG, "Command too long (%d bytes)", total);
+        }
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (offset != s_arena_len || offset + len > total) {
+        s_arena_len = 0;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memcpy(&s_arena[offset], data, len);
+    s_arena_len += len;
+
+    if (s_arena_len < total) return ESP_OK;
+
+    s_arena_len = 0;
+    return command_submit(s_arena, (size_t)total);
+}
+
+static void task_command(void *pvParameters)
+{
+    command_t cmd;
+
+    trace_register_task(NULL);
+
+    while (1)
+    {
+        if (xQueueReceive(s_queue, &cmd, portMAX_DELAY) != pdTRUE) continue;
+
+        command_handler_t handler = s_handlers[cmd.id];
+        if (handler == NULL) {
+            ESP_LOGW(TAG, "No handler for %s", command_name(cmd.id));
+            continue;
+        }
+
+        esp_err_t ret = handler(&cmd);
+        s_stats.executed++;
+
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "%s failed: %s", command_name(cmd.id), esp_err_to_name(ret));
+        }
+    }
+}
+
+esp_err_t command_start(void)
+{
+    if (s_queue != NULL) return ESP_ERR_INVALID_STATE;
+
+    s_queue = xQueueCreate(CMD_QUEUE_LEN, sizeof(command_t));
+    if (s_queue == NULL) return ESP_ERR_NO_MEM;
+
+    BaseType_t ret = xTaskCreatePinnedToCore(task_command, "Command", CMD_TASK_STACK,
+                                             NULL, CMD_TASK_PRIO, NULL, CMD_TASK_CORE);
+    if (ret != pdPASS) {
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+void command_register(cmd_id_t id, command_handler_t handler)
+{
+    if (id < CMD_COUNT) s_handlers[id] = handler;
+}
+
+void command_get_stats(command_stats_t *stats)
+{
+    *stats = s_stats;
+}
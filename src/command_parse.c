@@ -0,0 +1,153 @@
+#include "command.h"
+#include <string.h>
+
+// Kept free of FreeRTOS and driver headers so the command grammar can be
+// built and exercised off-target.
+
+typedef struct {
+    const char *name;
+    uint8_t name_len;
+    cmd_id_t id;
+    const char *args;   // one char per argument: 'i' int32, 'f' float
+} cmd_entry_t;
+
+#define CMD_ENTRY(str, cmd_id, spec) { str, sizeof(str) - 1, cmd_id, spec }
+
+// Must stay sorted by name: lookup is a binary search over this table.
+static const cmd_entry_t s_commands[] = {
+    CMD_ENTRY("CAL_IMU",    CMD_CAL_IMU,    ""),
+    CMD_ENTRY("CAL_SAVE",   CMD_CAL_SAVE,   ""),
+    CMD_ENTRY("GET_STATUS", CMD_GET_STATUS, ""),
+    CMD_ENTRY("RESET_FALL", CMD_RESET_FALL, ""),
+    CMD_ENTRY("SET_RATE",   CMD_SET_RATE,   "i"),
+    CMD_ENTRY("SET_SCALE",  CMD_SET_SCALE,  "if"),
+    CMD_ENTRY("SET_TEMPCO", CMD_SET_TEMPCO, "ii"),
+    CMD_ENTRY("TARE",       CMD_TARE,       ""),
+};
+
+#define CMD_TABLE_LEN (sizeof(s_commands) / sizeof(s_commands[0]))
+
+static inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static size_t next_token(const char *data, size_t len, size_t *pos, const char **tok)
+{
+    size_t i = *pos;
+
+    while (i < len && is_space(data[i])) i++;
+    *tok = &data[i];
+
+    size_t start = i;
+    while (i < len && !is_space(data[i])) i++;
+
+    *pos = i;
+    return i - start;
+}
+
+static const cmd_entry_t *lookup(const char *tok, size_t len)
+{
+    int lo = 0;
+    int hi = (int)CMD_TABLE_LEN - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const cmd_entry_t *e = &s_commands[mid];
+        size_t n = (len < e->name_len) ? len : e->name_len;
+        int cmp = memcmp(tok, e->name, n);
+        if (cmp == 0) cmp = (int)len - (int)e->name_len;
+
+        if (cmp == 0) return e;
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+static bool parse_int(const char *tok, size_t len, int32_t *out)
+{
+    size_t i = 0;
+    bool neg = false;
+    int64_t v = 0;
+
+    if (i < len && (tok[i] == '-' || tok[i] == '+')) neg = (tok[i++] == '-');
+    if (i == len) return false;
+
+    for (; i < len; i++) {
+        if (tok[i] < '0' || tok[i] > '9') return false;
+        v = v * 10 + (tok[i] - '0');
+        if (v > INT32_MAX) return false;
+    }
+
+    *out = (int32_t)(neg ? -v : v);
+    return true;
+}
+
+static bool parse_float(const char *tok, size_t len, float *out)
+{
+    size_t i = 0;
+    bool neg = false;
+    bool digits = false;
+    int64_t mant = 0;
+    float scale = 1.0f;
+
+    if (i < len && (tok[i] == '-' || tok[i] == '+')) neg = (tok[i++] == '-');
+
+    for (; i < len && tok[i] >= '0' && tok[i] <= '9'; i++) {
+        if (mant > INT32_MAX) return false;
+        mant = mant * 10 + (tok[i] - '0');
+        digits = true;
+    }
+
+    if (i < len && tok[i] == '.') {
+        for (i++; i < len && tok[i] >= '0' && tok[i] <= '9'; i++) {
+            if (mant < INT32_MAX) {
+                mant = mant * 10 + (tok[i] - '0');
+                scale *= 10.0f;
+            }
+            digits = true;
+        }
+    }
+
+    if (!digits || i != len) return false;
+
+    *out = (float)mant / scale;
+    if (neg) *out = -*out;
+    return true;
+}
+
+esp_err_t command_parse(const char *data, size_t len, command_t *cmd)
+{
+    const char *tok;
+    size_t pos = 0;
+    size_t tok_len = next_token(data, len, &pos, &tok);
+
+    const cmd_entry_t *e = lookup(tok, tok_len);
+    if (e == NULL) return ESP_ERR_NOT_FOUND;
+
+    cmd->id = e->id;
+    cmd->argc = 0;
+
+    for (const char *spec = e->args; *spec; spec++) {
+        tok_len = next_token(data, len, &pos, &tok);
+        if (tok_len == 0) return ESP_ERR_INVALID_ARG;
+
+        bool ok = (*spec == 'f') ? parse_float(tok, tok_len, &cmd->args[cmd->argc].f)
+                                 : parse_int(tok, tok_len, &cmd->args[cmd->argc].i);
+        if (!ok) return ESP_ERR_INVALID_ARG;
+        cmd->argc++;
+    }
+
+    if (next_token(data, len, &pos, &tok) != 0) return ESP_ERR_INVALID_ARG;
+
+    return ESP_OK;
+}
+
+const char *command_name(cmd_id_t id)
+{
+    for (size_t i = 0; i < CMD_TABLE_LEN; i++) {
+        if (s_commands[i].id == id) return s_commands[i].name;
+    }
+    return "?";
+}
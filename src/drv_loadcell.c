@@ -1,9 +1,36 @@
 #include "drv_loadcell.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc_caps.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "trace.h"
+#if SOC_DEDICATED_GPIO_SUPPORTED
+#include "driver/dedic_gpio.h"
+#include "hal/dedic_gpio_cpu_ll.h"
+#endif
 
 static portMUX_TYPE spinlock = portMUX_INITIALIZER_UNLOCKED;
 
+static loadcell_t *s_async_cells[LC_MAX_CHANNELS];
+static uint8_t s_async_count = 0;
+static QueueHandle_t s_async_queue = NULL;
+static TaskHandle_t s_acq_task = NULL;
+static uint32_t s_async_dropped = 0;
+static bool s_power_request = true;
+static volatile bool s_powered = true;
+static volatile int64_t s_ready_us[LC_MAX_CHANNELS];
+
+#if SOC_DEDICATED_GPIO_SUPPORTED
+static dedic_gpio_bundle_handle_t s_sck_bundle = NULL;
+static dedic_gpio_bundle_handle_t s_dout_bundle = NULL;
+static uint32_t s_sck_offset = 0;
+static uint32_t s_dout_offset = 0;
+static uint32_t s_half_period_cycles = 0;
+#endif
+
 static inline void delay_us(uint32_t us)
 {
     esp_rom_delay_us(us);
@@ -14,7 +41,13 @@ esp_err_t loadcell_init(loadcell_t *sensor, gpio_num_t dout_pin, gpio_num_t sck_
     sensor->dout_pin = dout_pin;
     sensor->sck_pin = sck_pin;
     sensor->offset = 0;
-    sensor->scale = 1.0f;
+    loadcell_set_scale(sensor, 1.0f);
+    sensor->backend = LC_BACKEND_GPIO;
+    sensor->bundle_ch = 0;
+    sensor->gain = HX711_GAIN_A_128;
+    sensor->sps = HX711_SPS_LOW;
+    sensor->period_us = 1000000 / HX711_SPS_LOW;
+    sensor->timeouts = 0;
     sensor->is_initialized = true;
 
     gpio_config_t io_conf = {};
@@ -37,50 +70,291 @@ esp_err_t loadcell_init(loadcell_t *sensor, gpio_num_t dout_pin, gpio_num_t sck_
     return ESP_OK;
 }
 
-int32_t loadcell_read_raw(loadcell_t *sensor)
+typedef struct {
+    uint32_t lo;
+    uint32_t hi;
+} pin_mask_t;
+
+static inline void pin_mask_add(pin_mask_t *mask, gpio_num_t pin)
 {
-    if (!sensor->is_initialized) return LC_ERROR_CODE;
+    if (pin < 32) mask->lo |= 1UL << pin;
+    else          mask->hi |= 1UL << (pin - 32);
+}
 
-    int16_t timeout = LC_TIMEOUT_US;
-    while (gpio_get_level(sensor->dout_pin) == 1)
+static inline uint32_t pin_level(uint32_t in_lo, uint32_t in_hi, gpio_num_t pin)
+{
+    return (pin < 32) ? (in_lo >> pin) & 1 : (in_hi >> (pin - 32)) & 1;
+}
+
+static inline int32_t sign_extend(uint32_t value)
+{
+    if (value & (1UL << 23))
     {
-        delay_us(1);
-        if (--timeout <= 0) return LC_ERROR_CODE;
+        value |= HX711_SIGN_MASK;
     }
+    return (int32_t)value;
+}
 
-    uint32_t value = 0;
+// Clocks out every channel in ch_mask together: all SCK lines are driven through
+// the W1TS/W1TC registers and all DOUT lines are captured with one read of each
+// input bank per bit. Past the data bits, each cell drops out of the SCK mask
+// once it has had the pulse count for its own gain. Only the SCK high phase is time critical (>60 us high
+// powers the HX711 down), so interrupts are masked per pulse, not per frame.
+static void shift_in_gpio(loadcell_t *const sensors[], uint8_t count, uint32_t ch_mask,
+                          uint8_t pulses, uint32_t value[])
+{
+    pin_mask_t sck[HX711_MAX_PULSES - HX711_DATA_BITS] = {0};
 
-    portENTER_CRITICAL(&spinlock);
+    for (uint8_t ch = 0; ch < count; ch++) {
+        if (!(ch_mask & (1UL << ch))) continue;
+        int extra = (int)sensors[ch]->gain - HX711_DATA_BITS;
+        for (int k = 0; k < extra; k++) {
+            pin_mask_add(&sck[k], sensors[ch]->sck_pin);
+        }
+    }
 
-    for (int i = 0; i < 24; i++)
+    for (int i = 0; i < pulses; i++)
     {
-        gpio_set_level(sensor->sck_pin, 1);
-        delay_us(1);
+        const pin_mask_t *m = &sck[i < HX711_DATA_BITS ? 0 : i - HX711_DATA_BITS];
 
-        value = value << 1;
+        TRACE_BEGIN(crit);
+        portENTER_CRITICAL(&spinlock);
+        REG_WRITE(GPIO_OUT_W1TS_REG, m->lo);
+        REG_WRITE(GPIO_OUT1_W1TS_REG, m->hi);
+        delay_us(1);
+        uint32_t in_lo = REG_READ(GPIO_IN_REG);
+        uint32_t in_hi = REG_READ(GPIO_IN1_REG);
+        REG_WRITE(GPIO_OUT_W1TC_REG, m->lo);
+        REG_WRITE(GPIO_OUT1_W1TC_REG, m->hi);
+        portEXIT_CRITICAL(&spinlock);
+        TRACE_END(TRACE_LC_CRITICAL, crit);
 
-        if (gpio_get_level(sensor->dout_pin))
-        {
-            value++;
+        if (i < HX711_DATA_BITS) {
+            for (uint8_t ch = 0; ch < count; ch++) {
+                if (!(ch_mask & (1UL << ch))) continue;
+                value[ch] = (value[ch] << 1) | pin_level(in_lo, in_hi, sensors[ch]->dout_pin);
+            }
         }
 
-        gpio_set_level(sensor->sck_pin, 0);
         delay_us(1);
     }
+}
 
-    gpio_set_level(sensor->sck_pin, 1);
-    delay_us(1);
-    gpio_set_level(sensor->sck_pin, 0);
-    delay_us(1);
+#if SOC_DEDICATED_GPIO_SUPPORTED
+static inline void wait_cycles(uint32_t start, uint32_t cycles)
+{
+    while ((uint32_t)(esp_cpu_get_cycle_count() - start) < cycles) {
+    }
+}
 
-    portEXIT_CRITICAL(&spinlock);
+// Same frame through the dedicated GPIO bundles: one CPU instruction drives all
+// SCK lines or samples all DOUT lines, and half-periods are counted in CPU
+// cycles, so a pulse is ~0.5 us with no esp_rom_delay_us() jitter. The bundles
+// are bound to the core that created them (LC_ACQ_TASK_CORE).
+static void shift_in_dedic(loadcell_t *const sensors[], uint8_t count, uint32_t ch_mask,
+                           uint8_t pulses, uint32_t value[])
+{
+    uint32_t sck[HX711_MAX_PULSES - HX711_DATA_BITS] = {0};
 
-    if (value & (1UL << 23))
+    for (uint8_t ch = 0; ch < count; ch++) {
+        if (!(ch_mask & (1UL << ch))) continue;
+        int extra = (int)sensors[ch]->gain - HX711_DATA_BITS;
+        for (int k = 0; k < extra; k++) {
+            sck[k] |= 1UL << (s_sck_offset + sensors[ch]->bundle_ch);
+        }
+    }
+
+    for (int i = 0; i < pulses; i++)
     {
-        value |= HX711_SIGN_MASK;
+        uint32_t m = sck[i < HX711_DATA_BITS ? 0 : i - HX711_DATA_BITS];
+
+        TRACE_BEGIN(crit);
+        portENTER_CRITICAL(&spinlock);
+        dedic_gpio_cpu_ll_write_mask(m, m);
+        wait_cycles(esp_cpu_get_cycle_count(), s_half_period_cycles);
+        uint32_t in = dedic_gpio_cpu_ll_read_in();
+        dedic_gpio_cpu_ll_write_mask(m, 0);
+        portEXIT_CRITICAL(&spinlock);
+        TRACE_END(TRACE_LC_CRITICAL, crit);
+
+        uint32_t low_start = esp_cpu_get_cycle_count();
+
+        if (i < HX711_DATA_BITS) {
+            for (uint8_t ch = 0; ch < count; ch++) {
+                if (!(ch_mask & (1UL << ch))) continue;
+                value[ch] = (value[ch] << 1) | ((in >> (s_dout_offset + sensors[ch]->bundle_ch)) & 1);
+            }
+        }
+
+        wait_cycles(low_start, s_half_period_cycles);
     }
+}
+#endif
 
-    return (int32_t)value;
+static void shift_in_parallel(loadcell_t *const sensors[], uint8_t count, uint32_t ch_mask, int32_t *raw_out)
+{
+    TRACE_SCOPE(TRACE_LC_FRAME);
+    uint32_t value[LC_MAX_CHANNELS] = {0};
+    uint8_t pulses = HX711_GAIN_A_128;
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        if ((ch_mask & (1UL << ch)) && sensors[ch]->gain > pulses) pulses = sensors[ch]->gain;
+    }
+
+#if SOC_DEDICATED_GPIO_SUPPORTED
+    if (sensors[0]->backend == LC_BACKEND_DEDIC_GPIO) {
+        shift_in_dedic(sensors, count, ch_mask, pulses, value);
+    } else
+#endif
+    {
+        shift_in_gpio(sensors, count, ch_mask, pulses, value);
+    }
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        if (ch_mask & (1UL << ch)) raw_out[ch] = sign_extend(value[ch]);
+    }
+}
+
+esp_err_t loadcell_init_backend(loadcell_t *const sensors[], uint8_t count, loadcell_backend_t backend)
+{
+    if (count == 0 || count > LC_MAX_CHANNELS) return ESP_ERR_INVALID_ARG;
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        if (!sensors[ch]->is_initialized) return ESP_ERR_INVALID_STATE;
+    }
+
+#if SOC_DEDICATED_GPIO_SUPPORTED
+    if (s_sck_bundle) {
+        dedic_gpio_del_bundle(s_sck_bundle);
+        s_sck_bundle = NULL;
+    }
+    if (s_dout_bundle) {
+        dedic_gpio_del_bundle(s_dout_bundle);
+        s_dout_bundle = NULL;
+    }
+
+    if (backend == LC_BACKEND_DEDIC_GPIO) {
+        int sck_pins[LC_MAX_CHANNELS];
+        int dout_pins[LC_MAX_CHANNELS];
+
+        for (uint8_t ch = 0; ch < count; ch++) {
+            sck_pins[ch] = sensors[ch]->sck_pin;
+            dout_pins[ch] = sensors[ch]->dout_pin;
+        }
+
+        dedic_gpio_bundle_config_t sck_cfg = {
+            .gpio_array = sck_pins,
+            .array_size = count,
+            .flags = { .out_en = 1 },
+        };
+        dedic_gpio_bundle_config_t dout_cfg = {
+            .gpio_array = dout_pins,
+            .array_size = count,
+            .flags = { .in_en = 1 },
+        };
+
+        esp_err_t status = dedic_gpio_new_bundle(&sck_cfg, &s_sck_bundle);
+        if (status != ESP_OK) return status;
+
+        status = dedic_gpio_new_bundle(&dout_cfg, &s_dout_bundle);
+        if (status != ESP_OK) {
+            dedic_gpio_del_bundle(s_sck_bundle);
+            s_sck_bundle = NULL;
+            return status;
+        }
+
+        dedic_gpio_get_out_offset(s_sck_bundle, &s_sck_offset);
+        dedic_gpio_get_in_offset(s_dout_bundle, &s_dout_offset);
+        s_half_period_cycles = esp_rom_get_cpu_ticks_per_us() * LC_DEDIC_HALF_PERIOD_NS / 1000;
+        dedic_gpio_cpu_ll_write_mask(((1UL << count) - 1) << s_sck_offset, 0);
+    }
+#else
+    if (backend == LC_BACKEND_DEDIC_GPIO) return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        sensors[ch]->backend = backend;
+        sensors[ch]->bundle_ch = ch;
+    }
+
+    return ESP_OK;
+}
+
+// The RATE pin is strapped on the board, so sps only tells the driver what
+// timing to expect. A new gain applies from the conversion after next.
+esp_err_t loadcell_configure(loadcell_t *sensor, hx711_gain_t gain, uint8_t sps)
+{
+    if (gain != HX711_GAIN_A_128 && gain != HX711_GAIN_B_32 && gain != HX711_GAIN_A_64) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sps != HX711_SPS_LOW && sps != HX711_SPS_HIGH) return ESP_ERR_INVALID_ARG;
+
+    sensor->gain = gain;
+    sensor->sps = sps;
+    sensor->period_us = 1000000 / sps;
+    return ESP_OK;
+}
+
+// A conversion is due within one output period, so the wait is scaled to the
+// slowest cell. Long waits sleep a tick at a time instead of spinning.
+static bool wait_ready(loadcell_t *const sensors[], uint8_t count)
+{
+    uint32_t timeout_us = 0;
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        uint32_t t = sensors[ch]->period_us * LC_READY_TIMEOUT_PCT / 100;
+        if (t > timeout_us) timeout_us = t;
+    }
+
+    int64_t deadline = esp_timer_get_time() + timeout_us;
+    uint8_t ch = 0;
+    while (ch < count)
+    {
+        if (gpio_get_level(sensors[ch]->dout_pin) == 0) {
+            ch++;
+            continue;
+        }
+
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0) {
+            for (; ch < count; ch++) {
+                if (gpio_get_level(sensors[ch]->dout_pin) == 1) sensors[ch]->timeouts++;
+            }
+            return false;
+        }
+
+        if (left > portTICK_PERIOD_MS * 1000) {
+            vTaskDelay(1);
+        } else {
+            delay_us(10);
+        }
+    }
+
+    return true;
+}
+
+int32_t loadcell_read_raw(loadcell_t *sensor)
+{
+    if (!sensor->is_initialized) return LC_ERROR_CODE;
+    if (!wait_ready(&sensor, 1)) return LC_ERROR_CODE;
+
+    int32_t raw;
+    shift_in_parallel(&sensor, 1, 0x1, &raw);
+    return raw;
+}
+
+esp_err_t loadcell_read_raw_multi(loadcell_t *const sensors[], uint8_t count, int32_t raw_out[])
+{
+    if (count == 0 || count > LC_MAX_CHANNELS) return ESP_ERR_INVALID_ARG;
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        if (!sensors[ch]->is_initialized) return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!wait_ready(sensors, count)) return ESP_ERR_TIMEOUT;
+
+    shift_in_parallel(sensors, count, (1UL << count) - 1, raw_out);
+    return ESP_OK;
 }
 
 int32_t loadcell_read_average(loadcell_t *sensor, uint8_t times)
@@ -98,31 +372,240 @@ int32_t loadcell_read_average(loadcell_t *sensor, uint8_t times)
             sum += raw;
             valid_count++;
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
 
     if (valid_count == 0) return LC_ERROR_CODE;
     return (int32_t)(sum / valid_count);
 }
 
-void loadcell_tare(loadcell_t *sensor)
+esp_err_t loadcell_tare(loadcell_t *sensor)
 {
     int32_t avg = loadcell_read_average(sensor, 10);
-    if (avg != LC_ERROR_CODE) {
-        sensor->offset = avg;
-    }
+    if (avg == LC_ERROR_CODE) return ESP_ERR_TIMEOUT;
+
+    sensor->offset = avg;
+    return ESP_OK;
 }
 
 void loadcell_set_scale(loadcell_t *sensor, float scale_value)
 {
     sensor->scale = scale_value;
+    sensor->weight_per_count_q16 = (int32_t)(1000.0f * 65536.0f / scale_value + 0.5f);
+}
+
+int16_t loadcell_raw_to_weight(const loadcell_t *sensor, int32_t raw)
+{
+    int64_t weight_q16 = (int64_t)(raw - sensor->offset) * sensor->weight_per_count_q16;
+    return (int16_t)((weight_q16 + (1 << 15)) >> 16);
 }
 
-int16_t loadcell_get_weight(loadcell_t *sensor)
+esp_err_t loadcell_get_weight(loadcell_t *sensor, int16_t *weight)
 {
     int32_t raw = loadcell_read_raw(sensor);
-    if (raw == LC_ERROR_CODE) return 0;
+    if (raw == LC_ERROR_CODE) return ESP_ERR_TIMEOUT;
+
+    *weight = loadcell_raw_to_weight(sensor, raw);
+    return ESP_OK;
+}
+
+// Holding SCK high for more than 60 us powers every HX711 down; pulling it low
+// again restarts conversion, with DOUT going low once the output has settled.
+static void drive_sck(loadcell_t *const sensors[], uint8_t count, bool high)
+{
+#if SOC_DEDICATED_GPIO_SUPPORTED
+    if (sensors[0]->backend == LC_BACKEND_DEDIC_GPIO) {
+        uint32_t sck = ((1UL << count) - 1) << s_sck_offset;
+        dedic_gpio_cpu_ll_write_mask(sck, high ? sck : 0);
+        return;
+    }
+#endif
+    pin_mask_t sck = {0};
+
+    for (uint8_t ch = 0; ch < count; ch++) {
+        pin_mask_add(&sck, sensors[ch]->sck_pin);
+    }
+
+    if (high) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, sck.lo);
+        REG_WRITE(GPIO_OUT1_W1TS_REG, sck.hi);
+    } else {
+        REG_WRITE(GPIO_OUT_W1TC_REG, sck.lo);
+        REG_WRITE(GPIO_OUT1_W1TC_REG, sck.hi);
+    }
+}
+
+static void apply_power(bool on)
+{
+    if (on == s_powered) return;
+
+    if (on) {
+        drive_sck(s_async_cells, s_async_count, false);
+        s_powered = true;
+        for (uint8_t ch = 0; ch < s_async_count; ch++) {
+            gpio_intr_enable(s_async_cells[ch]->dout_pin);
+        }
+    } else {
+        for (uint8_t ch = 0; ch < s_async_count; ch++) {
+            gpio_intr_disable(s_async_cells[ch]->dout_pin);
+        }
+        drive_sck(s_async_cells, s_async_count, true);
+        s_powered = false;
+    }
+}
+
+// DOUT is armed as a low-level interrupt: it goes low when a conversion is
+// ready and stays low until clocked out, so a late re-arm can't miss a sample.
+// The line is re-armed while DOUT is high, so the stamp taken here is the
+// moment the conversion finished, not when the frame was clocked out.
+static void IRAM_ATTR dout_isr_handler(void *arg)
+{
+    uint32_t channel = (uint32_t)(uintptr_t)arg;
+    BaseType_t woken = pdFALSE;
+
+    gpio_intr_disable(s_async_cells[channel]->dout_pin);
+    s_ready_us[channel] = esp_timer_get_time();
+    xTaskNotifyFromISR(s_acq_task, 1UL << channel, eSetBits, &woken);
+
+    if (woken) portYIELD_FROM_ISR(woken);
+}
+
+// Cells that become ready are parked until the rest catch up (or the alignment
+// window expires) so they can all be clocked out in the same pass.
+static void task_loadcell_acq(void *pvParameters)
+{
+    const uint32_t all_mask = (1UL << s_async_count) - 1;
+    uint32_t window_us = 0;
+    uint32_t ready = 0;
+    uint32_t notified;
+    int32_t raw[LC_MAX_CHANNELS];
+
+    for (uint8_t ch = 0; ch < s_async_count; ch++) {
+        uint32_t w = s_async_cells[ch]->period_us * LC_ALIGN_WINDOW_PCT / 100;
+        if (w > window_us) window_us = w;
+    }
+    const TickType_t window = pdMS_TO_TICKS(window_us / 1000) + 1;
+
+    trace_register_task(NULL);
+
+    while (1)
+    {
+        BaseType_t got = xTaskNotifyWait(0, UINT32_MAX, &notified, s_powered ? window : portMAX_DELAY);
 
-    float weight = (float)(raw - sensor->offset) * 1000.0f / sensor->scale;
-    return (int16_t)weight;
-}
\ No newline at end of file
+        if (got == pdTRUE && (notified & LC_NOTIFY_POWER)) {
+            notified &= ~LC_NOTIFY_POWER;
+            apply_power(__atomic_load_n(&s_power_request, __ATOMIC_ACQUIRE));
+        }
+        if (!s_powered) {
+            ready = 0;
+            continue;
+        }
+
+        if (got == pdTRUE) ready |= notified;
+
+        if (ready == 0) continue;
+        if (ready != all_mask && got == pdTRUE) continue;
+
+        shift_in_parallel(s_async_cells, s_async_count, ready, raw);
+
+        for (uint8_t ch = 0; ch < s_async_count; ch++)
+        {
+            if (!(ready & (1UL << ch))) continue;
+
+            loadcell_sample_t sample = {
+                .timestamp_us = s_ready_us[ch],
+                .channel = ch,
+                .raw = raw[ch],
+            };
+
+            if (xQueueSend(s_async_queue, &sample, 0) != pdTRUE) {
+                s_async_dropped++;
+            }
+
+            gpio_intr_enable(s_async_cells[ch]->dout_pin);
+        }
+
+        ready = 0;
+    }
+}
+
+esp_err_t loadcell_start_async(loadcell_t *const sensors[], uint8_t count, QueueHandle_t queue)
+{
+    if (count == 0 || count > LC_MAX_CHANNELS || queue == NULL) return ESP_ERR_INVALID_ARG;
+    if (s_acq_task != NULL) return ESP_ERR_INVALID_STATE;
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!sensors[i]->is_initialized) return ESP_ERR_INVALID_STATE;
+        s_async_cells[i] = sensors[i];
+    }
+    s_async_count = count;
+    s_async_queue = queue;
+    s_async_dropped = 0;
+    s_power_request = true;
+    s_powered = true;
+
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        task_loadcell_acq, "LoadcellAcq", LC_ACQ_TASK_STACK,
+        NULL, LC_ACQ_TASK_PRIO, &s_acq_task, LC_ACQ_TASK_CORE
+    );
+    if (ret != pdPASS) {
+        s_acq_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t status = gpio_install_isr_service(0);
+    if (status != ESP_OK && status != ESP_ERR_INVALID_STATE) {
+        loadcell_stop_async();
+        return status;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        gpio_num_t pin = s_async_cells[i]->dout_pin;
+        gpio_set_intr_type(pin, GPIO_INTR_LOW_LEVEL);
+        status = gpio_isr_handler_add(pin, dout_isr_handler, (void *)(uintptr_t)i);
+        if (status != ESP_OK) {
+            loadcell_stop_async();
+            return status;
+        }
+        gpio_intr_enable(pin);
+    }
+
+    return ESP_OK;
+}
+
+void loadcell_stop_async(void)
+{
+    for (uint8_t i = 0; i < s_async_count; i++) {
+        gpio_num_t pin = s_async_cells[i]->dout_pin;
+        gpio_intr_disable(pin);
+        gpio_set_intr_type(pin, GPIO_INTR_DISABLE);
+        gpio_isr_handler_remove(pin);
+    }
+
+    if (s_acq_task != NULL) {
+        vTaskDelete(s_acq_task);
+        s_acq_task = NULL;
+    }
+
+    s_async_count = 0;
+    s_async_queue = NULL;
+}
+
+uint32_t loadcell_async_dropped(void)
+{
+    return s_async_dropped;
+}
+
+// The SCK lines may be driven through a dedicated GPIO bundle bound to the
+// acquisition core, so the change is applied by the acquisition task.
+void loadcell_set_power(bool on)
+{
+    if (s_acq_task == NULL) return;
+
+    __atomic_store_n(&s_power_request, on, __ATOMIC_RELEASE);
+    xTaskNotify(s_acq_task, LC_NOTIFY_POWER, eSetBits);
+}
+
+bool loadcell_is_powered(void)
+{
+    return s_powered;
+}
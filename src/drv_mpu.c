@@ -1,24 +1,100 @@
 #include "drv_mpu.h"
 #include <string.h>
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "esp_timer.h"
+#include "trace.h"
+
+// The two devices share the MPU's single CS line, and the GPIO matrix routes a
+// hardware CS pin to one device only, so CS is driven by hand around every
+// transaction. t->user carries the device.
+static void IRAM_ATTR cs_select(spi_transaction_t *t)
+{
+    const MPU9250_t *dev = (const MPU9250_t *)t->user;
+
+    if (dev->cs_pin < 32) REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << dev->cs_pin);
+    else                  REG_WRITE(GPIO_OUT1_W1TC_REG, 1UL << (dev->cs_pin - 32));
+}
+
+static void IRAM_ATTR cs_release(spi_transaction_t *t)
+{
+    const MPU9250_t *dev = (const MPU9250_t *)t->user;
+
+    if (dev->cs_pin < 32) REG_WRITE(GPIO_OUT_W1TS_REG, 1UL << dev->cs_pin);
+    else                  REG_WRITE(GPIO_OUT1_W1TS_REG, 1UL << (dev->cs_pin - 32));
+}
+
+static esp_err_t add_device(MPU9250_t *dev, int clock_hz, spi_device_handle_t *handle)
+{
+    spi_device_interface_config_t devcfg = {
+        .clock_speed_hz = clock_hz,
+        .mode = 0,
+        .spics_io_num = -1,
+        .queue_size = MPU_SPI_QUEUE_SIZE,
+        .pre_cb = cs_select,
+        .post_cb = cs_release,
+    };
+
+    return spi_bus_add_device(dev->host, &devcfg, handle);
+}
+
+// The MPU9250 only accepts 20 MHz for sensor and interrupt register reads and
+// the SPI master has no per-transaction clock, so it is attached twice: once
+// at the 1 MHz configuration clock and once at the read clock.
+esp_err_t mpu_attach(MPU9250_t *dev, spi_host_device_t host, gpio_num_t cs_pin)
+{
+    dev->host = host;
+    dev->cs_pin = cs_pin;
+    dev->fast_reads = false;
+    dev->async_pending = 0;
+
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_DISABLE,
+        .mode = GPIO_MODE_OUTPUT,
+        .pin_bit_mask = (1ULL << cs_pin),
+        .pull_down_en = 0,
+        .pull_up_en = 0,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) return ret;
+    gpio_set_level(cs_pin, 1);
+
+    ret = add_device(dev, MPU_SPI_CLOCK_CONFIG_HZ, &dev->spi_config);
+    if (ret != ESP_OK) return ret;
+
+    ret = add_device(dev, MPU_SPI_CLOCK_READ_HZ, &dev->spi_read);
+    if (ret != ESP_OK) {
+        spi_bus_remove_device(dev->spi_config);
+        dev->spi_config = NULL;
+    }
+    return ret;
+}
+
+static inline bool is_fast_read_reg(uint8_t regAddress)
+{
+    return (regAddress >= MPU_REG_INT_STATUS && regAddress <= MPU_REG_EXT_SENS_LAST)
+        || (regAddress >= MPU_REG_FIFO_COUNTH && regAddress <= MPU_REG_FIFO_R_W);
+}
+
+static inline spi_device_handle_t read_handle(const MPU9250_t *dev, uint8_t regAddress)
+{
+    return (dev->fast_reads && is_fast_read_reg(regAddress)) ? dev->spi_read : dev->spi_config;
+}
 
 esp_err_t spi_write_byte(MPU9250_t *dev, uint8_t regAddress, uint8_t data)
 {
-    esp_err_t ret;
     spi_transaction_t t;
     memset(&t, 0, sizeof(t));
 
     regAddress &= 0x7F;
 
-    uint8_t tx_data[2] = {regAddress, data};
-
+    t.flags = SPI_TRANS_USE_TXDATA;
     t.length = 8 * 2;
-    t.tx_buffer = tx_data;
+    t.tx_data[0] = regAddress;
+    t.tx_data[1] = data;
+    t.user = dev;
 
-    gpio_set_level(dev->cs_pin, 0);
-    ret = spi_device_transmit(dev->spi_handle, &t);
-    gpio_set_level(dev->cs_pin, 1);
-
-    return ret;
+    return spi_device_polling_transmit(dev->spi_config, &t);
 }
 
 esp_err_t spi_read_byte(MPU9250_t *dev, uint8_t regAddress, uint8_t *data)
@@ -27,64 +103,125 @@ esp_err_t spi_read_byte(MPU9250_t *dev, uint8_t regAddress, uint8_t *data)
     spi_transaction_t t;
     memset(&t, 0, sizeof(t));
 
-    regAddress |= MPU_READ;
-
-    uint8_t tx_data[2] = {regAddress, 0x00};
-    uint8_t rx_data[2] = {0};
-
+    t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
     t.length = 8 * 2;
-    t.tx_buffer = tx_data;
-    t.rx_buffer = rx_data;
+    t.tx_data[0] = regAddress | MPU_READ;
+    t.user = dev;
 
-    gpio_set_level(dev->cs_pin, 0);
-    ret = spi_device_transmit(dev->spi_handle, &t);
-    gpio_set_level(dev->cs_pin, 1);
+    ret = spi_device_polling_transmit(read_handle(dev, regAddress), &t);
 
     if (ret == ESP_OK) {
-        *data = rx_data[1];
+        *data = t.rx_data[1];
     }
 
     return ret;
 }
 
-esp_err_t spi_burst_read(MPU9250_t *dev, uint8_t regAddress, uint8_t *buffer, uint16_t length)
+// Reads into the device's persistent DMA buffer and returns a pointer to the
+// payload, valid until the next transaction on this device. The burst is
+// padded to a whole number of words, so the registers after the payload
+// must be safe to read; a FIFO drain sizes its length to need no padding.
+static esp_err_t spi_burst_read_dma(MPU9250_t *dev, uint8_t regAddress, uint16_t length, const uint8_t **payload)
 {
     esp_err_t ret;
     spi_transaction_t t;
     memset(&t, 0, sizeof(t));
 
-    regAddress |= MPU_READ;
+    if (dev->dma_tx == NULL || dev->dma_rx == NULL) return ESP_ERR_INVALID_STATE;
+    if (MPU_DMA_LEN(length) > MPU_DMA_BUF_SIZE) return ESP_ERR_INVALID_SIZE;
 
-    uint8_t *tx_buf = heap_caps_malloc(length + 1, MALLOC_CAP_DMA);
-    uint8_t *rx_buf = heap_caps_malloc(length + 1, MALLOC_CAP_DMA);
+    dev->dma_tx[0] = regAddress | MPU_READ;
 
-    if (!tx_buf || !rx_buf) {
-        if (tx_buf) free(tx_buf);
-        if (rx_buf) free(rx_buf);
-        return ESP_ERR_NO_MEM;
+    t.length = 8 * MPU_DMA_LEN(length);
+    t.tx_buffer = dev->dma_tx;
+    t.rx_buffer = dev->dma_rx;
+    t.user = dev;
+
+    ret = spi_device_polling_transmit(read_handle(dev, regAddress), &t);
+
+    if (ret == ESP_OK) {
+        *payload = &dev->dma_rx[1];
     }
 
-    memset(tx_buf, 0, length + 1);
-    tx_buf[0] = regAddress;
+    return ret;
+}
+
+// Short reads fit the transaction's own rx_data and take no DMA at all; the
+// FIFO count must be read that way, as padding it would pop FIFO_R_W.
+esp_err_t spi_burst_read(MPU9250_t *dev, uint8_t regAddress, uint8_t *buffer, uint16_t length)
+{
+    const uint8_t *payload;
 
-    t.length = 8 * (length + 1);
-    t.tx_buffer = tx_buf;
-    t.rx_buffer = rx_buf;
+    if (length < 4) {
+        spi_transaction_t t;
+        memset(&t, 0, sizeof(t));
 
-    gpio_set_level(dev->cs_pin, 0);
-    ret = spi_device_transmit(dev->spi_handle, &t);
-    gpio_set_level(dev->cs_pin, 1);
+        t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+        t.length = 8 * (length + 1);
+        t.tx_data[0] = regAddress | MPU_READ;
+        t.user = dev;
 
-    if (ret == ESP_OK) {
-        memcpy(buffer, &rx_buf[1], length);
+        esp_err_t ret = spi_device_polling_transmit(read_handle(dev, regAddress), &t);
+        if (ret == ESP_OK) memcpy(buffer, &t.rx_data[1], length);
+        return ret;
     }
 
-    free(tx_buf);
-    free(rx_buf);
+    esp_err_t ret = spi_burst_read_dma(dev, regAddress, length, &payload);
+    if (ret == ESP_OK) {
+        memcpy(buffer, payload, length);
+    }
 
     return ret;
 }
 
+static esp_err_t alloc_dma_buffers(MPU9250_t *dev)
+{
+    if (dev->dma_tx == NULL) {
+        dev->dma_tx = heap_caps_aligned_calloc(4, 1, MPU_DMA_BUF_SIZE, MALLOC_CAP_DMA);
+        if (dev->dma_tx != NULL) dev->dma_allocs++;
+    }
+    if (dev->dma_rx == NULL) {
+        dev->dma_rx = heap_caps_aligned_calloc(4, 1, MPU_DMA_BUF_SIZE, MALLOC_CAP_DMA);
+        if (dev->dma_rx != NULL) dev->dma_allocs++;
+    }
+    if (dev->async_buf == NULL) {
+        dev->async_buf = heap_caps_aligned_calloc(4, 3, MPU_ASYNC_BUF_SIZE, MALLOC_CAP_DMA);
+        if (dev->async_buf != NULL) dev->dma_allocs++;
+    }
+
+    return (dev->dma_tx && dev->dma_rx && dev->async_buf) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+uint32_t mpu_dma_allocs(const MPU9250_t *dev)
+{
+    return dev->dma_allocs;
+}
+
+size_t mpu_dma_heap_watermark(void)
+{
+    return heap_caps_get_minimum_free_size(MALLOC_CAP_DMA);
+}
+
+void mpu_deinit(MPU9250_t *dev)
+{
+    if (dev->fifo_task != NULL) {
+        mpu_fifo_stop(dev);
+    }
+
+    while (dev->async_pending) {
+        spi_transaction_t *done;
+        if (spi_device_get_trans_result(dev->spi_read, &done, pdMS_TO_TICKS(MPU_TIME_OUT)) != ESP_OK) break;
+        dev->async_pending--;
+    }
+
+    heap_caps_free(dev->dma_tx);
+    heap_caps_free(dev->dma_rx);
+    heap_caps_free(dev->async_buf);
+    dev->dma_tx = NULL;
+    dev->dma_rx = NULL;
+    dev->async_buf = NULL;
+}
+
 static esp_err_t check_connection(MPU9250_t *dev)
 {
     esp_err_t status;
@@ -96,16 +233,110 @@ static esp_err_t check_connection(MPU9250_t *dev)
     return ESP_OK;
 }
 
+static esp_err_t write_seq(MPU9250_t *dev, const uint8_t (*seq)[2], size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        esp_err_t status = spi_write_byte(dev, seq[i][0], seq[i][1]);
+        if (status != ESP_OK) return status;
+    }
+    return ESP_OK;
+}
+
+// The AK8963 sits behind the MPU9250's own I2C master, so every access is a
+// slave-0 transaction that only runs on the next internal sample tick.
+static esp_err_t ak_write(MPU9250_t *dev, uint8_t reg, uint8_t value)
+{
+    const uint8_t seq[][2] = {
+        { MPU_REG_I2C_SLV0_ADDR, AK8963_I2C_ADDR },
+        { MPU_REG_I2C_SLV0_REG,  reg },
+        { MPU_REG_I2C_SLV0_DO,   value },
+        { MPU_REG_I2C_SLV0_CTRL, I2C_SLV_EN | 1 },
+    };
+
+    esp_err_t status = write_seq(dev, seq, sizeof(seq) / sizeof(seq[0]));
+    vTaskDelay(pdMS_TO_TICKS(AK8963_SETTLE_MS));
+    return status;
+}
+
+static esp_err_t ak_read(MPU9250_t *dev, uint8_t reg, uint8_t *data, uint8_t len)
+{
+    const uint8_t seq[][2] = {
+        { MPU_REG_I2C_SLV0_ADDR, AK8963_I2C_ADDR | I2C_SLV_READ },
+        { MPU_REG_I2C_SLV0_REG,  reg },
+        { MPU_REG_I2C_SLV0_CTRL, I2C_SLV_EN | len },
+    };
+
+    esp_err_t status = write_seq(dev, seq, sizeof(seq) / sizeof(seq[0]));
+    if (status != ESP_OK) return status;
+
+    vTaskDelay(pdMS_TO_TICKS(AK8963_SETTLE_MS));
+    return spi_burst_read(dev, MPU_REG_EXT_SENS_DATA, data, len);
+}
+
+// Leaves slave 0 reading HXL..ST2 on every sample, so the mag lands in
+// EXT_SENS_DATA right after the gyro and comes along in the same burst.
+// Reading ST2 is what releases the AK8963's next measurement.
+static esp_err_t mag_init(MPU9250_t *dev)
+{
+    uint8_t wia;
+
+    dev->user_ctrl = USER_CTRL_I2C_IF_DIS | USER_CTRL_I2C_MST_EN;
+    esp_err_t status = spi_write_byte(dev, MPU_REG_USER_CTRL, dev->user_ctrl);
+    if (status != ESP_OK) return status;
+
+    status = spi_write_byte(dev, MPU_REG_I2C_MST_CTRL, I2C_MST_WAIT_FOR_ES | I2C_MST_CLK_400KHZ);
+    if (status != ESP_OK) return status;
+
+    status = ak_write(dev, AK8963_REG_CNTL2, AK8963_CNTL2_SRST);
+    if (status != ESP_OK) return status;
+
+    status = ak_read(dev, AK8963_REG_WIA, &wia, 1);
+    if (status != ESP_OK) return status;
+    if (wia != AK8963_WIA_VALUE) return ESP_ERR_NOT_FOUND;
+
+    status = ak_write(dev, AK8963_REG_CNTL1, AK8963_CNTL1_FUSE_ROM);
+    if (status != ESP_OK) return status;
+
+    status = ak_read(dev, AK8963_REG_ASAX, dev->mag_asa, sizeof(dev->mag_asa));
+    if (status != ESP_OK) return status;
+
+    status = ak_write(dev, AK8963_REG_CNTL1, AK8963_CNTL1_POWER_DOWN);
+    if (status != ESP_OK) return status;
+
+    status = ak_write(dev, AK8963_REG_CNTL1, AK8963_CNTL1_CONT_100HZ_16BIT);
+    if (status != ESP_OK) return status;
+
+    const uint8_t seq[][2] = {
+        { MPU_REG_I2C_SLV0_ADDR, AK8963_I2C_ADDR | I2C_SLV_READ },
+        { MPU_REG_I2C_SLV0_REG,  AK8963_REG_HXL },
+        { MPU_REG_I2C_SLV0_CTRL, I2C_SLV_EN | AK8963_DATA_LEN },
+    };
+    return write_seq(dev, seq, sizeof(seq) / sizeof(seq[0]));
+}
+
 esp_err_t mpu_init(MPU9250_t *dev)
 {
     dev->accel_sens = ACCEL_SENSITIVITY;
     dev->gyro_sens = GYRO_SENSITIVITY;
     dev->data_ready = false;
+    dev->fifo_task = NULL;
+    dev->wom_request = MPU_WOM_NONE;
+    dev->wom_active = false;
+    dev->mag_present = false;
+    dev->mag_valid = false;
+    dev->frame_size = MPU_FRAME_BASE;
+    dev->fifo_en = FIFO_EN_ACCEL_GYRO | FIFO_EN_TEMP;
+    dev->user_ctrl = USER_CTRL_I2C_IF_DIS;
     for (int i = 0; i < 3; i++) {
         dev->accel_ma[i] = 0;
+        dsp_median_init(&dev->accel_median[i], MPU_MEDIAN_N, 0);
+        dsp_ema_init(&dev->accel_ema[i], ALPHA_Q15, 0);
     }
 
-    esp_err_t status = check_connection(dev);
+    esp_err_t status = alloc_dma_buffers(dev);
+    if (status != ESP_OK) return status;
+
+    status = check_connection(dev);
     if (status != ESP_OK) return status;
 
     status = spi_write_byte(dev, MPU_REG_PWR_MGMT_1, RESET_DEVICE);
@@ -131,25 +362,126 @@ esp_err_t mpu_init(MPU9250_t *dev)
     status = spi_write_byte(dev, MPU_REG_SMPLRT_DIV, SMPLRT_DIV);
     if (status != ESP_OK) return status;
 
+    dev->fast_reads = true;
+
+    if (mag_init(dev) == ESP_OK) {
+        dev->mag_present = true;
+        dev->frame_size = MPU_FRAME_MAG;
+        dev->fifo_en |= FIFO_EN_SLV0;
+    } else {
+        dev->user_ctrl = USER_CTRL_I2C_IF_DIS;
+        spi_write_byte(dev, MPU_REG_I2C_SLV0_CTRL, 0x00);
+        spi_write_byte(dev, MPU_REG_USER_CTRL, dev->user_ctrl);
+    }
+
     return ESP_OK;
 }
 
-esp_err_t mpu_read_all(MPU9250_t *dev)
+static void convert_accel(MPU9250_t *dev)
 {
-    uint8_t buffer[BUFFER_SIZE];
+    for (int i = 0; i < 3; i++) {
+        int64_t temp_a = ((int64_t)dev->accel_raw[i] - dev->accel_bias[i]) * 1000;
+        dev->accel_mg[i] = (int32_t)(temp_a / dev->accel_sens);
+    }
+}
 
-    if (spi_burst_read(dev, MPU_REG_ACCEL_XOUT_H, buffer, BUFFER_SIZE) != ESP_OK) {
-        return ESP_FAIL;
+static void convert_gyro(MPU9250_t *dev)
+{
+    for (int i = 0; i < 3; i++) {
+        dev->gyro_mdps[i] = (int32_t)((int64_t)dev->gyro_raw[i] * 1000 / dev->gyro_sens);
     }
+    dev->temp_cdeg = (int32_t)dev->temp_raw * 10000 / MPU_TEMP_SENS_X100 + MPU_TEMP_OFFSET_CDEG;
+}
+
+static inline int16_t be16(const uint8_t *p)
+{
+    return (int16_t)(p[0] << 8 | p[1]);
+}
 
-    dev->accel_raw[0] = (int16_t)(buffer[0] << 8 | buffer[1]);
-    dev->accel_raw[1] = (int16_t)(buffer[2] << 8 | buffer[3]);
-    dev->accel_raw[2] = (int16_t)(buffer[4] << 8 | buffer[5]);
+static inline int16_t mag_adjust(const uint8_t *p, uint8_t asa)
+{
+    int32_t v = ((int32_t)(int16_t)(p[1] << 8 | p[0]) * (asa + 128)) >> 8;
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
 
+// The AK8963 is little endian and its X/Y axes are swapped and Z inverted
+// relative to the accel/gyro, so the mag is rotated here once.
+static void decode_frame(const MPU9250_t *dev, const uint8_t *f, mpu_sample_t *s)
+{
     for (int i = 0; i < 3; i++) {
-        int64_t temp_a = (int64_t)dev->accel_raw[i] * 1000;
-        dev->accel_mg[i] = (int32_t)(temp_a / dev->accel_sens);
+        s->accel[i] = be16(&f[2 * i]);
+        s->gyro[i] = be16(&f[8 + 2 * i]);
+    }
+    s->temp = be16(&f[6]);
+
+    s->mag_valid = false;
+    if (dev->mag_present) {
+        const uint8_t *m = &f[MPU_FRAME_BASE];
+        s->mag[0] = mag_adjust(&m[2], dev->mag_asa[1]);
+        s->mag[1] = mag_adjust(&m[0], dev->mag_asa[0]);
+        s->mag[2] = (int16_t)-mag_adjust(&m[4], dev->mag_asa[2]);
+        s->mag_valid = !(m[6] & AK8963_ST2_HOFL);
     }
+}
+
+esp_err_t mpu_read_all(MPU9250_t *dev)
+{
+    TRACE_SCOPE(TRACE_MPU_READ);
+    const uint8_t *buffer;
+    int64_t t = esp_timer_get_time();
+
+    if (spi_burst_read_dma(dev, MPU_REG_ACCEL_XOUT_H, dev->frame_size, &buffer) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    decode_frame(dev, buffer, &dev->poll_sample);
+    dev->poll_sample.timestamp_us = t;
+    mpu_apply_sample(dev, &dev->poll_sample);
+
+    return ESP_OK;
+}
+
+esp_err_t mpu_read_async_start(MPU9250_t *dev)
+{
+    if (dev->async_buf == NULL) return ESP_ERR_INVALID_STATE;
+    if (dev->async_pending >= MPU_SPI_QUEUE_SIZE) return ESP_ERR_INVALID_STATE;
+
+    uint8_t *tx = dev->async_buf;
+    uint8_t *rx = dev->async_buf + MPU_ASYNC_BUF_SIZE * (1 + dev->async_slot);
+    spi_transaction_t *t = &dev->async_trans[dev->async_slot];
+
+    memset(t, 0, sizeof(*t));
+    tx[0] = MPU_REG_ACCEL_XOUT_H | MPU_READ;
+    t->length = 8 * MPU_DMA_LEN(dev->frame_size);
+    t->tx_buffer = tx;
+    t->rx_buffer = rx;
+    t->user = dev;
+
+    dev->async_time_us[dev->async_slot] = esp_timer_get_time();
+    esp_err_t ret = spi_device_queue_trans(dev->spi_read, t, 0);
+    if (ret != ESP_OK) return ret;
+
+    dev->async_slot ^= 1;
+    dev->async_pending++;
+    return ESP_OK;
+}
+
+esp_err_t mpu_read_async_finish(MPU9250_t *dev, TickType_t wait)
+{
+    TRACE_SCOPE(TRACE_MPU_READ);
+    spi_transaction_t *done;
+
+    if (dev->async_pending == 0) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = spi_device_get_trans_result(dev->spi_read, &done, wait);
+    if (ret != ESP_OK) return ret;
+
+    dev->async_pending--;
+    decode_frame(dev, (const uint8_t *)done->rx_buffer + 1, &dev->poll_sample);
+    dev->poll_sample.timestamp_us = dev->async_time_us[done - dev->async_trans];
+    mpu_apply_sample(dev, &dev->poll_sample);
 
     return ESP_OK;
 }
@@ -157,7 +489,305 @@ esp_err_t mpu_read_all(MPU9250_t *dev)
 void moving_average(MPU9250_t *dev)
 {
     for (int i = 0; i < 3; i++) {
-        dev->accel_ma[i] = (int32_t)(ALPHA * dev->accel_mg[i] + (1.0f - ALPHA) * dev->accel_ma[i]);
+        int32_t x = dsp_median_update(&dev->accel_median[i], dev->accel_mg[i]);
+        dev->accel_ma[i] = dsp_ema_update(&dev->accel_ema[i], x);
     }
     dev->data_ready = true;
-}
\ No newline at end of file
+}
+
+void mpu_apply_sample(MPU9250_t *dev, const mpu_sample_t *sample)
+{
+    memcpy(dev->accel_raw, sample->accel, sizeof(dev->accel_raw));
+    for (int i = 0; i < 3; i++) {
+        dev->gyro_raw[i] = (int16_t)(sample->gyro[i] - dev->gyro_bias[i]);
+    }
+    dev->temp_raw = sample->temp;
+    dev->mag_valid = sample->mag_valid;
+    if (sample->mag_valid) memcpy(dev->mag_raw, sample->mag, sizeof(dev->mag_raw));
+
+    convert_accel(dev);
+    convert_gyro(dev);
+    dev->sample_time_us = sample->timestamp_us;
+}
+
+void mpu_set_bias(MPU9250_t *dev, const int16_t accel_bias[3], const int16_t gyro_bias[3])
+{
+    memcpy(dev->accel_bias, accel_bias, sizeof(dev->accel_bias));
+    memcpy(dev->gyro_bias, gyro_bias, sizeof(dev->gyro_bias));
+}
+
+bool mpu_fifo_pop(MPU9250_t *dev, mpu_sample_t *sample)
+{
+    return spsc_ring_pop(&dev->ring, sample);
+}
+
+static esp_err_t fifo_reset(MPU9250_t *dev)
+{
+    dev->fifo_carry_len = 0;
+    esp_err_t status = spi_write_byte(dev, MPU_REG_USER_CTRL, dev->user_ctrl | USER_CTRL_FIFO_RST);
+    if (status != ESP_OK) return status;
+    return spi_write_byte(dev, MPU_REG_USER_CTRL, dev->user_ctrl | USER_CTRL_FIFO_EN);
+}
+
+// The ISR and the drain task can run on different cores and drdy_time_us is
+// 64-bit, so the stamp and the count are only touched under this lock.
+static portMUX_TYPE s_drdy_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// The MPU9250 has no FIFO watermark interrupt, so the INT pin is configured for
+// raw data ready and the ISR counts samples, waking the drain task once
+// MPU_FIFO_WATERMARK frames have accumulated.
+static void IRAM_ATTR mpu_int_isr_handler(void *arg)
+{
+    MPU9250_t *dev = (MPU9250_t *)arg;
+    BaseType_t woken = pdFALSE;
+
+    if (dev->wom_active) {
+        dev->motion_time_us = esp_timer_get_time();
+        if (dev->motion_cb) dev->motion_cb(dev->motion_ctx, &woken);
+        if (woken) portYIELD_FROM_ISR(woken);
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    bool drain = false;
+
+    portENTER_CRITICAL_ISR(&s_drdy_lock);
+    dev->drdy_time_us = now;
+    if (++dev->drdy_count >= MPU_FIFO_WATERMARK) {
+        dev->drdy_count = 0;
+        drain = true;
+    }
+    portEXIT_CRITICAL_ISR(&s_drdy_lock);
+
+    if (drain) vTaskNotifyGiveFromISR(dev->fifo_task, &woken);
+
+    if (woken) portYIELD_FROM_ISR(woken);
+}
+
+static esp_err_t fifo_drain(MPU9250_t *dev)
+{
+    TRACE_SCOPE(TRACE_MPU_FIFO_DRAIN);
+    uint8_t count_buf[2];
+    uint8_t status;
+    const uint8_t *frames;
+
+    portENTER_CRITICAL(&s_drdy_lock);
+    int64_t newest_us = dev->drdy_time_us;
+    portEXIT_CRITICAL(&s_drdy_lock);
+
+    if (spi_read_byte(dev, MPU_REG_INT_STATUS, &status) != ESP_OK) return ESP_FAIL;
+
+    if (status & INT_STATUS_FIFO_OFLOW) {
+        dev->fifo_overflows++;
+        return fifo_reset(dev);
+    }
+
+    if (spi_burst_read(dev, MPU_REG_FIFO_COUNTH, count_buf, sizeof(count_buf)) != ESP_OK) return ESP_FAIL;
+
+    // Padding would pop bytes off the FIFO, so the drain takes the most bytes
+    // that make a whole number of words with the command byte. A frame cut
+    // short is kept in fifo_carry and completed by the next drain.
+    uint16_t count = (uint16_t)((count_buf[0] & 0x1F) << 8 | count_buf[1]);
+    if (count < 3) return ESP_OK;
+
+    uint16_t length = count - ((count + 1) & 3);
+    uint16_t avail = (dev->fifo_carry_len + count) / dev->frame_size;
+    if (spi_burst_read_dma(dev, MPU_REG_FIFO_R_W, length, &frames) != ESP_OK) return ESP_FAIL;
+
+    const uint8_t *p = frames, *end = frames + length;
+    for (uint16_t k = 0; p < end; k++) {
+        const uint8_t *f;
+        mpu_sample_t sample;
+
+        if (dev->fifo_carry_len == 0 && end - p >= dev->frame_size) {
+            f = p;
+            p += dev->frame_size;
+        } else {
+            uint16_t take = dev->frame_size - dev->fifo_carry_len;
+            if (take > end - p) take = (uint16_t)(end - p);
+            memcpy(&dev->fifo_carry[dev->fifo_carry_len], p, take);
+            dev->fifo_carry_len += take;
+            p += take;
+            if (dev->fifo_carry_len < dev->frame_size) break;
+            f = dev->fifo_carry;
+            dev->fifo_carry_len = 0;
+        }
+
+        decode_frame(dev, f, &sample);
+        sample.timestamp_us = newest_us - (int64_t)(avail - 1 - k) * MPU_SAMPLE_PERIOD_US;
+        spsc_ring_push(&dev->ring, &sample);
+    }
+
+    return ESP_OK;
+}
+
+// Low-power accel cycling with the wake-on-motion comparator on INT, per the
+// MPU9250 datasheet sequence. The gyro and FIFO are stopped meanwhile.
+static esp_err_t wom_enter(MPU9250_t *dev)
+{
+    static const uint8_t seq[][2] = {
+        { MPU_REG_INT_ENABLE,      0x00 },
+        { MPU_REG_FIFO_EN,         0x00 },
+        { MPU_REG_PWR_MGMT_1,      WAKE_UP },
+        { MPU_REG_PWR_MGMT_2,      PWR_MGMT_2_DIS_GYRO },
+        { MPU_REG_ACCEL_CONFIG_2,  ACCEL_CONFIG_2_LP },
+        { MPU_REG_MOT_DETECT_CTRL, MOT_DETECT_INTEL },
+        { MPU_REG_WOM_THR,         MPU_WOM_THRESHOLD_MG / 4 },
+        { MPU_REG_LP_ACCEL_ODR,    MPU_WOM_LP_ODR },
+    };
+
+    esp_err_t status = write_seq(dev, seq, sizeof(seq) / sizeof(seq[0]));
+    if (status != ESP_OK) return status;
+
+    dev->wom_active = true;
+
+    status = spi_write_byte(dev, MPU_REG_INT_ENABLE, INT_ENABLE_WOM);
+    if (status != ESP_OK) return status;
+
+    return spi_write_byte(dev, MPU_REG_PWR_MGMT_1, WAKE_UP | PWR_CYCLE);
+}
+
+static esp_err_t wom_exit(MPU9250_t *dev)
+{
+    static const uint8_t seq[][2] = {
+        { MPU_REG_INT_ENABLE,      0x00 },
+        { MPU_REG_PWR_MGMT_1,      WAKE_UP },
+        { MPU_REG_PWR_MGMT_2,      0x00 },
+        { MPU_REG_MOT_DETECT_CTRL, 0x00 },
+        { MPU_REG_ACCEL_CONFIG_2,  BANDWIDTH },
+    };
+
+    esp_err_t status = write_seq(dev, seq, sizeof(seq) / sizeof(seq[0]));
+    dev->wom_active = false;
+    if (status != ESP_OK) return status;
+
+    status = spi_write_byte(dev, MPU_REG_FIFO_EN, dev->fifo_en);
+    if (status != ESP_OK) return status;
+
+    status = fifo_reset(dev);
+    if (status != ESP_OK) return status;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_drdy_lock);
+    dev->drdy_count = 0;
+    dev->drdy_time_us = now;
+    portEXIT_CRITICAL(&s_drdy_lock);
+
+    return spi_write_byte(dev, MPU_REG_INT_ENABLE, INT_ENABLE_RAW_RDY);
+}
+
+// The drain task owns the SPI device once the FIFO is running, so mode
+// changes are handed to it rather than written from the caller's task.
+static void task_mpu_fifo(void *pvParameters)
+{
+    MPU9250_t *dev = (MPU9250_t *)pvParameters;
+
+    trace_register_task(NULL);
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, dev->wom_active ? portMAX_DELAY
+                                                 : pdMS_TO_TICKS(MPU_TIME_OUT * MPU_FIFO_WATERMARK));
+
+        uint8_t req = __atomic_exchange_n(&dev->wom_request, MPU_WOM_NONE, __ATOMIC_ACQ_REL);
+        if (req == MPU_WOM_ENTER && !dev->wom_active) {
+            wom_enter(dev);
+        } else if (req == MPU_WOM_EXIT && dev->wom_active) {
+            wom_exit(dev);
+        }
+
+        if (!dev->wom_active) fifo_drain(dev);
+    }
+}
+
+esp_err_t mpu_fifo_start(MPU9250_t *dev, gpio_num_t int_pin)
+{
+    if (dev->fifo_task != NULL) return ESP_ERR_INVALID_STATE;
+
+    int64_t now = esp_timer_get_time();
+    dev->int_pin = int_pin;
+    portENTER_CRITICAL(&s_drdy_lock);
+    dev->drdy_count = 0;
+    dev->drdy_time_us = now;
+    portEXIT_CRITICAL(&s_drdy_lock);
+    dev->fifo_overflows = 0;
+    spsc_ring_init(&dev->ring, dev->ring_buf, sizeof(mpu_sample_t), MPU_RING_LEN);
+
+    esp_err_t status = spi_write_byte(dev, MPU_REG_CONFIG, BANDWIDTH | CONFIG_FIFO_MODE_STOP);
+    if (status != ESP_OK) return status;
+
+    status = spi_write_byte(dev, MPU_REG_FIFO_EN, dev->fifo_en);
+    if (status != ESP_OK) return status;
+
+    status = fifo_reset(dev);
+    if (status != ESP_OK) return status;
+
+    BaseType_t ret = xTaskCreatePinnedToCore(
+        task_mpu_fifo, "MpuFifo", MPU_FIFO_TASK_STACK,
+        dev, MPU_FIFO_TASK_PRIO, &dev->fifo_task, MPU_FIFO_TASK_CORE
+    );
+    if (ret != pdPASS) {
+        dev->fifo_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_POSEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << int_pin),
+        .pull_down_en = 0,
+        .pull_up_en = 0,
+    };
+    gpio_config(&io_conf);
+
+    status = gpio_install_isr_service(0);
+    if (status != ESP_OK && status != ESP_ERR_INVALID_STATE) {
+        mpu_fifo_stop(dev);
+        return status;
+    }
+
+    status = gpio_isr_handler_add(int_pin, mpu_int_isr_handler, dev);
+    if (status != ESP_OK) {
+        mpu_fifo_stop(dev);
+        return status;
+    }
+
+    status = spi_write_byte(dev, MPU_REG_INT_ENABLE, INT_ENABLE_RAW_RDY);
+    if (status != ESP_OK) {
+        mpu_fifo_stop(dev);
+        return status;
+    }
+
+    return ESP_OK;
+}
+
+void mpu_fifo_stop(MPU9250_t *dev)
+{
+    gpio_isr_handler_remove(dev->int_pin);
+
+    if (dev->fifo_task != NULL) {
+        vTaskDelete(dev->fifo_task);
+        dev->fifo_task = NULL;
+    }
+
+    spi_write_byte(dev, MPU_REG_INT_ENABLE, 0x00);
+    spi_write_byte(dev, MPU_REG_FIFO_EN, 0x00);
+    spi_write_byte(dev, MPU_REG_USER_CTRL, dev->user_ctrl);
+}
+
+void mpu_set_motion_cb(MPU9250_t *dev, mpu_motion_cb_t cb, void *ctx)
+{
+    dev->motion_ctx = ctx;
+    dev->motion_cb = cb;
+}
+
+// Wake-on-motion needs the INT line, so it is only available with the FIFO
+// running. Takes effect asynchronously on the drain task.
+esp_err_t mpu_set_wake_on_motion(MPU9250_t *dev, bool enable)
+{
+    if (dev->fifo_task == NULL) return ESP_ERR_NOT_SUPPORTED;
+
+    __atomic_store_n(&dev->wom_request, enable ? MPU_WOM_ENTER : MPU_WOM_EXIT, __ATOMIC_RELEASE);
+    xTaskNotifyGive(dev->fifo_task);
+    return ESP_OK;
+}
@@ -0,0 +1,96 @@
+#include "dsp_fft.h"
+
+#define FFT_M       (DSP_FFT_N / 2)
+#define FFT_QUARTER (DSP_FFT_N / 4)
+
+// sin(2*pi*i/N) for the first quadrant in Q15; the rest is folded by symmetry.
+const int16_t dsp_fft_sin_q15[DSP_FFT_N / 4 + 1] = {
+        0,   804,  1608,  2411,  3212,  4011,  4808,  5602,
+     6393,  7180,  7962,  8740,  9512, 10279, 11039, 11793,
+    12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+    18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+    23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791,
+    27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+    30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972,
+    32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+    32767,
+};
+
+static inline int32_t sin_q15(uint32_t i)
+{
+    i &= DSP_FFT_N - 1;
+    if (i <= FFT_QUARTER) return dsp_fft_sin_q15[i];
+    if (i <= 2 * FFT_QUARTER) return dsp_fft_sin_q15[2 * FFT_QUARTER - i];
+    if (i <= 3 * FFT_QUARTER) return -dsp_fft_sin_q15[i - 2 * FFT_QUARTER];
+    return -dsp_fft_sin_q15[4 * FFT_QUARTER - i];
+}
+
+static inline int32_t cos_q15(uint32_t i)
+{
+    return sin_q15(i + FFT_QUARTER);
+}
+
+// Radix-2 decimation-in-time over FFT_M points. Every stage halves its
+// outputs, so the result is scaled by 1/FFT_M and can never overflow.
+static void cfft_q15(dsp_cplx_q15_t *x)
+{
+    for (uint32_t i = 1, j = 0; i < FFT_M; i++) {
+        uint32_t bit = FFT_M >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            dsp_cplx_q15_t t = x[i];
+            x[i] = x[j];
+            x[j] = t;
+        }
+    }
+
+    for (uint32_t len = 2; len <= FFT_M; len <<= 1) {
+        uint32_t half = len >> 1;
+        uint32_t step = DSP_FFT_N / len;
+
+        for (uint32_t k = 0; k < half; k++) {
+            int32_t wr = cos_q15(k * step);
+            int32_t wi = -sin_q15(k * step);
+
+            for (uint32_t i = k; i < FFT_M; i += len) {
+                dsp_cplx_q15_t *a = &x[i];
+                dsp_cplx_q15_t *b = &x[i + half];
+                int32_t tr = (b->re * wr - b->im * wi) >> 15;
+                int32_t ti = (b->re * wi + b->im * wr) >> 15;
+                int32_t ar = a->re;
+                int32_t ai = a->im;
+
+                a->re = (int16_t)((ar + tr) >> 1);
+                a->im = (int16_t)((ai + ti) >> 1);
+                b->re = (int16_t)((ar - tr) >> 1);
+                b->im = (int16_t)((ai - ti) >> 1);
+            }
+        }
+    }
+}
+
+// Split step: X[k] = E[k] + W_N^k * O[k], where E and O are the spectra of
+// the even and odd samples recovered from Z[k] and conj(Z[M-k]).
+void dsp_rfft_q15(dsp_cplx_q15_t *data, dsp_cplx_q15_t *out)
+{
+    cfft_q15(data);
+
+    for (uint32_t k = 0; k <= FFT_M; k++) {
+        const dsp_cplx_q15_t *zk = &data[k & (FFT_M - 1)];
+        const dsp_cplx_q15_t *zm = &data[(FFT_M - k) & (FFT_M - 1)];
+
+        int32_t er = (zk->re + zm->re) >> 1;
+        int32_t ei = (zk->im - zm->im) >> 1;
+        int32_t or = (zk->im + zm->im) >> 1;
+        int32_t oi = (zm->re - zk->re) >> 1;
+
+        int32_t wr = cos_q15(k);
+        int32_t wi = sin_q15(k);
+        int32_t tr = (or * wr + oi * wi) >> 15;
+        int32_t ti = (oi * wr - or * wi) >> 15;
+
+        out[k].re = (int16_t)((er + tr) >> 1);
+        out[k].im = (int16_t)((ei + ti) >> 1);
+    }
+}
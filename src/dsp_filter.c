@@ -0,0 +1,100 @@
+#include "dsp_filter.h"
+
+// Butterworth low-pass sections (Q = 0.7071) in Q30, indexed by cutoff as a
+// fraction of the sample rate so the same entry serves any sensor rate.
+// b1 is trimmed by one LSB so the DC gain is exactly unity.
+const dsp_biquad_coef_t dsp_lpf_table[DSP_LPF_COUNT] = {
+    [DSP_LPF_FS_DIV10] = { 72429549, 144859097, 72429549, -1227265970, 443242341 },
+    [DSP_LPF_FS_DIV20] = { 21564350,  43128698, 21564350, -1676130396, 688645970 },
+};
+
+static inline int32_t min_i32(int32_t a, int32_t b) { return a < b ? a : b; }
+static inline int32_t max_i32(int32_t a, int32_t b) { return a > b ? a : b; }
+
+static inline int32_t median3(int32_t a, int32_t b, int32_t c)
+{
+    return max_i32(min_i32(a, b), min_i32(max_i32(a, b), c));
+}
+
+static inline int32_t median5(const int32_t *w)
+{
+    int32_t lo = max_i32(min_i32(w[0], w[1]), min_i32(w[2], w[3]));
+    int32_t hi = min_i32(max_i32(w[0], w[1]), max_i32(w[2], w[3]));
+    return median3(w[4], lo, hi);
+}
+
+// The state keeps DSP_EMA_FRAC_BITS of fraction and the update rounds to
+// nearest, so small steps are never lost to truncation as with the float EMA.
+void dsp_ema_init(dsp_ema_t *f, int32_t alpha_q15, int32_t initial)
+{
+    f->alpha_q15 = alpha_q15;
+    f->state = (int64_t)initial << DSP_EMA_FRAC_BITS;
+}
+
+int32_t dsp_ema_update(dsp_ema_t *f, int32_t x)
+{
+    int64_t delta = ((int64_t)x << DSP_EMA_FRAC_BITS) - f->state;
+    f->state += (delta * f->alpha_q15 + (1 << 14)) >> 15;
+    return (int32_t)((f->state + (1 << (DSP_EMA_FRAC_BITS - 1))) >> DSP_EMA_FRAC_BITS);
+}
+
+void dsp_biquad_init(dsp_biquad_t *f, dsp_lpf_id_t id, int32_t initial)
+{
+    f->coef = &dsp_lpf_table[id];
+    f->x1 = f->x2 = initial;
+    f->y1 = f->y2 = initial;
+    f->err = 0;
+}
+
+// Direct form I with first-order error feedback: the bits dropped when scaling
+// the accumulator back from Q30 are carried into the next sample.
+int32_t dsp_biquad_update(dsp_biquad_t *f, int32_t x)
+{
+    const dsp_biquad_coef_t *c = f->coef;
+
+    int64_t acc = (int64_t)c->b0 * x
+                + (int64_t)c->b1 * f->x1
+                + (int64_t)c->b2 * f->x2
+                - (int64_t)c->a1 * f->y1
+                - (int64_t)c->a2 * f->y2
+                + f->err;
+
+    int32_t y = (int32_t)(acc >> DSP_Q30_SHIFT);
+    f->err = acc - ((int64_t)y << DSP_Q30_SHIFT);
+
+    f->x2 = f->x1;
+    f->x1 = x;
+    f->y2 = f->y1;
+    f->y1 = y;
+
+    return y;
+}
+
+void dsp_median_init(dsp_median_t *f, uint8_t n, int32_t initial)
+{
+    f->n = (n >= 5) ? 5 : 3;
+    f->pos = 0;
+    for (int i = 0; i < DSP_MEDIAN_MAX; i++) {
+        f->window[i] = initial;
+    }
+}
+
+int32_t dsp_median_update(dsp_median_t *f, int32_t x)
+{
+    f->window[f->pos] = x;
+    f->pos = (f->pos + 1 == f->n) ? 0 : f->pos + 1;
+
+    if (f->n == 5) return median5(f->window);
+    return median3(f->window[0], f->window[1], f->window[2]);
+}
+
+void dsp_channel_init(dsp_channel_t *ch, uint8_t median_n, dsp_lpf_id_t id, int32_t initial)
+{
+    dsp_median_init(&ch->median, median_n, initial);
+    dsp_biquad_init(&ch->lpf, id, initial);
+}
+
+int32_t dsp_channel_update(dsp_channel_t *ch, int32_t x)
+{
+    return dsp_biquad_update(&ch->lpf, dsp_median_update(&ch->median, x));
+}
@@ -0,0 +1,158 @@
+#include "epoch_features.h"
+#include <string.h>
+
+#define RESP_FS_MHZ   (1000000000LL / EPOCH_BUCKET_US)
+#define RESP_BIN_LO   ((EPOCH_RESP_LO_MHZ * DSP_FFT_N + RESP_FS_MHZ - 1) / RESP_FS_MHZ)
+#define RESP_BIN_HI   ((EPOCH_RESP_HI_MHZ * DSP_FFT_N) / RESP_FS_MHZ)
+
+_Static_assert(EPOCH_MAX_BUCKETS <= DSP_FFT_N, "epoch does not fit the FFT");
+
+static dsp_cplx_q15_t s_fft_buf[DSP_FFT_N / 2];
+static dsp_cplx_q15_t s_fft_out[DSP_FFT_BINS];
+
+static inline int32_t abs_i32(int32_t v) { return v < 0 ? -v : v; }
+
+static void push_bucket(epoch_t *ep, int32_t value)
+{
+    if (ep->n_signal < EPOCH_MAX_BUCKETS) {
+        ep->signal[ep->n_signal++] = value;
+    }
+}
+
+// Closes the current bucket and fills any buckets skipped by a gap in the
+// stream with the last value, so the signal stays uniformly sampled.
+static void flush_buckets(epoch_t *ep, uint32_t upto)
+{
+    int32_t last = ep->n_signal ? ep->signal[ep->n_signal - 1] : 0;
+
+    if (ep->bucket_n) {
+        last = (int32_t)(ep->bucket_sum / ep->bucket_n);
+        push_bucket(ep, last);
+        ep->bucket_sum = 0;
+        ep->bucket_n = 0;
+    }
+    while (ep->n_signal < upto && ep->n_signal < EPOCH_MAX_BUCKETS) {
+        push_bucket(ep, last);
+    }
+}
+
+static void respiration(const epoch_t *ep, epoch_features_t *out)
+{
+    int16_t *x = (int16_t *)s_fft_buf;
+    int64_t sum = 0;
+    int32_t peak = 0;
+
+    out->resp_power = 0;
+    out->resp_ratio_permille = 0;
+    out->resp_rate_bpm_x10 = 0;
+
+    if (ep->n_signal < DSP_FFT_N / 8) return;
+
+    for (uint16_t i = 0; i < ep->n_signal; i++) sum += ep->signal[i];
+    int32_t mean = (int32_t)(sum / ep->n_signal);
+
+    uint64_t var = 0;
+    for (uint16_t i = 0; i < ep->n_signal; i++) {
+        int32_t d = ep->signal[i] - mean;
+        var += (uint64_t)((int64_t)d * d);
+        if (abs_i32(d) > peak) peak = abs_i32(d);
+    }
+    var /= ep->n_signal;
+    if (peak == 0) return;
+
+    // Block-scale so the peak lands in [2^13, 2^14) and use the full Q15 range.
+    int shift = 0;
+    while ((peak >> shift) >= (1 << 14)) shift++;
+    if (shift == 0) {
+        while (shift > -14 && (peak << (1 - shift)) < (1 << 14)) shift--;
+    }
+
+    memset(s_fft_buf, 0, sizeof(s_fft_buf));
+    for (uint16_t i = 0; i < ep->n_signal; i++) {
+        int32_t d = ep->signal[i] - mean;
+        x[i] = (int16_t)(shift >= 0 ? d >> shift : d << -shift);
+    }
+
+    dsp_rfft_q15(s_fft_buf, s_fft_out);
+
+    uint64_t total = 0, band = 0, best = 0;
+    uint32_t best_bin = 0;
+
+    for (uint32_t k = 1; k < DSP_FFT_BINS; k++) {
+        uint32_t p = (uint32_t)(s_fft_out[k].re * s_fft_out[k].re)
+                   + (uint32_t)(s_fft_out[k].im * s_fft_out[k].im);
+        total += p;
+        if (k >= RESP_BIN_LO && k <= RESP_BIN_HI) {
+            band += p;
+            if (p > best) {
+                best = p;
+                best_bin = k;
+            }
+        }
+    }
+    if (total == 0) return;
+
+    out->resp_ratio_permille = (uint16_t)(band * 1000 / total);
+    out->resp_power = (uint32_t)(var * out->resp_ratio_permille / 1000);
+    out->resp_rate_bpm_x10 = (uint16_t)(best_bin * RESP_FS_MHZ * 600 / DSP_FFT_N / 1000);
+}
+
+static void finish(epoch_t *ep, epoch_features_t *out)
+{
+    flush_buckets(ep, 0);
+
+    out->start_us = ep->start_us;
+    out->duration_ms = (uint32_t)((ep->last_us - ep->start_us) / 1000);
+    out->samples = ep->samples;
+    out->activity_count = (uint16_t)(ep->activity > UINT16_MAX ? UINT16_MAX : ep->activity);
+    out->presence_pct = (uint8_t)(ep->present * 100 / ep->samples);
+    out->movement_energy = (uint32_t)(ep->energy > UINT32_MAX ? UINT32_MAX : ep->energy);
+    out->weight_mean = (int32_t)(ep->w_sum / ep->samples);
+    out->weight_var = (uint32_t)((ep->w_sum_sq - ep->w_sum * ep->w_sum / ep->samples) / ep->samples);
+
+    respiration(ep, out);
+}
+
+void epoch_init(epoch_t *ep)
+{
+    memset(ep, 0, sizeof(*ep));
+}
+
+bool epoch_update(epoch_t *ep, const sensor_record_t *rec, bool present, epoch_features_t *out)
+{
+    bool done = false;
+
+    if (ep->samples && rec->timestamp_us - ep->start_us >= EPOCH_DURATION_US) {
+        finish(ep, out);
+        epoch_init(ep);
+        done = true;
+    }
+
+    int32_t total = (int32_t)rec->weight[0] + rec->weight[1] + rec->weight[2] + rec->weight[3];
+
+    if (ep->samples == 0) {
+        ep->start_us = rec->timestamp_us;
+        memcpy(ep->prev_accel, rec->accel_filtered, sizeof(ep->prev_accel));
+    }
+
+    uint32_t bucket = (uint32_t)((rec->timestamp_us - ep->start_us) / EPOCH_BUCKET_US);
+    if (bucket > ep->n_signal) flush_buckets(ep, bucket);
+    ep->bucket_sum += total;
+    ep->bucket_n++;
+
+    int32_t d = abs_i32(rec->accel_filtered[0] - ep->prev_accel[0])
+              + abs_i32(rec->accel_filtered[1] - ep->prev_accel[1])
+              + abs_i32(rec->accel_filtered[2] - ep->prev_accel[2]);
+    memcpy(ep->prev_accel, rec->accel_filtered, sizeof(ep->prev_accel));
+
+    if (d > EPOCH_ACTIVITY_MG) ep->activity++;
+    ep->energy += (uint64_t)((int64_t)d * d);
+
+    ep->samples++;
+    if (present) ep->present++;
+    ep->w_sum += total;
+    ep->w_sum_sq += (int64_t)total * total;
+    ep->last_us = rec->timestamp_us;
+
+    return done;
+}
@@ -0,0 +1,170 @@
+#include "fall_detect.h"
+#include <string.h>
+#include "posture.h"
+
+static inline int32_t abs_i32(int32_t v) { return v < 0 ? -v : v; }
+
+static inline bool within_window(int64_t a, int64_t b)
+{
+    int64_t d = a - b;
+    return (d < 0 ? -d : d) <= FALL_WINDOW_US;
+}
+
+static int32_t isqrt64(int64_t v)
+{
+    int64_t r = 0;
+    int64_t bit = (int64_t)1 << 62;
+
+    while (bit > v) bit >>= 2;
+    while (bit != 0) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (int32_t)r;
+}
+
+static void emit(fall_detector_t *fd, fall_alert_id_t id, int64_t timestamp_us)
+{
+    fd->alerts++;
+    if (fd->cb == NULL) return;
+
+    fall_alert_t alert = {
+        .id = id,
+        .timestamp_us = timestamp_us,
+        .impact_us = fd->impact_us,
+        .peak_mg = fd->peak_mg,
+        .cog_x = fd->cog_x,
+        .cog_y = fd->cog_y,
+    };
+    fd->cb(&alert, fd->ctx);
+}
+
+// A fall needs an impact on the IMU and, within FALL_WINDOW_US either side,
+// a sudden loss of load or the CoG running off an edge. Whichever stream
+// completes the pattern raises the alert, so latency is one sample period.
+static void evaluate(fall_detector_t *fd, int64_t now)
+{
+    if (__atomic_exchange_n(&fd->reset_request, false, __ATOMIC_ACQ_REL)) {
+        fd->impact_us = 0;
+        fd->peak_mg = 0;
+        fd->load_loss_us = 0;
+        fd->edge_us = 0;
+        __atomic_store_n(&fd->latched, false, __ATOMIC_RELEASE);
+    }
+
+    if (fd->impact_us != 0 && now - fd->impact_us > FALL_WINDOW_US) {
+        fd->impact_us = 0;
+        fd->peak_mg = 0;
+    }
+
+    if (__atomic_load_n(&fd->latched, __ATOMIC_ACQUIRE) || fd->impact_us == 0) return;
+
+    bool load = fd->load_loss_us != 0 && within_window(fd->impact_us, fd->load_loss_us);
+    bool edge = fd->edge_us != 0 && within_window(fd->impact_us, fd->edge_us);
+    if (!load && !edge) return;
+
+    __atomic_store_n(&fd->latched, true, __ATOMIC_RELEASE);
+    emit(fd, FALL_ALERT_FALL, now);
+}
+
+void fall_init(fall_detector_t *fd, int32_t min_total, fall_alert_cb_t cb, void *ctx)
+{
+    memset(fd, 0, sizeof(*fd));
+    fd->min_total = min_total;
+    fd->edge_armed = true;
+    fd->cb = cb;
+    fd->ctx = ctx;
+    dsp_ema_init(&fd->vel_x, FALL_VEL_ALPHA_Q15, 0);
+    dsp_ema_init(&fd->vel_y, FALL_VEL_ALPHA_Q15, 0);
+}
+
+void fall_update_imu(fall_detector_t *fd, int64_t timestamp_us, const int32_t accel_mg[3])
+{
+    int64_t mag2 = (int64_t)accel_mg[0] * accel_mg[0]
+                 + (int64_t)accel_mg[1] * accel_mg[1]
+                 + (int64_t)accel_mg[2] * accel_mg[2];
+
+    if (mag2 > (int64_t)FALL_IMPACT_MG * FALL_IMPACT_MG) {
+        int32_t mag = isqrt64(mag2);
+        if (fd->impact_us == 0 || mag > fd->peak_mg) fd->peak_mg = mag;
+        fd->impact_us = timestamp_us;
+    }
+
+    evaluate(fd, timestamp_us);
+}
+
+void fall_update_load(fall_detector_t *fd, int64_t timestamp_us, const int16_t weight[4])
+{
+    int32_t total = (int32_t)weight[0] + weight[1] + weight[2] + weight[3];
+
+    if (!fd->baseline_valid) {
+        dsp_ema_init(&fd->baseline, FALL_BASELINE_ALPHA_Q15, total);
+        fd->baseline_valid = true;
+    }
+
+    int32_t baseline = dsp_ema_update(&fd->baseline, total);
+    bool occupied = baseline > fd->min_total;
+    bool lost = occupied && (int64_t)total * 100 < (int64_t)baseline * (100 - FALL_LOAD_LOSS_PCT);
+
+    if (lost) fd->load_loss_us = timestamp_us;
+
+    // Once the load has gone the CoG of what is left is mostly noise, and
+    // the baseline takes a second or two to follow it down.
+    bool loaded = occupied && !lost && total > fd->min_total;
+
+    int16_t x, y;
+    if (posture_cog(weight, &x, &y)) {
+        if (!fd->cog_valid) {
+            fd->cog_x = x;
+            fd->cog_y = y;
+            fd->cog_valid = true;
+        }
+
+        int32_t vx = dsp_ema_update(&fd->vel_x, x - fd->cog_x);
+        int32_t vy = dsp_ema_update(&fd->vel_y, y - fd->cog_y);
+        fd->cog_x = x;
+        fd->cog_y = y;
+
+        bool out_x = abs_i32(x) > FALL_EDGE_Q15 && (x > 0 ? vx : -vx) > FALL_EDGE_VEL_Q15;
+        bool out_y = abs_i32(y) > FALL_EDGE_Q15 && (y > 0 ? vy : -vy) > FALL_EDGE_VEL_Q15;
+
+        if (loaded && (out_x || out_y)) {
+            fd->edge_us = timestamp_us;
+            if (fd->edge_armed) {
+                fd->edge_armed = false;
+                emit(fd, FALL_ALERT_EDGE_EXIT, timestamp_us);
+            }
+        } else if (abs_i32(x) < FALL_EDGE_Q15 / 2 && abs_i32(y) < FALL_EDGE_Q15 / 2) {
+            fd->edge_armed = true;
+        }
+    }
+
+    evaluate(fd, timestamp_us);
+}
+
+// Called from the command task. The event times belong to the sensor task,
+// so it clears them on its next sample; clearing only the latch would let
+// the same impact raise the alert again while it is inside the window.
+void fall_reset(fall_detector_t *fd)
+{
+    __atomic_store_n(&fd->reset_request, true, __ATOMIC_RELEASE);
+}
+
+bool fall_is_latched(const fall_detector_t *fd)
+{
+    return __atomic_load_n(&fd->latched, __ATOMIC_ACQUIRE);
+}
+
+const char *fall_alert_name(fall_alert_id_t id)
+{
+    switch (id) {
+        case FALL_ALERT_FALL:      return "FALL";
+        case FALL_ALERT_EDGE_EXIT: return "EDGE_EXIT";
+        default:                   return "?";
+    }
+}
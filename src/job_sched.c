@@ -0,0 +1,151 @@
+#include "job_sched.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+
+static const char *TAG = "SCHED";
+
+static void timer_cb(void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+void sched_init(sched_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+int sched_add(sched_t *s, const char *name, sched_fn_t fn, void *arg, uint32_t period_us)
+{
+    if (s->count >= SCHED_MAX_JOBS || fn == NULL || period_us == 0) return -1;
+
+    sched_job_t *j = &s->jobs[s->count];
+    j->name = name;
+    j->fn = fn;
+    j->arg = arg;
+    j->period_us = period_us;
+
+    return s->count++;
+}
+
+void sched_set_period(sched_t *s, int job, uint32_t period_us)
+{
+    if (job < 0 || job >= s->count || period_us == 0) return;
+    s->jobs[job].period_us = period_us;
+}
+
+uint32_t sched_get_period(const sched_t *s, int job)
+{
+    if (job < 0 || job >= s->count) return 0;
+    return s->jobs[job].period_us;
+}
+
+void sched_get_stats(const sched_t *s, int job, sched_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (job < 0 || job >= s->count) return;
+
+    const sched_job_t *j = &s->jobs[job];
+    stats->name = j->name;
+    stats->period_us = j->period_us;
+    stats->runs = j->runs;
+    stats->missed = j->missed;
+    stats->exec_last_us = j->exec_last_us;
+    stats->exec_max_us = j->exec_max_us;
+    stats->exec_avg_us = j->runs ? (uint32_t)(j->exec_total_us / j->runs) : 0;
+    stats->jitter_max_us = j->jitter_max_us;
+}
+
+// Makes a job due immediately instead of at its next periodic release.
+void sched_release(sched_t *s, int job)
+{
+    if (job < 0 || job >= s->count) return;
+
+    __atomic_fetch_or(&s->released, 1u << job, __ATOMIC_RELEASE);
+    if (s->task != NULL) xTaskNotifyGive(s->task);
+}
+
+void IRAM_ATTR sched_release_from_isr(sched_t *s, int job, BaseType_t *woken)
+{
+    if (job < 0 || job >= s->count) return;
+
+    __atomic_fetch_or(&s->released, 1u << job, __ATOMIC_RELEASE);
+    if (s->task != NULL) vTaskNotifyGiveFromISR(s->task, woken);
+}
+
+// Release times advance by exactly one period from the previous release,
+// so execution time never accumulates into drift. A job that falls a whole
+// period behind skips the lost releases and counts them as missed.
+static void run_job(sched_job_t *j, int64_t start)
+{
+    int32_t lateness = (int32_t)(start - j->next_us);
+    if (lateness > j->jitter_max_us) j->jitter_max_us = lateness;
+
+    j->fn(j->arg);
+
+    int64_t end = esp_timer_get_time();
+    uint32_t exec = (uint32_t)(end - start);
+    uint32_t period = j->period_us;
+
+    j->runs++;
+    j->exec_last_us = exec;
+    j->exec_total_us += exec;
+    if (exec > j->exec_max_us) j->exec_max_us = exec;
+
+    j->next_us += period;
+    if (j->next_us <= end) {
+        uint32_t behind = (uint32_t)((end - j->next_us) / period) + 1;
+        j->missed += behind;
+        j->next_us += (int64_t)behind * period;
+    }
+}
+
+void sched_run(sched_t *s)
+{
+    esp_timer_create_args_t args = {
+        .callback = timer_cb,
+        .arg = xTaskGetCurrentTaskHandle(),
+        .name = "sched",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s->timer));
+    s->task = xTaskGetCurrentTaskHandle();
+
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < s->count; i++) {
+        s->jobs[i].next_us = now;
+    }
+
+    ESP_LOGI(TAG, "Running %d jobs", s->count);
+
+    while (1)
+    {
+        uint32_t released = __atomic_exchange_n(&s->released, 0, __ATOMIC_ACQ_REL);
+        if (released) {
+            now = esp_timer_get_time();
+            for (int i = 0; i < s->count; i++) {
+                if (released & (1u << i)) s->jobs[i].next_us = now;
+            }
+        }
+
+        int64_t next = INT64_MAX;
+        for (int i = 0; i < s->count; i++) {
+            if (s->jobs[i].next_us < next) next = s->jobs[i].next_us;
+        }
+
+        now = esp_timer_get_time();
+        if (next > now) {
+            esp_timer_stop(s->timer);
+            esp_timer_start_once(s->timer, (uint64_t)(next - now));
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        for (int i = 0; i < s->count; i++) {
+            now = esp_timer_get_time();
+            if (s->jobs[i].next_us <= now) {
+                run_job(&s->jobs[i], now);
+            }
+        }
+    }
+}
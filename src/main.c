@@ -3,15 +3,34 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "nvs_flash.h"
 
 #include "app_config.h"
 #include "drv_loadcell.h"
 #include "drv_mpu.h"
+#include "dsp_filter.h"
+#include "spsc_ring.h"
+#include "sensor_record.h"
+#include "app_state.h"
+#include "telemetry.h"
+#include "spool.h"
+#include "command.h"
+#include "posture.h"
+#include "fall_detect.h"
+#include "epoch_features.h"
+#include "job_sched.h"
+#include "trace.h"
+#include "calib.h"
+#include "ws_stream.h"
+#include "resample.h"
+#include "ahrs.h"
 #include "wifi_config.h"
 #include "mqtt_config.h"
 
@@ -22,16 +41,101 @@ loadcell_t sensor_front_right;
 loadcell_t sensor_back_left;
 loadcell_t sensor_back_right;
 
+loadcell_t *const loadcells[LC_MAX_CHANNELS] = {
+    &sensor_front_left, &sensor_front_right, &sensor_back_left, &sensor_back_right
+};
+
 MPU9250_t myMpu;
 
+#define LOADCELL_QUEUE_LEN  (LC_MAX_CHANNELS * 8)
+#define LOADCELL_MEDIAN_N   5
+
+static QueueHandle_t g_loadcell_queue = NULL;
+
+#define SAMPLE_RING_LEN     128
+#define PROCESS_PERIOD_MS   1000
+#define SENSOR_PERIOD_MS    20
+#define SENSOR_RATE_MAX_HZ  50
+#define TARE_TIMEOUT_MS     500
+#define STATS_REPORT_PERIOD_MS 60000
+#define CALIB_SAVE_PERIOD_MS   3600000
+#define CAL_IMU_SAMPLES     64
+#define CAL_IMU_TIMEOUT_MS  2000
+#define POWER_PERIOD_US     100000
+#define WATCH_ENTER_MS      60000
+#define WATCH_RECORD_PERIOD_US 1000000
+#define WATCH_LC_PERIOD_MS  2000
+#define WATCH_WAKE_DELTA_KG 2
+#define WATCH_PROCESS_PERIOD_MS 10000
+#define EVENT_QUEUE_LEN     8
+
 typedef struct {
-    int16_t weight[4];
-    int32_t accel_filtered[3];
-    bool    person_present;
-} shared_data_t;
+    uint32_t watch_entries;
+    uint32_t wakes_motion;
+    uint32_t wakes_weight;
+    uint32_t wake_latency_last_us;
+    uint32_t wake_latency_max_us;
+    uint64_t watch_us;
+    uint64_t lc_off_us;
+} power_stats_t;
+
+// Raised on the sensor task and published from the process task, so the
+// sensor task never waits on the MQTT client.
+typedef enum {
+    SENSOR_EVT_FALL = 0,
+    SENSOR_EVT_LC_STALE,
+} sensor_evt_id_t;
 
-static shared_data_t g_data = {0};
-static SemaphoreHandle_t g_data_mutex = NULL;
+typedef struct {
+    int64_t timestamp_us;
+    int64_t age_us;
+    uint8_t channel;
+    bool stale;
+} lc_stale_event_t;
+
+typedef struct {
+    sensor_evt_id_t id;
+    union {
+        fall_alert_t fall;
+        lc_stale_event_t lc;
+    };
+} sensor_event_t;
+
+static sensor_record_t g_sample_buf[SAMPLE_RING_LEN];
+static spsc_ring_t g_sample_ring;
+static TaskHandle_t g_process_task = NULL;
+static QueueHandle_t g_event_queue = NULL;
+static uint32_t g_events_dropped = 0;
+static telemetry_batch_t g_telemetry;
+static uint8_t g_spool_frame[TELEMETRY_MAX_FRAME];
+static sched_t g_sched;
+static int g_job_imu = -1;
+static int g_job_loadcell = -1;
+static int g_job_record = -1;
+static int g_job_power = -1;
+static uint32_t g_record_period_us = SENSOR_PERIOD_MS * 1000;
+static bool g_watch = false;
+static bool g_motion_pending = false;
+static uint32_t g_lc_stale = 0;
+static uint32_t g_align_held = 0;
+static int16_t g_attitude[3];
+static power_stats_t g_power;
+static uint32_t g_tare_request = 0;
+static uint32_t g_cal_imu_request = 0;
+static calib_blob_t g_calib;
+static posture_engine_t g_posture;
+static fall_detector_t g_fall;
+static epoch_t g_epoch;
+
+static void init_nvs(void)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+}
 
 static void init_spi_bus(void)
 {
@@ -41,117 +145,785 @@ static void init_spi_bus(void)
         .sclk_io_num = MPU_PIN_NUM_CLK,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = 32,
+        .max_transfer_sz = MPU_FIFO_BURST_MAX + 1,
     };
 
     ESP_ERROR_CHECK(spi_bus_initialize(MPU_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO));
 
-    spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 1 * 1000 * 1000,
-        .mode = 0,
-        .spics_io_num = -1,
-        .queue_size = 7,
-    };
+    ESP_ERROR_CHECK(mpu_attach(&myMpu, MPU_SPI_HOST, MPU_PIN_NUM_CS));
+}
 
-    ESP_ERROR_CHECK(spi_bus_add_device(MPU_SPI_HOST, &devcfg, &myMpu.spi_handle));
+// The process task is woken straight away rather than at its next record.
+static void post_sensor_event(const sensor_event_t *evt)
+{
+    if (xQueueSend(g_event_queue, evt, 0) != pdTRUE) {
+        g_events_dropped++;
+        return;
+    }
+    if (g_process_task != NULL) xTaskNotifyGive(g_process_task);
+}
 
-    gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_DISABLE,
-        .mode = GPIO_MODE_OUTPUT,
-        .pin_bit_mask = (1ULL << MPU_PIN_NUM_CS),
-        .pull_down_en = 0,
-        .pull_up_en = 1,
-    };
-    gpio_config(&io_conf);
+// Runs on the sensor task right after the sample that completed the pattern.
+static void on_fall_alert(const fall_alert_t *alert, void *ctx)
+{
+    sensor_event_t evt = { .id = SENSOR_EVT_FALL, .fall = *alert };
+
+    post_sensor_event(&evt);
+}
+
+typedef struct {
+    int16_t weight[LC_MAX_CHANNELS];
+    int16_t raw_weight[LC_MAX_CHANNELS];
+    int32_t accel[3];
+    dsp_channel_t lc_filter[LC_MAX_CHANNELS];
+    calib_drift_t drift[LC_MAX_CHANNELS];
+    int32_t cal_accel[3];
+    int32_t cal_gyro[3];
+    uint16_t cal_count;
+    int64_t lc_last_us[LC_MAX_CHANNELS];
+    uint32_t lc_stale;
+    resample_stream_t lc_rs[LC_MAX_CHANNELS];
+    resample_stream_t imu_rs;
+    ahrs_t ahrs;
+    int64_t record_last_us;
+
+    bool watch;
+    int64_t power_last_us;
+    int64_t empty_since_us;
+    int64_t lc_next_on_us;
+    int64_t wake_trigger_us;
+    int32_t watch_baseline;
+    uint32_t watch_seen;
+    int16_t watch_weight[LC_MAX_CHANNELS];
+} sensor_ctx_t;
+
+// Averages raw readings while CAL_IMU is pending. The board has to lie flat
+// and still, so everything except +1 g on Z is bias.
+static void imu_cal_feed(sensor_ctx_t *ctx, const int16_t accel[3], const int16_t gyro[3])
+{
+    if (!__atomic_load_n(&g_cal_imu_request, __ATOMIC_ACQUIRE)) {
+        ctx->cal_count = 0;
+        return;
+    }
+
+    if (ctx->cal_count == 0) {
+        memset(ctx->cal_accel, 0, sizeof(ctx->cal_accel));
+        memset(ctx->cal_gyro, 0, sizeof(ctx->cal_gyro));
+    }
+
+    for (int i = 0; i < 3; i++) {
+        ctx->cal_accel[i] += accel[i];
+        ctx->cal_gyro[i] += gyro[i];
+    }
+    if (++ctx->cal_count < CAL_IMU_SAMPLES) return;
+
+    int16_t accel_bias[3], gyro_bias[3];
+    for (int i = 0; i < 3; i++) {
+        accel_bias[i] = (int16_t)(ctx->cal_accel[i] / CAL_IMU_SAMPLES);
+        gyro_bias[i] = (int16_t)(ctx->cal_gyro[i] / CAL_IMU_SAMPLES);
+    }
+    accel_bias[2] -= (int16_t)myMpu.accel_sens;
+
+    mpu_set_bias(&myMpu, accel_bias, gyro_bias);
+    ctx->cal_count = 0;
+    __atomic_store_n(&g_cal_imu_request, 0, __ATOMIC_RELEASE);
+}
+
+// Everything downstream of one decoded IMU sample, run for every sample so
+// the orientation filter integrates the gyro at the full output rate.
+static void imu_update(sensor_ctx_t *ctx)
+{
+    moving_average(&myMpu);
+    resample_push(&ctx->imu_rs, myMpu.sample_time_us, myMpu.accel_ma);
+    fall_update_imu(&g_fall, myMpu.sample_time_us, myMpu.accel_mg);
+    ahrs_update(&ctx->ahrs, myMpu.sample_time_us, myMpu.gyro_mdps, myMpu.accel_mg,
+                myMpu.mag_valid ? myMpu.mag_raw : NULL);
+}
+
+static void job_imu(void *arg)
+{
+    sensor_ctx_t *ctx = arg;
+    mpu_sample_t imu_sample;
+
+    if (myMpu.fifo_task != NULL) {
+        while (mpu_fifo_pop(&myMpu, &imu_sample)) {
+            imu_cal_feed(ctx, imu_sample.accel, imu_sample.gyro);
+            mpu_apply_sample(&myMpu, &imu_sample);
+            imu_update(ctx);
+        }
+    } else {
+        // One read stays in flight between runs: collect the one started last
+        // time, queue the next, then process while it transfers.
+        bool done = myMpu.async_pending &&
+                    mpu_read_async_finish(&myMpu, pdMS_TO_TICKS(MPU_TIME_OUT)) == ESP_OK;
+        mpu_read_async_start(&myMpu);
+        if (done) {
+            imu_cal_feed(ctx, myMpu.poll_sample.accel, myMpu.poll_sample.gyro);
+            imu_update(ctx);
+        }
+    }
+
+    if (myMpu.data_ready) {
+        ctx->accel[0] = myMpu.accel_ma[0];
+        ctx->accel[1] = myMpu.accel_ma[1];
+        ctx->accel[2] = myMpu.accel_ma[2];
+        ahrs_get_euler(&ctx->ahrs, g_attitude);
+    }
+}
+
+static int32_t total_weight(const int16_t *weight)
+{
+    int32_t total = 0;
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) total += weight[ch];
+    return total;
+}
+
+static void IRAM_ATTR on_imu_motion(void *ctx, BaseType_t *woken)
+{
+    __atomic_store_n(&g_motion_pending, true, __ATOMIC_RELEASE);
+    sched_release_from_isr(&g_sched, g_job_power, woken);
+}
+
+// Watch mode: the HX711s are powered down between spot checks, the IMU sits
+// in low-power wake-on-motion, records drop to 1 Hz and Wi-Fi uses modem
+// sleep. Either trigger puts everything back and releases the jobs at once.
+static void enter_watch(sensor_ctx_t *ctx, int64_t now)
+{
+    ctx->watch = true;
+    ctx->watch_baseline = total_weight(ctx->weight);
+    ctx->watch_seen = 0;
+    ctx->lc_next_on_us = now + WATCH_LC_PERIOD_MS * 1000LL;
+    __atomic_store_n(&g_motion_pending, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_watch, true, __ATOMIC_RELEASE);
+
+    loadcell_set_power(false);
+    mpu_set_wake_on_motion(&myMpu, true);
+    sched_set_period(&g_sched, g_job_imu, WATCH_RECORD_PERIOD_US);
+    sched_set_period(&g_sched, g_job_record, WATCH_RECORD_PERIOD_US);
+    wifi_set_power_save(true);
+
+    g_power.watch_entries++;
+    ESP_LOGI(TAG, "Watch mode, baseline %ld", ctx->watch_baseline);
+}
+
+static void exit_watch(sensor_ctx_t *ctx, int64_t now, int64_t trigger_us, bool motion)
+{
+    ctx->watch = false;
+    ctx->empty_since_us = now;
+    ctx->wake_trigger_us = trigger_us;
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        ctx->lc_last_us[ch] = now;
+    }
+    __atomic_store_n(&g_watch, false, __ATOMIC_RELEASE);
+
+    loadcell_set_power(true);
+    mpu_set_wake_on_motion(&myMpu, false);
+    sched_set_period(&g_sched, g_job_imu, MPU_SAMPLE_PERIOD_US);
+    sched_set_period(&g_sched, g_job_record, g_record_period_us);
+    sched_release(&g_sched, g_job_imu);
+    sched_release(&g_sched, g_job_loadcell);
+    sched_release(&g_sched, g_job_record);
+    wifi_set_power_save(false);
 
-    myMpu.cs_pin = MPU_PIN_NUM_CS;
-    gpio_set_level(myMpu.cs_pin, 1);
+    if (motion) {
+        g_power.wakes_motion++;
+    } else {
+        g_power.wakes_weight++;
+    }
+    ESP_LOGI(TAG, "Active mode (%s)", motion ? "motion" : "weight");
+}
+
+// Runs once every cell has reported after a watch power-up. The raw reading
+// is used because the filtered one lags by several samples.
+static void watch_check(sensor_ctx_t *ctx, int64_t now)
+{
+    int32_t total = total_weight(ctx->watch_weight);
+    int32_t delta = total - ctx->watch_baseline;
+
+    ctx->watch_seen = 0;
+
+    if (total > PRESENCE_THRESHOLD_KG || delta >= WATCH_WAKE_DELTA_KG || delta <= -WATCH_WAKE_DELTA_KG) {
+        exit_watch(ctx, now, now, false);
+        return;
+    }
+
+    loadcell_set_power(false);
+    ctx->lc_next_on_us = now + WATCH_LC_PERIOD_MS * 1000LL;
+}
+
+static void job_power(void *arg)
+{
+    sensor_ctx_t *ctx = arg;
+    int64_t now = esp_timer_get_time();
+    uint32_t elapsed = (uint32_t)(now - ctx->power_last_us);
+
+    ctx->power_last_us = now;
+    if (ctx->watch) g_power.watch_us += elapsed;
+    if (!loadcell_is_powered()) g_power.lc_off_us += elapsed;
+
+    if (!ctx->watch) {
+        if (app_state_person_present()) {
+            ctx->empty_since_us = now;
+        } else if (now - ctx->empty_since_us >= WATCH_ENTER_MS * 1000LL) {
+            enter_watch(ctx, now);
+        }
+        return;
+    }
+
+    if (__atomic_exchange_n(&g_motion_pending, false, __ATOMIC_ACQ_REL)) {
+        exit_watch(ctx, now, myMpu.motion_time_us, true);
+        return;
+    }
+
+    if (!loadcell_is_powered() && now >= ctx->lc_next_on_us) {
+        ctx->watch_seen = 0;
+        loadcell_set_power(true);
+    }
+}
+
+// A cell that stops converting keeps its last weight in every record, so the
+// transition is raised as an event instead of being silently absorbed. The
+// limit allows for the HX711 settling time after a power-up.
+static void lc_check_stale(sensor_ctx_t *ctx, int64_t now)
+{
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        uint32_t bit = 1u << ch;
+        int64_t age = now - ctx->lc_last_us[ch];
+        bool stale = age > (int64_t)loadcells[ch]->period_us * LC_STALE_PERIODS;
+
+        if (stale == !!(ctx->lc_stale & bit)) continue;
+        ctx->lc_stale ^= bit;
+
+        sensor_event_t evt = {
+            .id = SENSOR_EVT_LC_STALE,
+            .lc = { .timestamp_us = now, .age_us = age, .channel = (uint8_t)ch, .stale = stale },
+        };
+        post_sensor_event(&evt);
+    }
+
+    __atomic_store_n(&g_lc_stale, ctx->lc_stale, __ATOMIC_RELEASE);
+}
+
+static void job_loadcell(void *arg)
+{
+    sensor_ctx_t *ctx = arg;
+    loadcell_sample_t sample;
+    int64_t load_us = 0;
+    bool empty = !app_state_person_present();
+
+    while (xQueueReceive(g_loadcell_queue, &sample, 0) == pdTRUE) {
+        loadcell_t *cell = loadcells[sample.channel];
+        int32_t raw = dsp_channel_update(&ctx->lc_filter[sample.channel], sample.raw);
+        uint32_t bit = 1u << sample.channel;
+        if (__atomic_fetch_and(&g_tare_request, ~bit, __ATOMIC_ACQ_REL) & bit) {
+            cell->offset = raw;
+            calib_drift_init(&ctx->drift[sample.channel]);
+        } else {
+            cell->offset = calib_drift_update(&ctx->drift[sample.channel], raw, cell->offset, empty);
+        }
+        ctx->weight[sample.channel] = loadcell_raw_to_weight(cell, raw);
+        ctx->raw_weight[sample.channel] = loadcell_raw_to_weight(cell, sample.raw);
+        ctx->lc_last_us[sample.channel] = sample.timestamp_us;
+        if (sample.timestamp_us > load_us) load_us = sample.timestamp_us;
+
+        int32_t w = ctx->weight[sample.channel];
+        resample_push(&ctx->lc_rs[sample.channel], sample.timestamp_us, &w);
+
+        if (ctx->watch) {
+            ctx->watch_weight[sample.channel] = ctx->raw_weight[sample.channel];
+            ctx->watch_seen |= bit;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (!ctx->watch) lc_check_stale(ctx, now);
+
+    if (load_us == 0) return;
+
+    // The median and low-pass would smear a sudden loss of load over
+    // hundreds of milliseconds, so the detector sees unfiltered weights at
+    // the time they were converted, the same time base as the IMU samples.
+    fall_update_load(&g_fall, load_us, ctx->raw_weight);
+
+    if (ctx->watch && ctx->watch_seen == (1u << LC_MAX_CHANNELS) - 1) {
+        watch_check(ctx, now);
+    }
+}
+
+// Lowers t to the newest sample of a stream, unless that stream has fallen
+// more than one of its periods behind and would only hold the others back.
+static int64_t align_to(const resample_stream_t *s, int64_t t, int64_t now, uint32_t period_us)
+{
+    int64_t latest;
+
+    if (!resample_latest(s, &latest) || latest < now - (int64_t)period_us) return t;
+    return latest < t ? latest : t;
+}
+
+// Records are stamped at the newest instant every live stream has reached,
+// and each stream is interpolated to it. A stream with nothing that recent
+// (powered down, stalled) holds its last value. Timestamps never go back, as
+// the telemetry batch codes them as unsigned deltas.
+static void job_record(void *arg)
+{
+    sensor_ctx_t *ctx = arg;
+    sensor_record_t record;
+    int64_t now = esp_timer_get_time();
+    int64_t t = align_to(&ctx->imu_rs, now, now, MPU_SAMPLE_PERIOD_US);
+    bool aligned = true;
+
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        t = align_to(&ctx->lc_rs[ch], t, now, loadcells[ch]->period_us);
+    }
+    if (t <= ctx->record_last_us) t = ctx->record_last_us + 1;
+    ctx->record_last_us = t;
+
+    record.timestamp_us = t;
+    memcpy(record.accel_filtered, ctx->accel, sizeof(record.accel_filtered));
+    aligned &= resample_at(&ctx->imu_rs, record.timestamp_us, record.accel_filtered);
+
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        int32_t w = ctx->weight[ch];
+        aligned &= resample_at(&ctx->lc_rs[ch], record.timestamp_us, &w);
+        record.weight[ch] = (int16_t)w;
+    }
+    if (!aligned) g_align_held++;
+
+    app_state_publish_sample(&record);
+
+    if (ctx->wake_trigger_us != 0) {
+        uint32_t latency = (uint32_t)(now - ctx->wake_trigger_us);
+        g_power.wake_latency_last_us = latency;
+        if (latency > g_power.wake_latency_max_us) g_power.wake_latency_max_us = latency;
+        ctx->wake_trigger_us = 0;
+    }
+
+    if (spsc_ring_push(&g_sample_ring, &record) && g_process_task != NULL) {
+        xTaskNotifyGive(g_process_task);
+    }
 }
 
 static void task_sensor_read(void *pvParameters)
 {
-    int16_t local_weight[4];
-    int32_t local_accel[3];
+    static sensor_ctx_t ctx;
 
-    while (1)
-    {
-        if (mpu_read_all(&myMpu) == ESP_OK) {
-            moving_average(&myMpu);
-            local_accel[0] = myMpu.accel_ma[0];
-            local_accel[1] = myMpu.accel_ma[1];
-            local_accel[2] = myMpu.accel_ma[2];
+    trace_register_task(NULL);
+
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        dsp_channel_init(&ctx.lc_filter[ch], LOADCELL_MEDIAN_N, DSP_LPF_FS_DIV10, loadcells[ch]->offset);
+        calib_drift_init(&ctx.drift[ch]);
+        resample_init(&ctx.lc_rs[ch], 1);
+    }
+    resample_init(&ctx.imu_rs, 3);
+    ahrs_init(&ctx.ahrs, AHRS_KP_Q16, AHRS_KI_Q16);
+
+    ctx.power_last_us = esp_timer_get_time();
+    ctx.empty_since_us = ctx.power_last_us;
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        ctx.lc_last_us[ch] = ctx.power_last_us;
+    }
+
+    sched_init(&g_sched);
+    g_job_imu = sched_add(&g_sched, "imu", job_imu, &ctx, MPU_SAMPLE_PERIOD_US);
+    g_job_loadcell = sched_add(&g_sched, "loadcell", job_loadcell, &ctx, 1000000 / LOADCELL_SPS);
+    g_job_record = sched_add(&g_sched, "record", job_record, &ctx, g_record_period_us);
+    g_job_power = sched_add(&g_sched, "power", job_power, &ctx, POWER_PERIOD_US);
+
+    mpu_set_motion_cb(&myMpu, on_imu_motion, NULL);
+
+    sched_run(&g_sched);
+}
+
+static void publish_stats(char *buf, size_t len)
+{
+    size_t n = trace_report(buf, len);
+    if (n == 0) return;
+
+    ESP_LOGI(TAG, "Stats: %s", buf);
+    mqtt_publish_status(buf, n);
+}
+
+// Only the command task writes g_calib, so every save goes through here.
+static esp_err_t save_calib(void)
+{
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        g_calib.offset[ch] = loadcells[ch]->offset;
+        g_calib.scale[ch] = loadcells[ch]->scale;
+    }
+    memcpy(g_calib.accel_bias, myMpu.accel_bias, sizeof(g_calib.accel_bias));
+    memcpy(g_calib.gyro_bias, myMpu.gyro_bias, sizeof(g_calib.gyro_bias));
+
+    esp_err_t ret = calib_save(&g_calib);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Calibration saved: [%ld,%ld,%ld,%ld]",
+                 g_calib.offset[0], g_calib.offset[1], g_calib.offset[2], g_calib.offset[3]);
+    }
+    return ret;
+}
+
+static bool calib_drifted(void)
+{
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        int32_t delta = loadcells[ch]->offset - g_calib.offset[ch];
+        if (delta > CALIB_DRIFT_SAVE_MIN || delta < -CALIB_DRIFT_SAVE_MIN) return true;
+    }
+    return false;
+}
+
+static esp_err_t cmd_get_status(const command_t *cmd)
+{
+    static char report[TRACE_REPORT_MAX];
+    sensor_record_t latest;
+    command_stats_t cs;
+    spool_stats_t ss;
+    sched_stats_t js;
+    wifi_stats_t ws;
+    mqtt_stats_t ms;
+    ws_stream_stats_t ls;
+
+    app_state_get_latest(&latest);
+    command_get_stats(&cs);
+    spool_get_stats(&ss);
+
+    ESP_LOGI(TAG, "Status: P:%s W:[%d,%d,%d,%d] rate:%luHz cmd:%lu/%lu err:%lu spool:%lu/%lu",
+        app_state_person_present() ? "YES" : "NO",
+        latest.weight[0], latest.weight[1], latest.weight[2], latest.weight[3],
+        1000000 / sched_get_period(&g_sched, g_job_record),
+        cs.executed, cs.received, cs.parse_errors,
+        ss.appended, ss.drained);
+
+    for (int i = 0; i < g_sched.count; i++) {
+        sched_get_stats(&g_sched, i, &js);
+        ESP_LOGI(TAG, "Job %s: %luus runs:%lu miss:%lu exec:%lu/%lu/%luus jitter:%ldus",
+            js.name, js.period_us, js.runs, js.missed,
+            js.exec_last_us, js.exec_avg_us, js.exec_max_us, js.jitter_max_us);
+    }
+
+    wifi_get_stats(&ws);
+    mqtt_get_stats(&ms);
+    ESP_LOGI(TAG, "Net: wifi up:%lums conn:%lu drop:%lu fast:%lu/%lu last:%lums "
+        "mqtt up:%lums pub:%lums conn:%lu drop:%lu resumed:%lu reconn:%lums",
+        ws.first_connect_ms, ws.connects, ws.disconnects, ws.fast_connects, ws.fast_misses,
+        ws.last_connect_ms, ms.first_connect_ms, ms.first_publish_ms, ms.connects,
+        ms.disconnects, ms.resumed_sessions, ms.last_reconnect_ms);
+
+    uint64_t up_us = (uint64_t)esp_timer_get_time();
+    ESP_LOGI(TAG, "Power: %s active:%lu%% lc_on:%lu%% watch:%lu wake m/w:%lu/%lu lat:%lu/%luus",
+        __atomic_load_n(&g_watch, __ATOMIC_ACQUIRE) ? "WATCH" : "ACTIVE",
+        (unsigned long)(100 - g_power.watch_us * 100 / up_us),
+        (unsigned long)(100 - g_power.lc_off_us * 100 / up_us),
+        g_power.watch_entries, g_power.wakes_motion, g_power.wakes_weight,
+        g_power.wake_latency_last_us, g_power.wake_latency_max_us);
+
+    ESP_LOGI(TAG, "Loadcell: %uSPS gain:[%d,%d,%d,%d] stale:0x%lx drop:%lu held:%lu",
+        loadcells[0]->sps, loadcells[0]->gain, loadcells[1]->gain, loadcells[2]->gain,
+        loadcells[3]->gain, __atomic_load_n(&g_lc_stale, __ATOMIC_ACQUIRE),
+        loadcell_async_dropped(), g_align_held);
+
+    ESP_LOGI(TAG, "Fall: %s alerts:%lu evt_drop:%lu",
+        fall_is_latched(&g_fall) ? "LATCHED" : "armed", g_fall.alerts, g_events_dropped);
+
+    ESP_LOGI(TAG, "IMU: %ld.%02ldC rpy:[%d,%d,%d]cdeg mag:%s fifo_ovf:%lu",
+        myMpu.temp_cdeg / 100, labs(myMpu.temp_cdeg % 100),
+        g_attitude[0], g_attitude[1], g_attitude[2],
+        !myMpu.mag_present ? "none" : myMpu.mag_valid ? "ok" : "overflow",
+        myMpu.fifo_overflows);
+
+    ws_stream_get_stats(&ls);
+    ESP_LOGI(TAG, "Live: clients:%lu samples:%lu frames:%lu drop:%lu err:%lu",
+        ls.clients, ls.samples_sent, ls.frames_sent, ls.dropped, ls.send_errors);
+
+    publish_stats(report, sizeof(report));
+    return ESP_OK;
+}
+
+static esp_err_t cmd_reset_fall(const command_t *cmd)
+{
+    fall_reset(&g_fall);
+    ESP_LOGW(TAG, "Reset Fall Alert");
+    return ESP_OK;
+}
+
+static esp_err_t cmd_set_rate(const command_t *cmd)
+{
+    int32_t hz = cmd->args[0].i;
+    if (hz <= 0 || hz > SENSOR_RATE_MAX_HZ) return ESP_ERR_INVALID_ARG;
+
+    g_record_period_us = 1000000 / hz;
+    if (!__atomic_load_n(&g_watch, __ATOMIC_ACQUIRE)) {
+        sched_set_period(&g_sched, g_job_record, g_record_period_us);
+    }
+    ESP_LOGI(TAG, "Sensor rate %ldHz", hz);
+    return ESP_OK;
+}
+
+static esp_err_t cmd_set_scale(const command_t *cmd)
+{
+    int32_t ch = cmd->args[0].i;
+    float scale = cmd->args[1].f;
+    if (ch < 0 || ch >= LC_MAX_CHANNELS || !(scale > 0.0f)) return ESP_ERR_INVALID_ARG;
+
+    loadcell_set_scale(loadcells[ch], scale);
+    ESP_LOGI(TAG, "Loadcell %ld scale %.2f", ch, scale);
+    return save_calib();
+}
+
+// No temperature source is wired to the cells yet; the coefficient is only
+// stored so it survives until one is.
+static esp_err_t cmd_set_tempco(const command_t *cmd)
+{
+    int32_t ch = cmd->args[0].i;
+    int32_t ppm = cmd->args[1].i;
+    if (ch < 0 || ch >= LC_MAX_CHANNELS || ppm < INT16_MIN || ppm > INT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_calib.temp_coef_ppm[ch] = (int16_t)ppm;
+    ESP_LOGI(TAG, "Loadcell %ld tempco %ldppm/C", ch, ppm);
+    return save_calib();
+}
+
+static esp_err_t cmd_cal_imu(const command_t *cmd)
+{
+    __atomic_store_n(&g_cal_imu_request, 1, __ATOMIC_RELEASE);
+
+    for (int waited = 0; waited < CAL_IMU_TIMEOUT_MS; waited += 10) {
+        if (__atomic_load_n(&g_cal_imu_request, __ATOMIC_ACQUIRE) == 0) {
+            ESP_LOGI(TAG, "IMU bias a:[%d,%d,%d] g:[%d,%d,%d]",
+                     myMpu.accel_bias[0], myMpu.accel_bias[1], myMpu.accel_bias[2],
+                     myMpu.gyro_bias[0], myMpu.gyro_bias[1], myMpu.gyro_bias[2]);
+            return save_calib();
         }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    __atomic_store_n(&g_cal_imu_request, 0, __ATOMIC_RELEASE);
+    return ESP_ERR_TIMEOUT;
+}
+
+static esp_err_t cmd_cal_save(const command_t *cmd)
+{
+    return save_calib();
+}
 
-        local_weight[0] = loadcell_get_weight(&sensor_front_left);
-        local_weight[1] = loadcell_get_weight(&sensor_front_right);
-        local_weight[2] = loadcell_get_weight(&sensor_back_left);
-        local_weight[3] = loadcell_get_weight(&sensor_back_right);
+// The sensor task owns the filtered readings, so it applies the new offsets;
+// this only raises the request and waits for every channel to pick it up.
+static esp_err_t cmd_tare(const command_t *cmd)
+{
+    __atomic_store_n(&g_tare_request, (1u << LC_MAX_CHANNELS) - 1, __ATOMIC_RELEASE);
 
-        if (xSemaphoreTake(g_data_mutex, portMAX_DELAY) == pdTRUE)
-        {
-            memcpy(g_data.weight, local_weight, sizeof(local_weight));
-            memcpy(g_data.accel_filtered, local_accel, sizeof(local_accel));
-            xSemaphoreGive(g_data_mutex);
+    for (int waited = 0; waited < TARE_TIMEOUT_MS; waited += 10) {
+        if (__atomic_load_n(&g_tare_request, __ATOMIC_ACQUIRE) == 0) {
+            ESP_LOGI(TAG, "Tare done");
+            return save_calib();
         }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    __atomic_store_n(&g_tare_request, 0, __ATOMIC_RELEASE);
+    return ESP_ERR_TIMEOUT;
+}
+
+static uint32_t drain_spool(void)
+{
+    uint32_t sent = 0;
+    size_t len;
+
+    while (sent < SPOOL_DRAIN_PER_PERIOD && mqtt_is_connected()) {
+        if (spool_peek(g_spool_frame, sizeof(g_spool_frame), &len) != ESP_OK) break;
+        if (mqtt_publish_telemetry(g_spool_frame, len) != ESP_OK) break;
+        spool_consume();
+        sent++;
+    }
+
+    return sent;
+}
+
+static void on_posture_event(const posture_event_t *evt, void *ctx)
+{
+    char payload[96];
 
-        vTaskDelay(pdMS_TO_TICKS(20));
+    if (evt->id != POSTURE_EVT_SHIFT) {
+        app_state_set_presence(evt->id == POSTURE_EVT_ENTER);
+    }
+
+    int len = snprintf(payload, sizeof(payload),
+        "{\"evt\":\"%s\",\"ts\":%lld,\"w\":%ld,\"x\":%d,\"y\":%d}",
+        posture_event_name(evt->id), evt->timestamp_us, evt->total, evt->cog_x, evt->cog_y);
+
+    ESP_LOGI("PROC", "%s", payload);
+    mqtt_publish_event(payload, (size_t)len);
+}
+
+static void publish_epoch(const epoch_features_t *f)
+{
+    char payload[256];
+
+    int len = snprintf(payload, sizeof(payload),
+        "{\"ts\":%lld,\"dur\":%lu,\"n\":%lu,\"act\":%u,\"pres\":%u,\"energy\":%lu,"
+        "\"w\":%ld,\"wvar\":%lu,\"resp_pw\":%lu,\"resp_pm\":%u,\"resp_bpm10\":%u}",
+        f->start_us, f->duration_ms, f->samples, f->activity_count, f->presence_pct,
+        f->movement_energy, f->weight_mean, f->weight_var, f->resp_power,
+        f->resp_ratio_permille, f->resp_rate_bpm_x10);
+
+    if (mqtt_publish_epoch(payload, (size_t)len) != ESP_OK) {
+        ESP_LOGW("PROC", "Epoch dropped: %s", payload);
+    }
+}
+
+// Latency runs from the impact sample, or for an edge exit from the sample
+// that raised it, to the hand-off to MQTT.
+static void publish_fall_alert(const fall_alert_t *alert)
+{
+    char payload[128];
+    int64_t origin_us = alert->id == FALL_ALERT_FALL ? alert->impact_us : alert->timestamp_us;
+
+    int len = snprintf(payload, sizeof(payload),
+        "{\"alert\":\"%s\",\"ts\":%lld,\"impact\":%lld,\"peak\":%ld,\"x\":%d,\"y\":%d}",
+        fall_alert_name(alert->id), alert->timestamp_us, alert->impact_us,
+        alert->peak_mg, alert->cog_x, alert->cog_y);
+
+    esp_err_t ret = mqtt_publish_event(payload, (size_t)len);
+    ESP_LOGW("PROC", "%s (lat %lldus, %s)", payload,
+             esp_timer_get_time() - origin_us, esp_err_to_name(ret));
+}
+
+static void publish_lc_stale(const lc_stale_event_t *lc)
+{
+    char payload[80];
+
+    int len = snprintf(payload, sizeof(payload),
+        "{\"evt\":\"%s\",\"ts\":%lld,\"ch\":%d,\"age\":%lld}",
+        lc->stale ? "lc_stale" : "lc_ok", lc->timestamp_us, lc->channel, lc->age_us / 1000);
+
+    ESP_LOGW("PROC", "%s", payload);
+    mqtt_publish_event(payload, (size_t)len);
+}
+
+static void handle_sensor_events(void)
+{
+    sensor_event_t evt;
+
+    while (xQueueReceive(g_event_queue, &evt, 0) == pdTRUE) {
+        switch (evt.id) {
+            case SENSOR_EVT_FALL:
+                publish_fall_alert(&evt.fall);
+                break;
+            case SENSOR_EVT_LC_STALE:
+                publish_lc_stale(&evt.lc);
+                break;
+        }
     }
 }
 
 static void task_process_publish(void *pvParameters)
 {
-    shared_data_t local;
-    uint8_t presence_counter = 0;
+    sensor_record_t rec;
+    sensor_record_t local = {0};
+    epoch_features_t features;
+    uint32_t received = 0;
+    uint32_t batches_sent = 0;
+    uint32_t batches_spooled = 0;
+    uint32_t batches_dropped = 0;
+    TickType_t last_report = xTaskGetTickCount();
+    TickType_t last_stats = last_report;
+    TickType_t last_calib = last_report;
+    static char report[TRACE_REPORT_MAX];
+
+    trace_register_task(NULL);
+
+    telemetry_batch_init(&g_telemetry);
+    posture_init(&g_posture, PRESENCE_THRESHOLD_KG, PRESENCE_EXIT_THRESHOLD_KG,
+                 PRESENCE_DEBOUNCE_COUNT, on_posture_event, NULL);
+    epoch_init(&g_epoch);
 
     while (1)
     {
-        if (xSemaphoreTake(g_data_mutex, portMAX_DELAY) == pdTRUE)
-        {
-            memcpy(&local, &g_data, sizeof(shared_data_t));
-            xSemaphoreGive(g_data_mutex);
-        }
+        // Batches fill at the watch record rate, so they already go out less
+        // often; the spool drain and log follow the same slower cadence.
+        uint32_t period_ms = __atomic_load_n(&g_watch, __ATOMIC_ACQUIRE) ? WATCH_PROCESS_PERIOD_MS
+                                                                        : PROCESS_PERIOD_MS;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(period_ms));
+        handle_sensor_events();
+
+        while (spsc_ring_pop(&g_sample_ring, &rec)) {
+            TRACE_SCOPE(TRACE_PROCESS_RECORD);
+            local = rec;
+            received++;
 
-        int32_t total_weight = local.weight[0] + local.weight[1]
-                             + local.weight[2] + local.weight[3];
+            posture_update(&g_posture, &rec);
+            ws_stream_publish(&rec, g_posture.present, g_posture.cog_x, g_posture.cog_y);
 
-        if (total_weight > PRESENCE_THRESHOLD_KG) {
-            if (presence_counter < PRESENCE_DEBOUNCE_COUNT) {
-                presence_counter++;
+            if (epoch_update(&g_epoch, &rec, g_posture.present, &features)) {
+                publish_epoch(&features);
             }
-        } else {
-            if (presence_counter > 0) {
-                presence_counter--;
+
+            if (telemetry_batch_add(&g_telemetry, &rec, g_posture.present)) {
+                const uint8_t *frame;
+                size_t len = telemetry_batch_finish(&g_telemetry, &frame);
+                if (mqtt_publish_telemetry(frame, len) == ESP_OK) {
+                    batches_sent++;
+                } else if (spool_append(frame, len) == ESP_OK) {
+                    batches_spooled++;
+                } else {
+                    batches_dropped++;
+                }
+                telemetry_batch_reset(&g_telemetry);
             }
         }
 
-        bool detected = (presence_counter >= PRESENCE_DEBOUNCE_COUNT);
+        TickType_t now = xTaskGetTickCount();
+        if (now - last_report < pdMS_TO_TICKS(period_ms)) continue;
+        last_report = now;
+
+        batches_sent += drain_spool();
+
+        if (now - last_stats >= pdMS_TO_TICKS(STATS_REPORT_PERIOD_MS)) {
+            last_stats = now;
+            publish_stats(report, sizeof(report));
+        }
 
-        if (xSemaphoreTake(g_data_mutex, portMAX_DELAY) == pdTRUE)
-        {
-            g_data.person_present = detected;
-            xSemaphoreGive(g_data_mutex);
+        if (now - last_calib >= pdMS_TO_TICKS(CALIB_SAVE_PERIOD_MS)) {
+            last_calib = now;
+            if (calib_drifted()) {
+                command_t save = { .id = CMD_CAL_SAVE };
+                command_post(&save);
+            }
         }
 
-        ESP_LOGI("PROC", "W:[%d,%d,%d,%d] T:%ld P:%s A:[%ld,%ld,%ld]",
+        ESP_LOGI("PROC", "W:[%d,%d,%d,%d] T:%ld~%lu dT:%ld CoG:%d,%d P:%s A:[%ld,%ld,%ld] N:%lu D:%lu B:%lu/%lu/%lu",
             local.weight[0], local.weight[1],
             local.weight[2], local.weight[3],
-            total_weight,
-            detected ? "YES" : "NO",
+            g_posture.mean, g_posture.variance, g_posture.trend,
+            g_posture.cog_x, g_posture.cog_y,
+            g_posture.present ? "YES" : "NO",
             local.accel_filtered[0],
             local.accel_filtered[1],
-            local.accel_filtered[2]);
+            local.accel_filtered[2],
+            received,
+            g_sample_ring.dropped,
+            batches_sent,
+            batches_spooled,
+            batches_dropped);
 
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        received = 0;
     }
 }
 
 void app_main(void)
 {
+    init_nvs();
     init_spi_bus();
     ESP_LOGI(TAG, "System Starting");
 
+    calib_load(&g_calib);
+
     if (mpu_init(&myMpu) == ESP_OK) {
         ESP_LOGI(TAG, "MPU Init: OK");
+        mpu_set_bias(&myMpu, g_calib.accel_bias, g_calib.gyro_bias);
+        if (mpu_fifo_start(&myMpu, MPU_PIN_NUM_INT) != ESP_OK) {
+            ESP_LOGW(TAG, "MPU FIFO start failed, polling registers");
+        }
     } else {
         ESP_LOGE(TAG, "MPU Init: FAILED");
     }
@@ -161,31 +933,38 @@ void app_main(void)
     loadcell_init(&sensor_back_left, BACK_LEFT_DT_PIN, BACK_LEFT_SCK_PIN);
     loadcell_init(&sensor_back_right, BACK_RIGHT_DT_PIN, BACK_RIGHT_SCK_PIN);
 
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    if (loadcell_init_backend(loadcells, LC_MAX_CHANNELS, LOADCELL_BACKEND) != ESP_OK) {
+        ESP_LOGW(TAG, "Loadcell backend init failed, using GPIO");
+        loadcell_init_backend(loadcells, LC_MAX_CHANNELS, LC_BACKEND_GPIO);
+    }
 
-    sensor_front_left.offset  = 8432156;  sensor_front_left.scale  = 420.5f;
-    sensor_front_right.offset = 8431200;  sensor_front_right.scale = 418.3f;
-    sensor_back_left.offset   = 8433500;  sensor_back_left.scale   = 422.1f;
-    sensor_back_right.offset  = 8430800;  sensor_back_right.scale  = 419.7f;
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        loadcells[ch]->offset = g_calib.offset[ch];
+        loadcell_set_scale(loadcells[ch], g_calib.scale[ch]);
+        ESP_ERROR_CHECK(loadcell_configure(loadcells[ch], LOADCELL_GAIN, LOADCELL_SPS));
+    }
 
-    if (wifi_init_sta_with_provisioning() != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi init failed");
-        Error_Handler();
+    if (spool_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Spool init failed, offline batches will be dropped");
     }
 
-    if (!wifi_wait_connected(60000)) {
-        ESP_LOGW(TAG, "WiFi timeout");
+    g_event_queue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(sensor_event_t));
+    if (g_event_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create event queue");
+        Error_Handler();
     }
+    fall_init(&g_fall, PRESENCE_THRESHOLD_KG, on_fall_alert, NULL);
 
-    if (mqtt_init() == ESP_OK) {
-        ESP_LOGI(TAG, "MQTT connected");
-    } else {
-        ESP_LOGW(TAG, "MQTT init failed");
+    spsc_ring_init(&g_sample_ring, g_sample_buf, sizeof(sensor_record_t), SAMPLE_RING_LEN);
+
+    g_loadcell_queue = xQueueCreate(LOADCELL_QUEUE_LEN, sizeof(loadcell_sample_t));
+    if (g_loadcell_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create loadcell queue");
+        Error_Handler();
     }
 
-    g_data_mutex = xSemaphoreCreateMutex();
-    if (g_data_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create mutex");
+    if (loadcell_start_async(loadcells, LC_MAX_CHANNELS, g_loadcell_queue) != ESP_OK) {
+        ESP_LOGE(TAG, "Loadcell async start failed");
         Error_Handler();
     }
 
@@ -202,13 +981,41 @@ void app_main(void)
 
     ret = xTaskCreatePinnedToCore(
         task_process_publish, "ProcessPub", 4096,
-        NULL, 3, NULL, 1
+        NULL, 3, &g_process_task, 1
     );
     if (ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create process task");
         Error_Handler();
     }
 
+    if (wifi_init_sta_with_provisioning() != ESP_OK) {
+        ESP_LOGE(TAG, "WiFi init failed");
+        Error_Handler();
+    }
+
+    if (ws_stream_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Live stream server start failed");
+    }
+
+    command_register(CMD_GET_STATUS, cmd_get_status);
+    command_register(CMD_RESET_FALL, cmd_reset_fall);
+    command_register(CMD_SET_RATE, cmd_set_rate);
+    command_register(CMD_SET_SCALE, cmd_set_scale);
+    command_register(CMD_TARE, cmd_tare);
+    command_register(CMD_SET_TEMPCO, cmd_set_tempco);
+    command_register(CMD_CAL_IMU, cmd_cal_imu);
+    command_register(CMD_CAL_SAVE, cmd_cal_save);
+
+    if (command_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Command task start failed");
+        Error_Handler();
+    }
+
+    // Connects in the background; until then batches go to the spool.
+    if (mqtt_init() != ESP_OK) {
+        ESP_LOGW(TAG, "MQTT init failed");
+    }
+
     ESP_LOGI(TAG, "All tasks created");
 }
 
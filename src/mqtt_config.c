@@ -1,9 +1,51 @@
 #include "mqtt_config.h"
 #include <string.h>
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "command.h"
+#include "trace.h"
 
 static const char *TAG = "MQTT";
 
 static esp_mqtt_client_handle_t mqtt_client = NULL;
+static bool mqtt_connected = false;
+
+static esp_timer_handle_t s_retry_timer = NULL;
+static uint32_t s_backoff_ms = 0;
+static int64_t s_disconnect_us = 0;
+static mqtt_stats_t s_stats;
+
+static void retry_timer_cb(void *arg)
+{
+    esp_mqtt_client_reconnect(mqtt_client);
+}
+
+static void schedule_reconnect(void)
+{
+    s_backoff_ms = (s_backoff_ms == 0) ? MQTT_BACKOFF_MIN_MS : s_backoff_ms * 2;
+    if (s_backoff_ms > MQTT_BACKOFF_MAX_MS) s_backoff_ms = MQTT_BACKOFF_MAX_MS;
+    s_stats.backoff_ms = s_backoff_ms;
+
+    esp_timer_stop(s_retry_timer);
+    esp_timer_start_once(s_retry_timer, (uint64_t)s_backoff_ms * 1000);
+}
+
+// A fresh IP means the link is back: skip whatever backoff is pending.
+static void ip_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    if (mqtt_connected) return;
+
+    esp_timer_stop(s_retry_timer);
+    s_backoff_ms = 0;
+    esp_mqtt_client_reconnect(mqtt_client);
+}
+
+static inline void mark_first_publish(void)
+{
+    if (s_stats.first_publish_ms == 0) {
+        s_stats.first_publish_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    }
+}
 
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
@@ -13,6 +55,26 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     switch (event->event_id)
     {
         case MQTT_EVENT_CONNECTED:
+        {
+            int64_t now = esp_timer_get_time();
+
+            mqtt_connected = true;
+            esp_timer_stop(s_retry_timer);
+            s_backoff_ms = 0;
+            s_stats.connects++;
+            if (s_stats.first_connect_ms == 0) {
+                s_stats.first_connect_ms = (uint32_t)(now / 1000);
+            } else {
+                s_stats.last_reconnect_ms = (uint32_t)((now - s_disconnect_us) / 1000);
+            }
+
+            // The broker kept our subscription along with the session.
+            if (event->session_present) {
+                s_stats.resumed_sessions++;
+                ESP_LOGI(TAG, "Session resumed");
+                break;
+            }
+
             subscribe_msg_id = esp_mqtt_client_subscribe(mqtt_client, TOPIC_SUB_CMD, 1);
             if (subscribe_msg_id >= 0) {
                 ESP_LOGI(TAG, "Subscribe sent (id=%d)", subscribe_msg_id);
@@ -20,6 +82,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
                 ESP_LOGE(TAG, "Subscribe failed (err=%d)", subscribe_msg_id);
             }
             break;
+        }
 
         case MQTT_EVENT_SUBSCRIBED:
             if (event->msg_id == subscribe_msg_id) {
@@ -29,34 +92,28 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
             break;
 
         case MQTT_EVENT_DISCONNECTED:
-            ESP_LOGW(TAG, "DISCONNECTED");
+            if (mqtt_connected) {
+                s_disconnect_us = esp_timer_get_time();
+                s_stats.disconnects++;
+            }
+            mqtt_connected = false;
+            schedule_reconnect();
+            ESP_LOGW(TAG, "DISCONNECTED, retry in %lums", s_backoff_ms);
             break;
 
         case MQTT_EVENT_DATA:
-        {
-            char cmd[STRING_LEN];
-            ESP_LOGI(TAG, "[%.*s] %.*s", event->topic_len, event->topic, event->data_len, event->data);
-            uint8_t len = (event->data_len < STRING_LEN - 1) ? event->data_len : STRING_LEN - 1;
-            memcpy(cmd, event->data, len);
-            cmd[len] = '\0';
-
-            if (strcmp(cmd, "RESET_FALL") == 0) {
-                ESP_LOGW(TAG, "Reset Fall Alert");
-            }
-            else if (strcmp(cmd, "GET_STATUS") == 0) {
-                ESP_LOGI(TAG, "Sending device status...");
-            }
-            else {
-                ESP_LOGW(TAG, "Unknown command: %s", cmd);
+            if (event->current_data_offset == 0) {
+                ESP_LOGI(TAG, "[%.*s] %d bytes", event->topic_len, event->topic, event->total_data_len);
             }
+            command_feed(event->data, event->data_len, event->current_data_offset, event->total_data_len);
             break;
-        }
 
         case MQTT_EVENT_ERROR:
             ESP_LOGW(TAG, "MQTT ERROR type = %d", event->error_handle->error_type);
             break;
 
         case MQTT_EVENT_PUBLISHED:
+            mark_first_publish();
             ESP_LOGI(TAG, "Publish confirmed (msg_id=%d)", event->msg_id);
             break;
 
@@ -74,8 +131,21 @@ esp_err_t mqtt_init(void)
         .credentials.username = MQTT_USERNAME,
         .credentials.authentication.password = MQTT_PASSWORD,
         .broker.verification.certificate = (const char *)root_ca_pem_start,
+        .session.keepalive = MQTT_KEEPALIVE_S,
+        .session.disable_clean_session = true,
+        .network.disable_auto_reconnect = true,
+        .outbox.limit = MQTT_OUTBOX_LIMIT,
     };
 
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .name = "mqtt_retry",
+    };
+    if (esp_timer_create(&timer_args, &s_retry_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create retry timer");
+        return ESP_FAIL;
+    }
+
     mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
     if (mqtt_client == NULL) {
         ESP_LOGE(TAG, "Failed to init MQTT client");
@@ -83,6 +153,7 @@ esp_err_t mqtt_init(void)
     }
 
     esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, ip_event_handler, NULL);
     esp_mqtt_client_start(mqtt_client);
 
     return ESP_OK;
@@ -103,4 +174,66 @@ esp_err_t mqtt_stop(void)
         return ESP_FAIL;
     }
     return esp_mqtt_client_stop(mqtt_client);
-}
\ No newline at end of file
+}
+
+bool mqtt_is_connected(void)
+{
+    return mqtt_connected;
+}
+
+esp_err_t mqtt_publish_telemetry(const uint8_t *data, size_t len)
+{
+    if (mqtt_client == NULL || !mqtt_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TRACE_SCOPE(TRACE_MQTT_ENQUEUE);
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, TOPIC_PUB_DATA, (const char *)data, (int)len, 0, 0, true);
+    if (msg_id < 0) return ESP_FAIL;
+
+    mark_first_publish();
+    return ESP_OK;
+}
+
+static esp_err_t publish_reliable(const char *topic, const char *payload, size_t len)
+{
+    if (mqtt_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TRACE_SCOPE(TRACE_MQTT_ENQUEUE);
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, topic, payload, (int)len, 1, 0, true);
+    return (msg_id >= 0) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t mqtt_publish_event(const char *payload, size_t len)
+{
+    return publish_reliable(TOPIC_PUB_EVENT, payload, len);
+}
+
+esp_err_t mqtt_publish_epoch(const char *payload, size_t len)
+{
+    // Offline epochs are dropped rather than left to pile up in the outbox.
+    if (!mqtt_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return publish_reliable(TOPIC_PUB_EPOCH, payload, len);
+}
+
+// Status replies answer a live GET_STATUS; a stale one is worth nothing,
+// so it goes out at QoS 0 and only while connected.
+esp_err_t mqtt_publish_status(const char *payload, size_t len)
+{
+    if (mqtt_client == NULL || !mqtt_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TRACE_SCOPE(TRACE_MQTT_ENQUEUE);
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, TOPIC_PUB_STATUS, payload, (int)len, 0, 0, true);
+    return (msg_id >= 0) ? ESP_OK : ESP_FAIL;
+}
+
+void mqtt_get_stats(mqtt_stats_t *stats)
+{
+    *stats = s_stats;
+}
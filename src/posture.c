@@ -0,0 +1,108 @@
+#include "posture.h"
+#include <string.h>
+
+static inline int32_t abs_i32(int32_t v) { return v < 0 ? -v : v; }
+
+static inline int16_t ratio_q15(int32_t num, int32_t den)
+{
+    int32_t q = (int32_t)(((int64_t)num * 32767) / den);
+    if (q > 32767) q = 32767;
+    if (q < -32767) q = -32767;
+    return (int16_t)q;
+}
+
+bool posture_cog(const int16_t *w, int16_t *x, int16_t *y)
+{
+    int32_t total = (int32_t)w[0] + w[1] + w[2] + w[3];
+    if (total <= 0) return false;
+
+    *x = ratio_q15(((int32_t)w[1] + w[3]) - ((int32_t)w[0] + w[2]), total);
+    *y = ratio_q15(((int32_t)w[0] + w[1]) - ((int32_t)w[2] + w[3]), total);
+    return true;
+}
+
+static void emit(posture_engine_t *pe, posture_event_id_t id, int64_t timestamp_us)
+{
+    if (pe->cb == NULL) return;
+
+    posture_event_t evt = {
+        .id = id,
+        .timestamp_us = timestamp_us,
+        .total = pe->total,
+        .cog_x = pe->cog_x,
+        .cog_y = pe->cog_y,
+    };
+    pe->cb(&evt, pe->ctx);
+}
+
+void posture_init(posture_engine_t *pe, int32_t enter_threshold, int32_t exit_threshold,
+                  uint8_t confirm, posture_event_cb_t cb, void *ctx)
+{
+    memset(pe, 0, sizeof(*pe));
+    pe->enter_threshold = enter_threshold;
+    pe->exit_threshold = exit_threshold;
+    pe->confirm = confirm ? confirm : 1;
+    pe->cb = cb;
+    pe->ctx = ctx;
+}
+
+// Sliding-window sum and sum of squares give the mean and variance of the
+// total weight in O(1) per sample; trend is the change across the window.
+// Transitions use the instantaneous total so they confirm within a few samples.
+void posture_update(posture_engine_t *pe, const sensor_record_t *rec)
+{
+    const int16_t *w = rec->weight;
+    int32_t total = (int32_t)w[0] + w[1] + w[2] + w[3];
+    int32_t oldest = pe->window[pe->pos];
+
+    if (pe->fill < POSTURE_WINDOW) {
+        pe->fill++;
+        oldest = total;
+    } else {
+        pe->sum -= oldest;
+        pe->sum_sq -= (int64_t)oldest * oldest;
+    }
+
+    pe->window[pe->pos] = total;
+    pe->pos = (pe->pos + 1) & (POSTURE_WINDOW - 1);
+    pe->sum += total;
+    pe->sum_sq += (int64_t)total * total;
+
+    pe->total = total;
+    pe->mean = (int32_t)(pe->sum / pe->fill);
+    pe->variance = (uint32_t)((pe->sum_sq - pe->sum * pe->sum / pe->fill) / pe->fill);
+    pe->trend = total - oldest;
+
+    posture_cog(w, &pe->cog_x, &pe->cog_y);
+
+    bool candidate = pe->present ? (total >= pe->exit_threshold)
+                                 : (total > pe->enter_threshold);
+
+    if (candidate == pe->present) {
+        pe->counter = 0;
+    } else if (++pe->counter >= pe->confirm) {
+        pe->counter = 0;
+        pe->present = candidate;
+        pe->ref_x = pe->cog_x;
+        pe->ref_y = pe->cog_y;
+        emit(pe, candidate ? POSTURE_EVT_ENTER : POSTURE_EVT_EXIT, rec->timestamp_us);
+        return;
+    }
+
+    if (pe->present && (abs_i32(pe->cog_x - pe->ref_x) > POSTURE_SHIFT_Q15 ||
+                        abs_i32(pe->cog_y - pe->ref_y) > POSTURE_SHIFT_Q15)) {
+        pe->ref_x = pe->cog_x;
+        pe->ref_y = pe->cog_y;
+        emit(pe, POSTURE_EVT_SHIFT, rec->timestamp_us);
+    }
+}
+
+const char *posture_event_name(posture_event_id_t id)
+{
+    switch (id) {
+        case POSTURE_EVT_ENTER: return "ENTER";
+        case POSTURE_EVT_EXIT:  return "EXIT";
+        case POSTURE_EVT_SHIFT: return "SHIFT";
+        default:                return "?";
+    }
+}
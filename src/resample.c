@@ -0,0 +1,74 @@
+#include "resample.h"
+#include <string.h>
+
+#define RESAMPLE_MASK   (RESAMPLE_HISTORY - 1)
+
+_Static_assert((RESAMPLE_HISTORY & RESAMPLE_MASK) == 0, "RESAMPLE_HISTORY must be a power of two");
+
+static inline const resample_point_t *point(const resample_stream_t *s, uint8_t age)
+{
+    return &s->hist[(s->head - 1 - age) & RESAMPLE_MASK];
+}
+
+void resample_init(resample_stream_t *s, uint8_t dim)
+{
+    s->dim = dim > RESAMPLE_MAX_DIM ? RESAMPLE_MAX_DIM : dim;
+    s->head = 0;
+    s->count = 0;
+}
+
+// A sample stamped at or before the newest one is dropped; interpolating
+// across a step backwards in time has no meaning.
+void resample_push(resample_stream_t *s, int64_t t_us, const int32_t *v)
+{
+    if (s->count > 0 && t_us <= point(s, 0)->t_us) return;
+
+    resample_point_t *p = &s->hist[s->head];
+    p->t_us = t_us;
+    memcpy(p->v, v, s->dim * sizeof(int32_t));
+
+    s->head = (s->head + 1) & RESAMPLE_MASK;
+    if (s->count < RESAMPLE_HISTORY) s->count++;
+}
+
+// Outside the history the nearest end is held and false is returned, so the
+// caller can tell an interpolated value from a stale one. An empty stream
+// leaves out untouched.
+bool resample_at(const resample_stream_t *s, int64_t t_us, int32_t *out)
+{
+    if (s->count == 0) return false;
+
+    const resample_point_t *b = point(s, 0);
+    if (t_us >= b->t_us) {
+        memcpy(out, b->v, s->dim * sizeof(int32_t));
+        return t_us == b->t_us;
+    }
+
+    for (uint8_t age = 1; age < s->count; age++) {
+        const resample_point_t *a = point(s, age);
+        if (a->t_us > t_us) {
+            b = a;
+            continue;
+        }
+
+        int64_t span = b->t_us - a->t_us;
+        int64_t frac = t_us - a->t_us;
+        for (uint8_t i = 0; i < s->dim; i++) {
+            int64_t num = ((int64_t)b->v[i] - a->v[i]) * frac;
+            num += (num < 0) ? -span / 2 : span / 2;
+            out[i] = a->v[i] + (int32_t)(num / span);
+        }
+        return true;
+    }
+
+    memcpy(out, b->v, s->dim * sizeof(int32_t));
+    return false;
+}
+
+bool resample_latest(const resample_stream_t *s, int64_t *t_us)
+{
+    if (s->count == 0) return false;
+
+    *t_us = point(s, 0)->t_us;
+    return true;
+}
@@ -0,0 +1,37 @@
+#include "seqlock.h"
+#include <string.h>
+
+// Single-writer sequence lock: the counter is odd while an update is in
+// flight. Writers never wait; readers copy optimistically and retry only if
+// the counter moved (or was odd) across their copy.
+
+void seqlock_write(seqlock_t *lock, void *dst, const void *src, size_t len)
+{
+    uint32_t seq = lock->seq;
+
+    __atomic_store_n(&lock->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(dst, src, len);
+
+    __atomic_store_n(&lock->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void seqlock_read(seqlock_t *lock, void *dst, const void *src, size_t len)
+{
+    uint32_t begin, end;
+
+    while (1)
+    {
+        begin = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+
+        if ((begin & 1) == 0) {
+            memcpy(dst, src, len);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            end = __atomic_load_n(&lock->seq, __ATOMIC_RELAXED);
+            if (begin == end) return;
+        }
+
+        __atomic_fetch_add(&lock->retries, 1, __ATOMIC_RELAXED);
+    }
+}
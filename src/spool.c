@@ -0,0 +1,312 @@
+#include "spool.h"
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "trace.h"
+
+static const char *TAG = "SPOOL";
+
+// Log-structured, append-only layout: every sector starts with a header
+// carrying a monotonically increasing sequence number and its erase count,
+// followed by 4-byte aligned records. Sectors are filled strictly in ring
+// order, which spreads erases evenly over the partition. A record is
+// consumed by clearing its state field in place, so no erase is needed
+// until the writer wraps around to that sector again.
+
+#define REC_STATE_PENDING   0xFFFF
+#define REC_STATE_CONSUMED  0x0000
+#define REC_LEN_EMPTY       0xFFFF
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t erase_count;
+    uint32_t crc;
+} spool_sector_hdr_t;
+
+typedef struct {
+    uint16_t len;
+    uint16_t state;
+    uint32_t crc;
+} spool_rec_hdr_t;
+
+#define SECTOR_DATA_START   sizeof(spool_sector_hdr_t)
+#define REC_SIZE(len)       ((sizeof(spool_rec_hdr_t) + (len) + 3) & ~3u)
+#define REC_MAX_LEN         (SPOOL_SECTOR_SIZE - SECTOR_DATA_START - sizeof(spool_rec_hdr_t))
+
+static const esp_partition_t *s_part = NULL;
+static uint32_t s_sectors = 0;
+
+static uint32_t s_head_sector;
+static uint32_t s_head_off;
+static uint32_t s_head_seq;
+
+static uint32_t s_tail_sector;
+static uint32_t s_tail_off;
+
+static spool_stats_t s_stats;
+
+static inline size_t sector_addr(uint32_t sector, uint32_t off)
+{
+    return (size_t)sector * SPOOL_SECTOR_SIZE + off;
+}
+
+static bool read_sector_hdr(uint32_t sector, spool_sector_hdr_t *hdr)
+{
+    if (esp_partition_read(s_part, sector_addr(sector, 0), hdr, sizeof(*hdr)) != ESP_OK) return false;
+    if (hdr->magic != SPOOL_SECTOR_MAGIC) return false;
+    return hdr->crc == esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(spool_sector_hdr_t, crc));
+}
+
+static bool read_rec_hdr(uint32_t sector, uint32_t off, spool_rec_hdr_t *rec)
+{
+    if (off + sizeof(*rec) > SPOOL_SECTOR_SIZE) return false;
+    if (esp_partition_read(s_part, sector_addr(sector, off), rec, sizeof(*rec)) != ESP_OK) return false;
+    if (rec->len == REC_LEN_EMPTY || rec->len == 0 || rec->len > REC_MAX_LEN) return false;
+    return off + REC_SIZE(rec->len) <= SPOOL_SECTOR_SIZE;
+}
+
+// True when the record header slot at off has never been programmed.
+static bool slot_blank(uint32_t sector, uint32_t off)
+{
+    uint8_t raw[sizeof(spool_rec_hdr_t)];
+
+    if (off + sizeof(raw) > SPOOL_SECTOR_SIZE) return true;
+    if (esp_partition_read(s_part, sector_addr(sector, off), raw, sizeof(raw)) != ESP_OK) return false;
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        if (raw[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+static inline bool is_empty(void)
+{
+    return s_tail_sector == s_head_sector && s_tail_off == s_head_off;
+}
+
+static esp_err_t rotate(void)
+{
+    uint32_t next = (s_head_sector + 1) % s_sectors;
+    bool was_empty = is_empty();
+
+    if (!was_empty && next == s_tail_sector) {
+        s_tail_sector = (next + 1) % s_sectors;
+        s_tail_off = SECTOR_DATA_START;
+        s_stats.dropped_sectors++;
+    }
+
+    spool_sector_hdr_t hdr;
+    uint32_t erase_count = read_sector_hdr(next, &hdr) ? hdr.erase_count + 1 : 1;
+
+    esp_err_t ret = esp_partition_erase_range(s_part, sector_addr(next, 0), SPOOL_SECTOR_SIZE);
+    if (ret != ESP_OK) return ret;
+
+    hdr.magic = SPOOL_SECTOR_MAGIC;
+    hdr.seq = ++s_head_seq;
+    hdr.erase_count = erase_count;
+    hdr.crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, offsetof(spool_sector_hdr_t, crc));
+
+    ret = esp_partition_write(s_part, sector_addr(next, 0), &hdr, sizeof(hdr));
+    if (ret != ESP_OK) return ret;
+
+    if (erase_count > s_stats.max_erase_count) s_stats.max_erase_count = erase_count;
+
+    s_head_sector = next;
+    s_head_off = SECTOR_DATA_START;
+
+    if (was_empty) {
+        s_tail_sector = s_head_sector;
+        s_tail_off = s_head_off;
+    }
+
+    return ESP_OK;
+}
+
+// Walks the records of one sector from SECTOR_DATA_START. Returns the offset
+// just past the last well-formed record; *first_pending receives the offset
+// of the first unconsumed record, or the end offset if there is none.
+static uint32_t scan_sector(uint32_t sector, uint32_t *first_pending)
+{
+    uint32_t off = SECTOR_DATA_START;
+    spool_rec_hdr_t rec;
+
+    *first_pending = UINT32_MAX;
+
+    while (read_rec_hdr(sector, off, &rec)) {
+        if (rec.state == REC_STATE_PENDING && *first_pending == UINT32_MAX) {
+            *first_pending = off;
+        }
+        off += REC_SIZE(rec.len);
+    }
+
+    if (*first_pending == UINT32_MAX) *first_pending = off;
+    return off;
+}
+
+esp_err_t spool_init(void)
+{
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, SPOOL_PARTITION_LABEL);
+    if (s_part == NULL) {
+        ESP_LOGE(TAG, "Partition '%s' not found", SPOOL_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    s_sectors = s_part->size / SPOOL_SECTOR_SIZE;
+    if (s_sectors > SPOOL_MAX_SECTORS) s_sectors = SPOOL_MAX_SECTORS;
+    if (s_sectors < 2) return ESP_ERR_INVALID_SIZE;
+
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    uint32_t newest = UINT32_MAX, oldest = UINT32_MAX;
+    uint32_t newest_seq = 0, oldest_seq = UINT32_MAX;
+    spool_sector_hdr_t hdr;
+
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        if (!read_sector_hdr(i, &hdr)) continue;
+
+        if (hdr.erase_count > s_stats.max_erase_count) s_stats.max_erase_count = hdr.erase_count;
+        if (newest == UINT32_MAX || hdr.seq > newest_seq) {
+            newest = i;
+            newest_seq = hdr.seq;
+        }
+        if (hdr.seq < oldest_seq) {
+            oldest = i;
+            oldest_seq = hdr.seq;
+        }
+    }
+
+    if (newest == UINT32_MAX) {
+        s_head_sector = s_sectors - 1;
+        s_head_off = SPOOL_SECTOR_SIZE;
+        s_head_seq = 0;
+        s_tail_sector = s_head_sector;
+        s_tail_off = s_head_off;
+        ESP_LOGI(TAG, "Empty spool, %lu sectors", s_sectors);
+        return ESP_OK;
+    }
+
+    uint32_t pending;
+    s_head_sector = newest;
+    s_head_seq = newest_seq;
+    s_head_off = scan_sector(newest, &pending);
+    // A header torn by a power cut is neither a record nor blank flash; it
+    // cannot be programmed over, so the rest of the sector is given up.
+    if (!slot_blank(newest, s_head_off)) s_head_off = SPOOL_SECTOR_SIZE;
+
+    s_tail_sector = s_head_sector;
+    s_tail_off = s_head_off;
+
+    for (uint32_t i = oldest; ; i = (i + 1) % s_sectors) {
+        uint32_t end = scan_sector(i, &pending);
+        if (pending < end) {
+            s_tail_sector = i;
+            s_tail_off = pending;
+            break;
+        }
+        if (i == newest) break;
+    }
+
+    ESP_LOGI(TAG, "Recovered: head %lu@%lu tail %lu@%lu seq %lu",
+             s_head_sector, s_head_off, s_tail_sector, s_tail_off, s_head_seq);
+
+    return ESP_OK;
+}
+
+esp_err_t spool_append(const uint8_t *data, size_t len)
+{
+    TRACE_SCOPE(TRACE_SPOOL_APPEND);
+    if (s_part == NULL) return ESP_ERR_INVALID_STATE;
+    if (len == 0 || len > REC_MAX_LEN) return ESP_ERR_INVALID_SIZE;
+
+    if (s_head_off + REC_SIZE(len) > SPOOL_SECTOR_SIZE) {
+        esp_err_t ret = rotate();
+        if (ret != ESP_OK) return ret;
+    }
+
+    spool_rec_hdr_t rec = {
+        .len = (uint16_t)len,
+        .state = REC_STATE_PENDING,
+        .crc = esp_rom_crc32_le(0, data, len),
+    };
+
+    esp_err_t ret = esp_partition_write(s_part, sector_addr(s_head_sector, s_head_off), &rec, sizeof(rec));
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(s_part, sector_addr(s_head_sector, s_head_off + sizeof(rec)), data, len);
+    }
+
+    // Even a failed write may have consumed flash, so the space is skipped.
+    s_head_off += REC_SIZE(len);
+
+    if (ret == ESP_OK) s_stats.appended++;
+    return ret;
+}
+
+esp_err_t spool_peek(uint8_t *buf, size_t buf_len, size_t *len)
+{
+    spool_rec_hdr_t rec;
+
+    if (s_part == NULL) return ESP_ERR_INVALID_STATE;
+
+    while (!is_empty())
+    {
+        if (!read_rec_hdr(s_tail_sector, s_tail_off, &rec)) {
+            if (s_tail_sector == s_head_sector) {
+                s_tail_off = s_head_off;
+            } else {
+                s_tail_sector = (s_tail_sector + 1) % s_sectors;
+                s_tail_off = SECTOR_DATA_START;
+            }
+            continue;
+        }
+
+        if (rec.state != REC_STATE_PENDING) {
+            s_tail_off += REC_SIZE(rec.len);
+            continue;
+        }
+
+        if (rec.len > buf_len) return ESP_ERR_INVALID_SIZE;
+
+        esp_err_t ret = esp_partition_read(s_part, sector_addr(s_tail_sector, s_tail_off + sizeof(rec)), buf, rec.len);
+        if (ret != ESP_OK) return ret;
+
+        if (esp_rom_crc32_le(0, buf, rec.len) != rec.crc) {
+            s_stats.corrupt++;
+            s_tail_off += REC_SIZE(rec.len);
+            continue;
+        }
+
+        *len = rec.len;
+        return ESP_OK;
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t spool_consume(void)
+{
+    spool_rec_hdr_t rec;
+
+    if (s_part == NULL || is_empty()) return ESP_ERR_INVALID_STATE;
+    if (!read_rec_hdr(s_tail_sector, s_tail_off, &rec)) return ESP_ERR_INVALID_STATE;
+
+    uint16_t consumed = REC_STATE_CONSUMED;
+    esp_err_t ret = esp_partition_write(s_part,
+        sector_addr(s_tail_sector, s_tail_off + offsetof(spool_rec_hdr_t, state)),
+        &consumed, sizeof(consumed));
+
+    s_tail_off += REC_SIZE(rec.len);
+    if (ret == ESP_OK) s_stats.drained++;
+
+    return ret;
+}
+
+bool spool_is_empty(void)
+{
+    return s_part == NULL || is_empty();
+}
+
+void spool_get_stats(spool_stats_t *stats)
+{
+    *stats = s_stats;
+}
@@ -0,0 +1,65 @@
+#include "spsc_ring.h"
+#include <string.h>
+
+// Single producer / single consumer ring. head is only written by the producer
+// and tail only by the consumer; the release store on each index publishes the
+// element copy to the other side, which may be running on the other core.
+
+bool spsc_ring_init(spsc_ring_t *ring, void *storage, uint32_t elem_size, uint32_t capacity)
+{
+    if (storage == NULL || elem_size == 0) return false;
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) return false;
+
+    ring->storage = storage;
+    ring->elem_size = elem_size;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+
+    return true;
+}
+
+bool spsc_ring_push(spsc_ring_t *ring, const void *elem)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail > ring->mask) {
+        ring->dropped++;
+        return false;
+    }
+
+    memcpy(ring->storage + (head & ring->mask) * ring->elem_size, elem, ring->elem_size);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+bool spsc_ring_pop(spsc_ring_t *ring, void *elem)
+{
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) return false;
+
+    memcpy(elem, ring->storage + (tail & ring->mask) * ring->elem_size, ring->elem_size);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+uint32_t spsc_ring_count(const spsc_ring_t *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    return head - tail;
+}
+
+void spsc_ring_reset(spsc_ring_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+}
@@ -0,0 +1,83 @@
+#include "telemetry.h"
+#include <string.h>
+
+static inline uint32_t zigzag32(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static size_t put_varint(uint8_t *out, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+
+    return n;
+}
+
+static void put_le(uint8_t *out, uint64_t v, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+void telemetry_batch_init(telemetry_batch_t *batch)
+{
+    batch->seq = 0;
+    telemetry_batch_reset(batch);
+}
+
+void telemetry_batch_reset(telemetry_batch_t *batch)
+{
+    batch->len = TELEMETRY_HEADER_SIZE;
+    batch->count = 0;
+    memset(&batch->prev, 0, sizeof(batch->prev));
+}
+
+bool telemetry_batch_add(telemetry_batch_t *batch, const sensor_record_t *record, bool present)
+{
+    if (batch->count >= TELEMETRY_BATCH_SAMPLES) return true;
+
+    uint8_t *out = batch->buf + batch->len;
+    size_t n = 0;
+
+    if (batch->count == 0) {
+        batch->prev.timestamp_us = record->timestamp_us;
+        put_le(&batch->buf[6], (uint64_t)record->timestamp_us, 8);
+    }
+
+    uint64_t dt = (uint64_t)(record->timestamp_us - batch->prev.timestamp_us);
+    n += put_varint(out + n, (dt << 1) | (present ? 1 : 0));
+
+    for (int i = 0; i < SENSOR_RECORD_CHANNELS; i++) {
+        n += put_varint(out + n, zigzag32(record->weight[i] - batch->prev.weight[i]));
+    }
+    for (int i = 0; i < 3; i++) {
+        n += put_varint(out + n, zigzag32(record->accel_filtered[i] - batch->prev.accel_filtered[i]));
+    }
+
+    batch->len += n;
+    batch->count++;
+    batch->prev = *record;
+
+    return batch->count >= TELEMETRY_BATCH_SAMPLES;
+}
+
+size_t telemetry_batch_finish(telemetry_batch_t *batch, const uint8_t **frame)
+{
+    batch->buf[0] = TELEMETRY_MAGIC;
+    batch->buf[1] = TELEMETRY_VERSION;
+    put_le(&batch->buf[2], batch->seq, 2);
+    batch->buf[4] = batch->count;
+    batch->buf[5] = 0;
+
+    batch->seq++;
+    *frame = batch->buf;
+
+    return batch->len;
+}
@@ -0,0 +1,156 @@
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t hist[TRACE_HIST_BUCKETS];
+} trace_stats_t;
+
+static const char *const s_probe_names[TRACE_PROBE_COUNT] = {
+    [TRACE_LC_FRAME]       = "lc_frame",
+    [TRACE_LC_CRITICAL]    = "lc_crit",
+    [TRACE_MPU_READ]       = "mpu_read",
+    [TRACE_MPU_FIFO_DRAIN] = "mpu_fifo",
+    [TRACE_MQTT_ENQUEUE]   = "mqtt_enq",
+    [TRACE_SPOOL_APPEND]   = "spool_app",
+    [TRACE_PROCESS_RECORD] = "proc_rec",
+};
+
+// One set of counters per core: a core only ever writes its own, so masking
+// local interrupts is enough to keep an update atomic without a spinlock.
+static trace_stats_t s_stats[portNUM_PROCESSORS][TRACE_PROBE_COUNT];
+
+static portMUX_TYPE s_task_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_tasks[TRACE_MAX_TASKS];
+static uint8_t s_task_count = 0;
+
+// Log-linear buckets: the octave of the value plus TRACE_HIST_SUB_BITS of
+// mantissa, so every bucket is within 25% of its neighbours.
+static inline uint32_t bucket_of(uint32_t v)
+{
+    if (v < (1u << TRACE_HIST_SUB_BITS)) return v;
+
+    uint32_t msb = 31 - __builtin_clz(v);
+    uint32_t sub = (v >> (msb - TRACE_HIST_SUB_BITS)) & ((1u << TRACE_HIST_SUB_BITS) - 1);
+    return ((msb - TRACE_HIST_SUB_BITS + 1) << TRACE_HIST_SUB_BITS) + sub;
+}
+
+static inline uint32_t bucket_floor(uint32_t b)
+{
+    if (b < (1u << TRACE_HIST_SUB_BITS)) return b;
+
+    uint32_t msb = (b >> TRACE_HIST_SUB_BITS) + TRACE_HIST_SUB_BITS - 1;
+    uint32_t sub = b & ((1u << TRACE_HIST_SUB_BITS) - 1);
+    return (1u << msb) | (sub << (msb - TRACE_HIST_SUB_BITS));
+}
+
+void trace_record(trace_probe_t probe, uint32_t cycles)
+{
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+    trace_stats_t *st = &s_stats[esp_cpu_get_core_id()][probe];
+
+    if (st->count == 0 || cycles < st->min) st->min = cycles;
+    if (cycles > st->max) st->max = cycles;
+    st->count++;
+    st->hist[bucket_of(cycles)]++;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+void trace_register_task(TaskHandle_t task)
+{
+    if (task == NULL) task = xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL(&s_task_lock);
+    if (s_task_count < TRACE_MAX_TASKS) s_tasks[s_task_count++] = task;
+    portEXIT_CRITICAL(&s_task_lock);
+}
+
+static void merge(trace_probe_t probe, trace_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const trace_stats_t *st = &s_stats[core][probe];
+        if (st->count == 0) continue;
+
+        if (out->count == 0 || st->min < out->min) out->min = st->min;
+        if (st->max > out->max) out->max = st->max;
+        out->count += st->count;
+        for (int b = 0; b < TRACE_HIST_BUCKETS; b++) out->hist[b] += st->hist[b];
+    }
+}
+
+static inline unsigned long to_ns(uint32_t cycles, uint32_t mhz)
+{
+    return (unsigned long)((uint64_t)cycles * 1000 / mhz);
+}
+
+static uint32_t percentile(const trace_stats_t *st, uint32_t pct)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)st->count * pct + 99) / 100);
+    uint32_t seen = 0;
+
+    for (uint32_t b = 0; b < TRACE_HIST_BUCKETS; b++) {
+        seen += st->hist[b];
+        if (seen >= rank) {
+            uint32_t v = bucket_floor(b);
+            if (v < st->min) v = st->min;
+            if (v > st->max) v = st->max;
+            return v;
+        }
+    }
+    return st->max;
+}
+
+// Compact JSON: per probe [count, min, p50, p99, max] in ns, then the stack
+// high-water mark of every registered task in bytes.
+size_t trace_report(char *buf, size_t len)
+{
+    uint32_t mhz = esp_rom_get_cpu_ticks_per_us();
+    trace_stats_t st;
+    size_t n = 0;
+
+#define APPEND(...) do { \
+        int w = snprintf(buf + n, len - n, __VA_ARGS__); \
+        if (w < 0 || (size_t)w >= len - n) return n; \
+        n += w; \
+    } while (0)
+
+    if (len == 0) return 0;
+    buf[0] = '\0';
+
+    APPEND("{\"probes\":{");
+    for (int p = 0; p < TRACE_PROBE_COUNT; p++) {
+        merge((trace_probe_t)p, &st);
+        APPEND("%s\"%s\":[%" PRIu32 ",%lu,%lu,%lu,%lu]", p ? "," : "", s_probe_names[p],
+               st.count,
+               to_ns(st.min, mhz),
+               to_ns(percentile(&st, 50), mhz),
+               to_ns(percentile(&st, 99), mhz),
+               to_ns(st.max, mhz));
+    }
+
+    APPEND("},\"stack\":{");
+    for (uint8_t i = 0; i < s_task_count; i++) {
+        APPEND("%s\"%s\":%u", i ? "," : "", pcTaskGetName(s_tasks[i]),
+               (unsigned)uxTaskGetStackHighWaterMark(s_tasks[i]));
+    }
+
+    APPEND("},\"heap\":%" PRIu32 "}", esp_get_free_heap_size());
+
+#undef APPEND
+
+    return n;
+}
+
+#endif
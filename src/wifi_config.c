@@ -4,7 +4,85 @@ static const char *TAG = "WIFI";
 
 EventGroupHandle_t s_wifi_event_group = NULL;
 
-static int s_retry_num = 0;
+static esp_timer_handle_t s_retry_timer = NULL;
+static uint32_t s_backoff_ms = 0;
+static bool s_fast_connect = false;
+static bool s_fast_attempt = false;
+static int64_t s_connect_start_us = 0;
+static wifi_stats_t s_stats;
+
+static void start_connect(void)
+{
+    s_connect_start_us = esp_timer_get_time();
+    s_fast_attempt = s_fast_connect;
+    esp_wifi_connect();
+}
+
+static void retry_timer_cb(void *arg)
+{
+    start_connect();
+}
+
+static bool load_ap_cache(wifi_ap_cache_t *ap)
+{
+    nvs_handle_t handle;
+    size_t len = sizeof(*ap);
+
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return false;
+    esp_err_t ret = nvs_get_blob(handle, WIFI_NVS_KEY_AP, ap, &len);
+    nvs_close(handle);
+
+    return ret == ESP_OK && len == sizeof(*ap) && ap->channel != 0;
+}
+
+// Called on every association, so only touch flash when the AP changed.
+static void save_ap_cache(void)
+{
+    wifi_ap_record_t info;
+    wifi_ap_cache_t ap = {0}, cached;
+    nvs_handle_t handle;
+
+    if (esp_wifi_sta_get_ap_info(&info) != ESP_OK) return;
+    memcpy(ap.bssid, info.bssid, sizeof(ap.bssid));
+    ap.channel = info.primary;
+
+    if (load_ap_cache(&cached) && memcmp(&cached, &ap, sizeof(ap)) == 0) return;
+
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return;
+    if (nvs_set_blob(handle, WIFI_NVS_KEY_AP, &ap, sizeof(ap)) == ESP_OK) nvs_commit(handle);
+    nvs_close(handle);
+
+    ESP_LOGI(TAG, "Cached AP on channel %u", ap.channel);
+}
+
+// Pins the stored BSSID and channel so association skips the full scan.
+static void apply_ap_cache(void)
+{
+    wifi_ap_cache_t ap;
+    wifi_config_t cfg;
+
+    if (!load_ap_cache(&ap) || esp_wifi_get_config(WIFI_IF_STA, &cfg) != ESP_OK) return;
+
+    memcpy(cfg.sta.bssid, ap.bssid, sizeof(cfg.sta.bssid));
+    cfg.sta.bssid_set = true;
+    cfg.sta.channel = ap.channel;
+    cfg.sta.scan_method = WIFI_FAST_SCAN;
+
+    s_fast_connect = esp_wifi_set_config(WIFI_IF_STA, &cfg) == ESP_OK;
+}
+
+static void clear_ap_cache(void)
+{
+    wifi_config_t cfg;
+
+    s_fast_connect = false;
+    if (esp_wifi_get_config(WIFI_IF_STA, &cfg) != ESP_OK) return;
+
+    cfg.sta.bssid_set = false;
+    cfg.sta.channel = 0;
+    cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+}
 
 static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
@@ -13,23 +91,34 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
         switch (event_id)
         {
             case WIFI_EVENT_STA_START:
-                esp_wifi_connect();
+                start_connect();
                 break;
 
             case WIFI_EVENT_STA_DISCONNECTED:
                 if (s_wifi_event_group) {
                     xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
                 }
-                if (s_retry_num < MAX_RETRY_COUNT) {
-                    s_retry_num++;
-                    ESP_LOGW(TAG, "Retry %d/%d", s_retry_num, MAX_RETRY_COUNT);
-                    esp_wifi_connect();
-                } else {
-                    ESP_LOGE(TAG, "Connect failed");
-                    if (s_wifi_event_group) {
-                        xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-                    }
+                s_stats.disconnects++;
+
+                // A stale cache (AP moved channel or was replaced) costs one
+                // attempt, then we fall back to a normal scan straight away.
+                // Losing a link that the cache did establish is not a miss.
+                if (s_fast_attempt) {
+                    s_fast_attempt = false;
+                    ESP_LOGW(TAG, "Cached AP not found, scanning");
+                    s_stats.fast_misses++;
+                    clear_ap_cache();
+                    start_connect();
+                    break;
                 }
+
+                s_backoff_ms = (s_backoff_ms == 0) ? WIFI_BACKOFF_MIN_MS : s_backoff_ms * 2;
+                if (s_backoff_ms > WIFI_BACKOFF_MAX_MS) s_backoff_ms = WIFI_BACKOFF_MAX_MS;
+                s_stats.backoff_ms = s_backoff_ms;
+
+                ESP_LOGW(TAG, "Retry in %lums", s_backoff_ms);
+                esp_timer_stop(s_retry_timer);
+                esp_timer_start_once(s_retry_timer, (uint64_t)s_backoff_ms * 1000);
                 break;
 
             default:
@@ -39,8 +128,19 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
     {
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "Connected, IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_num = 0;
+        int64_t now = esp_timer_get_time();
+
+        s_stats.connects++;
+        s_stats.last_connect_ms = (uint32_t)((now - s_connect_start_us) / 1000);
+        if (s_stats.first_connect_ms == 0) s_stats.first_connect_ms = (uint32_t)(now / 1000);
+        if (s_fast_attempt) s_stats.fast_connects++;
+        s_backoff_ms = 0;
+
+        ESP_LOGI(TAG, "Connected, IP: " IPSTR " (%lums%s)", IP2STR(&event->ip_info.ip),
+                 s_stats.last_connect_ms, s_fast_attempt ? ", cached AP" : "");
+        s_fast_attempt = false;
+
+        save_ap_cache();
         if (s_wifi_event_group) {
             xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
         }
@@ -80,21 +180,18 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
 
 esp_err_t wifi_init_sta_with_provisioning(void)
 {
-    esp_err_t ret;
-
-    ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-
     s_wifi_event_group = xEventGroupCreate();
     if (s_wifi_event_group == NULL) {
         ESP_LOGE(TAG, "Event group create failed");
         return ESP_FAIL;
     }
 
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_retry_timer));
+
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     esp_netif_create_default_wifi_sta();
@@ -119,6 +216,7 @@ esp_err_t wifi_init_sta_with_provisioning(void)
         ESP_LOGI(TAG, "Already provisioned");
         wifi_prov_mgr_deinit();
         ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+        apply_ap_cache();
         ESP_ERROR_CHECK(esp_wifi_start());
     } else {
         ESP_LOGI(TAG, "Starting BLE provisioning");
@@ -141,11 +239,23 @@ bool wifi_wait_connected(uint32_t timeout_ms)
 
     EventBits_t bits = xEventGroupWaitBits(
         s_wifi_event_group,
-        WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+        WIFI_CONNECTED_BIT,
         pdFALSE,
         pdFALSE,
         pdMS_TO_TICKS(timeout_ms)
     );
 
     return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
+void wifi_get_stats(wifi_stats_t *stats)
+{
+    *stats = s_stats;
+}
+
+// Modem sleep only: MAX_MODEM skips more DTIM beacons, trading downlink
+// latency for current while nobody is in bed.
+esp_err_t wifi_set_power_save(bool save)
+{
+    return esp_wifi_set_ps(save ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM);
 }
\ No newline at end of file
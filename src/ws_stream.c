@@ -0,0 +1,236 @@
+#include "ws_stream.h"
+#include <string.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "command.h"
+
+static const char *TAG = "WS";
+
+#define WS_QUEUE_MASK   (WS_CLIENT_QUEUE_LEN - 1)
+
+_Static_assert((WS_CLIENT_QUEUE_LEN & WS_QUEUE_MASK) == 0, "WS_CLIENT_QUEUE_LEN must be a power of two");
+
+typedef struct {
+    int fd;
+    bool send_pending;
+    uint8_t head;
+    uint8_t count;
+    ws_sample_t queue[WS_CLIENT_QUEUE_LEN];
+} ws_client_t;
+
+static httpd_handle_t s_server = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static ws_client_t s_clients[WS_MAX_CLIENTS];
+static uint32_t s_client_count = 0;
+static uint16_t s_seq = 0;
+static ws_stream_stats_t s_stats;
+
+// Only touched from the httpd task, which runs every send_work() in turn.
+static ws_sample_t s_send_buf[WS_CLIENT_QUEUE_LEN];
+
+static bool add_client(int fd)
+{
+    bool added = false;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WS_MAX_CLIENTS && !added; i++) {
+        ws_client_t *c = &s_clients[i];
+        if (c->fd >= 0) continue;
+
+        c->fd = fd;
+        c->head = 0;
+        c->count = 0;
+        added = true;
+        s_client_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return added;
+}
+
+static void remove_client(int fd)
+{
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (s_clients[i].fd != fd) continue;
+
+        s_clients[i].fd = -1;
+        s_clients[i].count = 0;
+        s_client_count--;
+        break;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// Drains everything queued for one client into a single binary message, so a
+// slow client gets fewer, larger messages instead of falling further behind.
+static void send_work(void *arg)
+{
+    ws_client_t *c = arg;
+
+    while (1) {
+        portENTER_CRITICAL(&s_lock);
+        int fd = c->fd;
+        uint8_t n = c->count;
+        if (fd < 0 || n == 0) {
+            c->send_pending = false;
+            portEXIT_CRITICAL(&s_lock);
+            return;
+        }
+        for (uint8_t i = 0; i < n; i++) {
+            s_send_buf[i] = c->queue[(c->head - n + i) & WS_QUEUE_MASK];
+        }
+        c->count = 0;
+        portEXIT_CRITICAL(&s_lock);
+
+        httpd_ws_frame_t frame = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = (uint8_t *)s_send_buf,
+            .len = n * sizeof(ws_sample_t),
+        };
+
+        if (httpd_ws_send_frame_async(s_server, fd, &frame) != ESP_OK) {
+            portENTER_CRITICAL(&s_lock);
+            s_stats.send_errors++;
+            c->send_pending = false;
+            portEXIT_CRITICAL(&s_lock);
+            httpd_sess_trigger_close(s_server, fd);
+            return;
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        s_stats.frames_sent++;
+        s_stats.samples_sent += n;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+void ws_stream_publish(const sensor_record_t *rec, bool present, int16_t cog_x, int16_t cog_y)
+{
+    ws_client_t *kick[WS_MAX_CLIENTS];
+    int nkick = 0;
+
+    uint16_t seq = s_seq++;
+    if (__atomic_load_n(&s_client_count, __ATOMIC_RELAXED) == 0) return;
+
+    ws_sample_t s = {
+        .type = WS_SAMPLE_TYPE,
+        .flags = present ? WS_FLAG_PRESENT : 0,
+        .seq = seq,
+        .t_ms = (uint32_t)(rec->timestamp_us / 1000),
+        .cog_x = cog_x,
+        .cog_y = cog_y,
+    };
+    memcpy(s.weight, rec->weight, sizeof(s.weight));
+    memcpy(s.accel, rec->accel_filtered, sizeof(s.accel));
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ws_client_t *c = &s_clients[i];
+        if (c->fd < 0) continue;
+
+        // Drop-oldest: the newest sample is always the one worth showing.
+        if (c->count == WS_CLIENT_QUEUE_LEN) {
+            c->count--;
+            s_stats.dropped++;
+        }
+        c->queue[c->head] = s;
+        c->head = (c->head + 1) & WS_QUEUE_MASK;
+        c->count++;
+
+        if (!c->send_pending) {
+            c->send_pending = true;
+            kick[nkick++] = c;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < nkick; i++) {
+        if (httpd_queue_work(s_server, send_work, kick[i]) != ESP_OK) {
+            portENTER_CRITICAL(&s_lock);
+            kick[i]->send_pending = false;
+            portEXIT_CRITICAL(&s_lock);
+        }
+    }
+}
+
+// Text frames from the dashboard are commands in the same grammar as the
+// MQTT command topic.
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        int fd = httpd_req_to_sockfd(req);
+        if (!add_client(fd)) {
+            ESP_LOGW(TAG, "Client %d rejected, %d already connected", fd, WS_MAX_CLIENTS);
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "Client %d connected", fd);
+        return ESP_OK;
+    }
+
+    uint8_t buf[WS_RX_MAX];
+    httpd_ws_frame_t frame = {0};
+
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) return ret;
+    if (frame.len > sizeof(buf)) return ESP_ERR_INVALID_SIZE;
+
+    frame.payload = buf;
+    ret = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (ret != ESP_OK || frame.type != HTTPD_WS_TYPE_TEXT) return ret;
+
+    command_submit((const char *)buf, frame.len);
+    return ESP_OK;
+}
+
+static void on_close(httpd_handle_t hd, int fd)
+{
+    remove_client(fd);
+    close(fd);
+}
+
+esp_err_t ws_stream_start(void)
+{
+    if (s_server != NULL) return ESP_ERR_INVALID_STATE;
+
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        s_clients[i].fd = -1;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.lru_purge_enable = true;
+    config.send_wait_timeout = WS_SEND_TIMEOUT_S;
+    config.close_fn = on_close;
+
+    esp_err_t ret = httpd_start(&s_server, &config);
+    if (ret != ESP_OK) {
+        s_server = NULL;
+        return ret;
+    }
+
+    const httpd_uri_t ws_uri = {
+        .uri = WS_STREAM_URI,
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .is_websocket = true,
+    };
+
+    ret = httpd_register_uri_handler(s_server, &ws_uri);
+    if (ret != ESP_OK) {
+        httpd_stop(s_server);
+        s_server = NULL;
+    }
+
+    return ret;
+}
+
+void ws_stream_get_stats(ws_stream_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+    stats->clients = __atomic_load_n(&s_client_count, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,632 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "sim.h"
+#include "sim_hx711.h"
+#include "sim_mpu9250.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "app_config.h"
+#include "drv_loadcell.h"
+#include "drv_mpu.h"
+#include "dsp_filter.h"
+#include "spsc_ring.h"
+#include "telemetry.h"
+#include "posture.h"
+#include "fall_detect.h"
+#include "epoch_features.h"
+#include "resample.h"
+#include "ahrs.h"
+#include "spool.h"
+#include "trace.h"
+
+/*
+ * Per-stage latency and throughput of the firmware on the host HAL. Pure
+ * stages are timed in batches, so ns/op is meaningful down to a few ns;
+ * device stages are timed one transaction at a time against the HX711 and
+ * MPU9250 models, with the models' wall-clock pacing excluded, and against
+ * the file-backed flash. Cycles are host TSC cycles, not Xtensa ones:
+ * compare stages and revisions with each other, not with the target.
+ *
+ *   bench [--quick] [stage...]
+ */
+
+#define BENCH_MAX_SAMPLES   4096
+
+typedef struct {
+    const char *name;
+    uint64_t ops;
+    int64_t total_ns;
+    uint64_t total_cycles;
+    uint32_t n;
+    double per_op_ns[BENCH_MAX_SAMPLES];
+} bench_acc_t;
+
+static bool s_quick;
+static bench_acc_t s_acc;
+
+static void acc_begin(const char *name)
+{
+    memset(&s_acc, 0, sizeof(s_acc));
+    s_acc.name = name;
+}
+
+static void acc_add(uint32_t ops, int64_t ns, uint32_t cycles)
+{
+    s_acc.ops += ops;
+    s_acc.total_ns += ns;
+    s_acc.total_cycles += cycles;
+    if (s_acc.n < BENCH_MAX_SAMPLES) s_acc.per_op_ns[s_acc.n++] = (double)ns / ops;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double pct(uint32_t p)
+{
+    if (s_acc.n == 0) return 0;
+    uint32_t i = (uint32_t)(((uint64_t)s_acc.n * p + 99) / 100);
+    return s_acc.per_op_ns[i ? i - 1 : 0];
+}
+
+// ops_per_s < 0 derives throughput from the timed work alone.
+static void acc_report(double ops_per_s)
+{
+    if (s_acc.ops == 0) {
+        printf("%-16s %10s\n", s_acc.name, "no data");
+        return;
+    }
+    qsort(s_acc.per_op_ns, s_acc.n, sizeof(double), cmp_double);
+    if (ops_per_s < 0) ops_per_s = s_acc.ops * 1e9 / (double)s_acc.total_ns;
+
+    printf("%-16s %10llu %12.1f %12.1f %12.1f %12.0f ", s_acc.name,
+           (unsigned long long)s_acc.ops, (double)s_acc.total_ns / s_acc.ops,
+           pct(50), pct(99), ops_per_s);
+    if (s_acc.total_cycles) {
+        printf("%10.1f\n", (double)s_acc.total_cycles / s_acc.ops);
+    } else {
+        printf("%10s\n", "-");
+    }
+}
+
+typedef void (*bench_fn_t)(void *ctx, uint32_t i);
+
+static void run_batched(const char *name, bench_fn_t fn, void *ctx, uint32_t batch)
+{
+    uint32_t batches = s_quick ? 200 : 2000;
+    uint32_t i = 0;
+
+    acc_begin(name);
+    for (uint32_t b = 0; b < batches; b++) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        for (uint32_t k = 0; k < batch; k++) fn(ctx, i++);
+        int64_t t1 = test_now_ns();
+        acc_add(batch, t1 - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+}
+
+static void make_record(sensor_record_t *rec, uint32_t i)
+{
+    rec->timestamp_us = 1000000 + (int64_t)i * 10000;
+    for (int c = 0; c < SENSOR_RECORD_CHANNELS; c++) {
+        rec->weight[c] = (int16_t)(15000 + 500 * c + (int32_t)(i % 37) * 3 - 50);
+    }
+    rec->accel_filtered[0] = (int32_t)(i % 11) - 5;
+    rec->accel_filtered[1] = (int32_t)(i % 7) - 3;
+    rec->accel_filtered[2] = 1000 + (int32_t)(i % 13) - 6;
+}
+
+static void op_dsp(void *ctx, uint32_t i)
+{
+    dsp_channel_t *ch = ctx;
+    volatile int32_t y = dsp_channel_update(ch, (int32_t)(1000 + (i * 2654435761u >> 24)));
+    (void)y;
+}
+
+typedef struct {
+    spsc_ring_t ring;
+    sensor_record_t buf[64];
+} ring_ctx_t;
+
+static void op_spsc(void *ctx, uint32_t i)
+{
+    ring_ctx_t *r = ctx;
+    sensor_record_t rec;
+
+    make_record(&rec, i);
+    spsc_ring_push(&r->ring, &rec);
+    spsc_ring_pop(&r->ring, &rec);
+}
+
+static void op_telemetry(void *ctx, uint32_t i)
+{
+    telemetry_batch_t *batch = ctx;
+    sensor_record_t rec;
+    const uint8_t *frame;
+
+    make_record(&rec, i);
+    if (telemetry_batch_add(batch, &rec, true)) {
+        telemetry_batch_finish(batch, &frame);
+        telemetry_batch_reset(batch);
+    }
+}
+
+static void op_posture(void *ctx, uint32_t i)
+{
+    sensor_record_t rec;
+
+    make_record(&rec, i);
+    posture_update(ctx, &rec);
+}
+
+static void op_fall(void *ctx, uint32_t i)
+{
+    sensor_record_t rec;
+
+    make_record(&rec, i);
+    fall_update_imu(ctx, rec.timestamp_us, rec.accel_filtered);
+    fall_update_load(ctx, rec.timestamp_us, rec.weight);
+}
+
+static void op_epoch(void *ctx, uint32_t i)
+{
+    sensor_record_t rec;
+    epoch_features_t out;
+
+    make_record(&rec, i);
+    epoch_update(ctx, &rec, true, &out);
+}
+
+static void op_resample(void *ctx, uint32_t i)
+{
+    resample_stream_t *s = ctx;
+    int32_t v[3] = { (int32_t)i, (int32_t)i * 2, (int32_t)i * 3 };
+    int32_t out[3];
+    int64_t t = 1000000 + (int64_t)i * 12500;
+
+    resample_push(s, t, v);
+    resample_at(s, t - 5000, out);
+}
+
+static void op_ahrs(void *ctx, uint32_t i)
+{
+    const int32_t gyro[3] = { 150, -80, 30 };
+    const int32_t accel[3] = { 10, -20, 1000 };
+    const int16_t mag[3] = { 200, 0, -400 };
+
+    ahrs_update(ctx, 1000000 + (int64_t)i * 10000, gyro, accel, mag);
+}
+
+// The pre-fixed-point paths, kept here as the baseline: the float EMA that
+// moving_average() used and the float weight conversion.
+#define OLD_ALPHA   0.1f
+
+typedef struct {
+    int32_t mg[3];
+    int32_t ma[3];
+} old_ema_t;
+
+static void op_ema_float(void *ctx, uint32_t i)
+{
+    old_ema_t *f = ctx;
+
+    for (int k = 0; k < 3; k++) {
+        f->mg[k] = (int32_t)((i * 2654435761u) >> (22 + k)) - 512;
+        f->ma[k] = (int32_t)(OLD_ALPHA * f->mg[k] + (1.0f - OLD_ALPHA) * f->ma[k]);
+    }
+}
+
+static void op_ema_q15(void *ctx, uint32_t i)
+{
+    MPU9250_t *dev = ctx;
+
+    for (int k = 0; k < 3; k++) dev->accel_mg[k] = (int32_t)((i * 2654435761u) >> (22 + k)) - 512;
+    moving_average(dev);
+}
+
+typedef struct {
+    loadcell_t cell;
+    volatile int16_t out;
+} weight_ctx_t;
+
+static void op_weight_float(void *ctx, uint32_t i)
+{
+    weight_ctx_t *w = ctx;
+    int32_t raw = (int32_t)(i * 2654435761u >> 8) - 0x800000;
+    float weight = (float)(raw - w->cell.offset) * 1000.0f / w->cell.scale;
+
+    w->out = (int16_t)weight;
+}
+
+static void op_weight_q16(void *ctx, uint32_t i)
+{
+    weight_ctx_t *w = ctx;
+    int32_t raw = (int32_t)(i * 2654435761u >> 8) - 0x800000;
+
+    w->out = loadcell_raw_to_weight(&w->cell, raw);
+}
+
+// A step input shows the bias the float EMA had: truncating every update,
+// it stalls once the remaining error times alpha drops below one count.
+static void report_ema_step(void)
+{
+    old_ema_t old = { 0 };
+    dsp_ema_t ema;
+
+    dsp_ema_init(&ema, ALPHA_Q15, 0);
+    int32_t q = 0;
+    for (int n = 0; n < 500; n++) {
+        old.ma[0] = (int32_t)(OLD_ALPHA * 999 + (1.0f - OLD_ALPHA) * old.ma[0]);
+        q = dsp_ema_update(&ema, 999);
+    }
+    printf("  ema step 0->999 settles at: float %ld, q15 %ld\n", (long)old.ma[0], (long)q);
+}
+
+static void bench_filters(void)
+{
+    static old_ema_t old;
+    static MPU9250_t dev;
+    static weight_ctx_t w;
+
+    for (int k = 0; k < 3; k++) {
+        dsp_median_init(&dev.accel_median[k], MPU_MEDIAN_N, 0);
+        dsp_ema_init(&dev.accel_ema[k], ALPHA_Q15, 0);
+    }
+    loadcell_set_scale(&w.cell, 431.7f);
+    w.cell.offset = 8123;
+
+    run_batched("imu_ema_float", op_ema_float, &old, 256);
+    run_batched("imu_ema_q15", op_ema_q15, &dev, 256);
+    run_batched("lc_weight_float", op_weight_float, &w, 256);
+    run_batched("lc_weight_q16", op_weight_q16, &w, 256);
+    report_ema_step();
+}
+
+static void noop_posture(const posture_event_t *evt, void *ctx) {}
+static void noop_fall(const fall_alert_t *alert, void *ctx) {}
+
+static void bench_pure(void)
+{
+    static dsp_channel_t ch;
+    static ring_ctx_t ring;
+    static telemetry_batch_t batch;
+    static posture_engine_t pe;
+    static fall_detector_t fd;
+    static epoch_t ep;
+    static resample_stream_t rs;
+    static ahrs_t ahrs;
+
+    dsp_channel_init(&ch, 3, DSP_LPF_FS_DIV10, 0);
+    run_batched("dsp_channel", op_dsp, &ch, 256);
+
+    spsc_ring_init(&ring.ring, ring.buf, sizeof(sensor_record_t), 64);
+    run_batched("spsc_push_pop", op_spsc, &ring, 256);
+
+    telemetry_batch_init(&batch);
+    run_batched("telemetry_add", op_telemetry, &batch, 256);
+
+    posture_init(&pe, 5000, 3000, 3, noop_posture, NULL);
+    run_batched("posture", op_posture, &pe, 256);
+
+    fall_init(&fd, 5000, noop_fall, NULL);
+    run_batched("fall_detect", op_fall, &fd, 256);
+
+    epoch_init(&ep);
+    run_batched("epoch", op_epoch, &ep, 256);
+
+    resample_init(&rs, 3);
+    run_batched("resample", op_resample, &rs, 256);
+
+    ahrs_init(&ahrs, AHRS_KP_Q16, AHRS_KI_Q16);
+    run_batched("ahrs", op_ahrs, &ahrs, 256);
+}
+
+static const gpio_num_t s_dout[LC_MAX_CHANNELS] = {
+    FRONT_LEFT_DT_PIN, FRONT_RIGHT_DT_PIN, BACK_LEFT_DT_PIN, BACK_RIGHT_DT_PIN,
+};
+static const gpio_num_t s_sck[LC_MAX_CHANNELS] = {
+    FRONT_LEFT_SCK_PIN, FRONT_RIGHT_SCK_PIN, BACK_LEFT_SCK_PIN, BACK_RIGHT_SCK_PIN,
+};
+
+static int32_t hx_source(void *ctx, int64_t t_us, int sel)
+{
+    int idx = (int)(intptr_t)ctx;
+    return (int32_t)(idx * 100000 - 150000 + (t_us / 1000) % 1000);
+}
+
+static bool wait_all_ready(uint32_t timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+
+    while (esp_timer_get_time() < deadline) {
+        bool ready = true;
+        for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) ready &= gpio_get_level(s_dout[ch]) == 0;
+        if (ready) return true;
+        sim_sleep_us(100);
+    }
+    return false;
+}
+
+static void bench_hx711_frames(const char *name, loadcell_t *const cells[], loadcell_backend_t backend)
+{
+    uint32_t frames = s_quick ? 20 : 200;
+    int32_t raw[LC_MAX_CHANNELS];
+
+    if (loadcell_init_backend(cells, LC_MAX_CHANNELS, backend) != ESP_OK) {
+        printf("%-16s %10s\n", name, "unsupported");
+        return;
+    }
+
+    acc_begin(name);
+    for (uint32_t k = 0; k < frames; k++) {
+        if (!wait_all_ready(200)) break;
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        esp_err_t ret = loadcell_read_raw_multi(cells, LC_MAX_CHANNELS, raw);
+        int64_t t1 = test_now_ns();
+        if (ret == ESP_OK) acc_add(1, t1 - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+}
+
+// Latency here is conversion-ready to dequeue, through the DOUT interrupt
+// and the acquisition task.
+static void bench_hx711_async(loadcell_t *const cells[])
+{
+    uint32_t samples = s_quick ? 40 : 400;
+    QueueHandle_t queue = xQueueCreate(16, sizeof(loadcell_sample_t));
+    loadcell_sample_t s;
+
+    loadcell_init_backend(cells, LC_MAX_CHANNELS, LOADCELL_BACKEND);
+    if (loadcell_start_async(cells, LC_MAX_CHANNELS, queue) != ESP_OK) {
+        printf("%-16s %10s\n", "lc_async", "failed");
+        vQueueDelete(queue);
+        return;
+    }
+
+    acc_begin("lc_async_lat");
+    int64_t start = esp_timer_get_time();
+    for (uint32_t k = 0; k < samples; k++) {
+        if (xQueueReceive(queue, &s, pdMS_TO_TICKS(500)) != pdTRUE) break;
+        acc_add(1, (esp_timer_get_time() - s.timestamp_us) * 1000, 0);
+    }
+    double rate = s_acc.ops * 1e6 / (double)(esp_timer_get_time() - start);
+    acc_report(rate);
+
+    loadcell_stop_async();
+    vQueueDelete(queue);
+}
+
+static void bench_hx711(void)
+{
+    static loadcell_t cells[LC_MAX_CHANNELS];
+    loadcell_t *ptrs[LC_MAX_CHANNELS];
+
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        loadcell_init(&cells[ch], s_dout[ch], s_sck[ch]);
+        loadcell_configure(&cells[ch], HX711_GAIN_A_128, HX711_SPS_HIGH);
+        ptrs[ch] = &cells[ch];
+        sim_hx711_attach(ch, s_dout[ch], s_sck[ch], HX711_SPS_HIGH);
+        sim_hx711_set_source(ch, hx_source, (void *)(intptr_t)ch);
+    }
+
+    bench_hx711_frames("lc_frame_gpio", ptrs, LC_BACKEND_GPIO);
+    bench_hx711_frames("lc_frame_dedic", ptrs, LC_BACKEND_DEDIC_GPIO);
+    bench_hx711_async(ptrs);
+
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) sim_hx711_detach(ch);
+}
+
+#define SPOOL_IMAGE     "bench_spool.img"
+#define SPOOL_IMAGE_SIZE (128 * SPOOL_SECTOR_SIZE)
+
+// Appends and drains real telemetry frames on the file-backed partition;
+// recovery is spool_init() scanning a full one, as after a reboot offline.
+static void bench_spool(void)
+{
+    static telemetry_batch_t batch;
+    static uint8_t buf[TELEMETRY_MAX_FRAME];
+    const uint8_t *frame = NULL;
+    size_t frame_len = 0, len;
+    uint32_t frames = s_quick ? 400 : 4000;
+
+    telemetry_batch_init(&batch);
+    for (uint32_t i = 0; frame == NULL; i++) {
+        sensor_record_t rec;
+        make_record(&rec, i);
+        if (telemetry_batch_add(&batch, &rec, true)) frame_len = telemetry_batch_finish(&batch, &frame);
+    }
+
+    if (sim_flash_open(SPOOL_IMAGE, SPOOL_IMAGE_SIZE, true) != ESP_OK || spool_init() != ESP_OK) {
+        printf("%-16s %10s\n", "spool", "no flash");
+        return;
+    }
+
+    acc_begin("spool_append");
+    for (uint32_t n = 0; n < frames; n++) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        spool_append(frame, frame_len);
+        acc_add(1, test_now_ns() - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+    spool_stats_t st;
+    spool_get_stats(&st);
+    printf("  %zu-byte frames: %.2f MB/s, dropped_sectors=%u\n", frame_len,
+           s_acc.ops * frame_len * 1e3 / (double)s_acc.total_ns, st.dropped_sectors);
+
+    acc_begin("spool_recover");
+    for (int n = 0; n < (s_quick ? 5 : 50); n++) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        spool_init();
+        acc_add(1, test_now_ns() - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+
+    acc_begin("spool_drain");
+    while (1) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        if (spool_peek(buf, sizeof(buf), &len) != ESP_OK) break;
+        spool_consume();
+        acc_add(1, test_now_ns() - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+
+    sim_flash_stats_t fs;
+    spool_get_stats(&st);
+    sim_flash_get_stats(&fs);
+    printf("  spool: corrupt=%u erases=%u max_sector_erases=%u\n", st.corrupt, fs.erases, fs.max_sector_erases);
+
+    sim_flash_close();
+    remove(SPOOL_IMAGE);
+}
+
+static void mpu_source(void *ctx, int64_t t_us, sim_mpu9250_frame_t *f)
+{
+    int16_t n = (int16_t)((t_us / 1000) % 17 - 8);
+
+    f->accel[0] = n;
+    f->accel[1] = (int16_t)-n;
+    f->accel[2] = 16384 + n;
+    f->gyro[0] = 20;
+    f->gyro[1] = -10;
+    f->gyro[2] = n;
+    f->temp = 1200;
+    f->mag[0] = 150;
+    f->mag[1] = -40;
+    f->mag[2] = -300;
+}
+
+static void bench_mpu(void)
+{
+    static MPU9250_t dev;
+    static const uint8_t asa[3] = { 0x80, 0x80, 0x80 };
+    uint32_t reads = s_quick ? 200 : 2000;
+    spi_bus_config_t buscfg = {
+        .miso_io_num = MPU_PIN_NUM_MISO,
+        .mosi_io_num = MPU_PIN_NUM_MOSI,
+        .sclk_io_num = MPU_PIN_NUM_CLK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = MPU_FIFO_BURST_MAX + 1,
+    };
+
+    sim_mpu9250_attach(MPU_SPI_HOST, MPU_PIN_NUM_CS, MPU_PIN_NUM_INT);
+    sim_mpu9250_set_source(mpu_source, NULL);
+    sim_mpu9250_set_mag(true, asa);
+
+    memset(&dev, 0, sizeof(dev));
+    if (spi_bus_initialize(MPU_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO) != ESP_OK
+        || mpu_attach(&dev, MPU_SPI_HOST, MPU_PIN_NUM_CS) != ESP_OK
+        || mpu_init(&dev) != ESP_OK) {
+        printf("%-16s %10s\n", "mpu", "init failed");
+        s_test_failures++;
+        goto out;
+    }
+
+    acc_begin("mpu_read_poll");
+    for (uint32_t k = 0; k < reads; k++) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        esp_err_t ret = mpu_read_all(&dev);
+        int64_t t1 = test_now_ns();
+        if (ret == ESP_OK) acc_add(1, t1 - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+
+    acc_begin("mpu_read_async");
+    for (uint32_t k = 0; k < reads; k++) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        esp_err_t ret = mpu_read_async_start(&dev);
+        if (ret == ESP_OK) ret = mpu_read_async_finish(&dev, portMAX_DELAY);
+        int64_t t1 = test_now_ns();
+        if (ret == ESP_OK) acc_add(1, t1 - t0, esp_cpu_get_cycle_count() - c0);
+    }
+    acc_report(-1);
+
+    // As job_imu runs it: the read started on the previous period is
+    // collected and the next one queued, so only the hand-off is timed.
+    acc_begin("mpu_read_pipe");
+    for (uint32_t k = 0; k < reads / 4; k++) {
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        int64_t t0 = test_now_ns();
+        bool done = dev.async_pending && mpu_read_async_finish(&dev, portMAX_DELAY) == ESP_OK;
+        mpu_read_async_start(&dev);
+        int64_t t1 = test_now_ns();
+        if (done) acc_add(1, t1 - t0, esp_cpu_get_cycle_count() - c0);
+        sim_sleep_us(1000);
+    }
+    while (dev.async_pending) mpu_read_async_finish(&dev, portMAX_DELAY);
+    acc_report(-1);
+
+    // Latency is the sample's reconstructed timestamp to the consumer
+    // popping it; at the FIFO watermark most of it is batching.
+    if (mpu_fifo_start(&dev, MPU_PIN_NUM_INT) == ESP_OK) {
+        mpu_sample_t s;
+        int64_t start = esp_timer_get_time();
+        int64_t end = start + (s_quick ? 500000 : 3000000);
+
+        acc_begin("mpu_fifo_lat");
+        while (esp_timer_get_time() < end) {
+            while (mpu_fifo_pop(&dev, &s)) acc_add(1, (esp_timer_get_time() - s.timestamp_us) * 1000, 0);
+            sim_sleep_us(1000);
+        }
+        acc_report(s_acc.ops * 1e6 / (double)(esp_timer_get_time() - start));
+        mpu_fifo_stop(&dev);
+    }
+
+    sim_mpu9250_stats_t st;
+    sim_mpu9250_get_stats(&st);
+    printf("  mpu model: samples=%u fifo_overflows=%u clock_violations=%u\n",
+           st.samples, st.fifo_overflows, st.clock_violations);
+
+out:
+    mpu_deinit(&dev);
+    sim_mpu9250_detach();
+}
+
+static bool wanted(int argc, char **argv, const char *stage)
+{
+    bool any = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue;
+        any = true;
+        if (strcmp(argv[i], stage) == 0) return true;
+    }
+    return !any;
+}
+
+int main(int argc, char **argv)
+{
+    static char report[TRACE_REPORT_MAX];
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) s_quick = true;
+    }
+
+    printf("host TSC %u MHz%s\n", (unsigned)esp_rom_get_cpu_ticks_per_us(), s_quick ? ", quick run" : "");
+    printf("%-16s %10s %12s %12s %12s %12s %10s\n", "stage", "ops", "ns/op", "p50", "p99", "ops/s", "cyc/op");
+
+    trace_register_task(NULL);
+    if (wanted(argc, argv, "pure")) bench_pure();
+    if (wanted(argc, argv, "filters")) bench_filters();
+    if (wanted(argc, argv, "hx711")) bench_hx711();
+    if (wanted(argc, argv, "mpu")) bench_mpu();
+    if (wanted(argc, argv, "spool")) bench_spool();
+
+    trace_report(report, sizeof(report));
+    printf("trace %s\n", report);
+
+    return test_exit("bench");
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "test_util.h"
+#include "app_config.h"
+#include "fall_detect.h"
+
+/*
+ * Replays recorded or generated traces (format in fall_tracegen.c) through
+ * the fall detector as the sensor task drives it: raw accelerations from
+ * the IMU, unfiltered weights stamped with their conversion time. Alerts
+ * are matched to the labelled falls; what is left over counts as a false
+ * positive. Latency is measured in trace time from the impact sample to
+ * the sample that completed the pattern, as the firmware logs it.
+ *
+ *   fall_replay [--max-latency-ms N] [--max-fp N] <trace.csv | dir>...
+ *
+ * Exits non-zero when a labelled fall is missed, a detection is slower
+ * than the bound, or there are more false positives than allowed.
+ */
+
+#define MAX_LABELS      256
+#define MATCH_US        200000
+
+typedef struct {
+    int64_t label_us[MAX_LABELS];
+    bool matched[MAX_LABELS];
+    int labels;
+    int detected;
+    int false_pos;
+    int edge_exits;
+    int64_t latency_max_us;
+    int64_t latency_sum_us;
+    int64_t first_us;
+    int64_t last_us;
+    uint64_t samples;
+} replay_t;
+
+static int64_t s_max_latency_us = 200000;
+static int s_max_fp = 0;
+
+static void on_alert(const fall_alert_t *alert, void *ctx)
+{
+    replay_t *r = ctx;
+
+    if (alert->id == FALL_ALERT_EDGE_EXIT) {
+        r->edge_exits++;
+        return;
+    }
+
+    for (int i = 0; i < r->labels; i++) {
+        int64_t d = alert->impact_us - r->label_us[i];
+        if (!r->matched[i] && d >= -MATCH_US && d <= MATCH_US) {
+            int64_t latency = alert->timestamp_us - alert->impact_us;
+            r->matched[i] = true;
+            r->detected++;
+            r->latency_sum_us += latency;
+            if (latency > r->latency_max_us) r->latency_max_us = latency;
+            return;
+        }
+    }
+    r->false_pos++;
+    fprintf(stderr, "  false positive at %.3f s (impact %.3f s, peak %ld mg)\n",
+            alert->timestamp_us / 1e6, alert->impact_us / 1e6, (long)alert->peak_mg);
+}
+
+// Labels are read ahead of the samples so an alert can be matched to a
+// label that appears later in the file than the impact that caused it.
+static bool load_labels(FILE *f, replay_t *r)
+{
+    char line[256];
+    long long t;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] != 'E' || sscanf(line, "E,%lld,", &t) != 1) continue;
+        if (strstr(line, ",FALL") == NULL) continue;
+        if (r->labels == MAX_LABELS) return false;
+        r->label_us[r->labels++] = t;
+    }
+    rewind(f);
+    return true;
+}
+
+static bool replay_file(const char *path, replay_t *total)
+{
+    static fall_detector_t fd;
+    static replay_t r;
+    char line[256];
+    int64_t prev_us = 0;
+    long lineno = 0;
+    bool ok = true;
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    memset(&r, 0, sizeof(r));
+    r.first_us = -1;
+    if (!load_labels(f, &r)) {
+        fprintf(stderr, "%s: more than %d labels\n", path, MAX_LABELS);
+        fclose(f);
+        return false;
+    }
+    fall_init(&fd, PRESENCE_THRESHOLD_KG, on_alert, &r);
+
+    int64_t t0 = test_now_ns();
+    while (fgets(line, sizeof(line), f)) {
+        long long t;
+        int a[4];
+
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line + 1, ",%lld", &t) != 1 || t < prev_us) {
+            fprintf(stderr, "%s:%ld: bad or out-of-order line\n", path, lineno);
+            ok = false;
+            break;
+        }
+        prev_us = t;
+        if (r.first_us < 0) r.first_us = t;
+        r.last_us = t;
+
+        if (line[0] == 'I' && sscanf(line, "I,%*d,%d,%d,%d", &a[0], &a[1], &a[2]) == 3) {
+            int32_t mg[3] = { a[0], a[1], a[2] };
+            fall_update_imu(&fd, t, mg);
+            r.samples++;
+        } else if (line[0] == 'L' && sscanf(line, "L,%*d,%d,%d,%d,%d", &a[0], &a[1], &a[2], &a[3]) == 4) {
+            int16_t w[4] = { (int16_t)a[0], (int16_t)a[1], (int16_t)a[2], (int16_t)a[3] };
+            fall_update_load(&fd, t, w);
+            r.samples++;
+        } else if (line[0] == 'R') {
+            fall_reset(&fd);
+        } else if (line[0] != 'E') {
+            fprintf(stderr, "%s:%ld: unknown record\n", path, lineno);
+            ok = false;
+            break;
+        }
+    }
+    int64_t host_ns = test_now_ns() - t0;
+    fclose(f);
+
+    double hours = (r.last_us - r.first_us) / 3.6e9;
+    printf("%-20s %7.1f min %8llu smp %3d/%-3d falls %3d fp %3d edge  lat avg %5.1f max %5.1f ms  %5.0f ns/smp\n",
+           strrchr(path, '/') ? strrchr(path, '/') + 1 : path, hours * 60.0,
+           (unsigned long long)r.samples, r.detected, r.labels, r.false_pos, r.edge_exits,
+           r.detected ? r.latency_sum_us / 1e3 / r.detected : 0.0, r.latency_max_us / 1e3,
+           r.samples ? (double)host_ns / r.samples : 0.0);
+
+    for (int i = 0; i < r.labels; i++) {
+        if (!r.matched[i]) fprintf(stderr, "  missed fall at %.3f s\n", r.label_us[i] / 1e6);
+    }
+
+    total->labels += r.labels;
+    total->detected += r.detected;
+    total->false_pos += r.false_pos;
+    total->edge_exits += r.edge_exits;
+    total->latency_sum_us += r.latency_sum_us;
+    if (r.latency_max_us > total->latency_max_us) total->latency_max_us = r.latency_max_us;
+    total->last_us += r.last_us - r.first_us;
+    total->samples += r.samples;
+    return ok;
+}
+
+static int has_suffix(const char *s, const char *suffix)
+{
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static int cmp_str(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool replay_path(const char *path, replay_t *total)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) return replay_file(path, total);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) return false;
+
+    char *names[64];
+    int n = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && n < 64) {
+        if (has_suffix(de->d_name, ".csv")) names[n++] = strdup(de->d_name);
+    }
+    closedir(dir);
+    qsort(names, n, sizeof(names[0]), cmp_str);
+
+    bool ok = n > 0;
+    for (int i = 0; i < n; i++) {
+        char file[1024];
+        snprintf(file, sizeof(file), "%s/%s", path, names[i]);
+        ok &= replay_file(file, total);
+        free(names[i]);
+    }
+    if (n == 0) fprintf(stderr, "%s: no traces\n", path);
+    return ok;
+}
+
+static void count_alert(const fall_alert_t *alert, void *ctx)
+{
+    if (alert->id == FALL_ALERT_FALL) (*(int *)ctx)++;
+}
+
+// RESET_FALL straight after an alert, well inside the window: the impact
+// and load loss that raised it must not raise it again.
+static void check_reset(void)
+{
+    static fall_detector_t fd;
+    static const int16_t full[4] = { 18, 18, 18, 18 };
+    static const int16_t empty[4] = { 0, 0, 0, 0 };
+    static const int32_t still[3] = { 0, 0, 1000 };
+    static const int32_t hit[3] = { 0, 0, 2500 };
+    int falls = 0;
+    int64_t t = 0;
+
+    fall_init(&fd, PRESENCE_THRESHOLD_KG, count_alert, &falls);
+    for (int i = 0; i < 400; i++) fall_update_load(&fd, t += 10000, full);
+    fall_update_imu(&fd, t += 10000, hit);
+    fall_update_load(&fd, t += 10000, empty);
+    CHECK_EQ(falls, 1);
+    CHECK(fall_is_latched(&fd));
+
+    fall_reset(&fd);
+    for (int i = 0; i < 20; i++) {
+        fall_update_imu(&fd, t += 5000, still);
+        fall_update_load(&fd, t += 5000, empty);
+    }
+    CHECK_EQ(falls, 1);
+    CHECK(!fall_is_latched(&fd));
+}
+
+int main(int argc, char **argv)
+{
+    static replay_t total;
+    int traces = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-latency-ms") == 0 && i + 1 < argc) {
+            s_max_latency_us = atoll(argv[++i]) * 1000;
+        } else if (strcmp(argv[i], "--max-fp") == 0 && i + 1 < argc) {
+            s_max_fp = atoi(argv[++i]);
+        } else {
+            CHECK(replay_path(argv[i], &total));
+            traces++;
+        }
+    }
+    if (traces == 0) {
+        fprintf(stderr, "usage: %s [--max-latency-ms N] [--max-fp N] <trace.csv | dir>...\n", argv[0]);
+        return 2;
+    }
+
+    double hours = total.last_us / 3.6e9;
+    printf("total: %d/%d falls detected, %d false positives (%.2f/h over %.2f h), "
+           "latency avg %.1f max %.1f ms\n",
+           total.detected, total.labels, total.false_pos, hours > 0 ? total.false_pos / hours : 0.0, hours,
+           total.detected ? total.latency_sum_us / 1e3 / total.detected : 0.0, total.latency_max_us / 1e3);
+
+    check_reset();
+    CHECK(total.labels > 0);
+    CHECK_EQ(total.detected, total.labels);
+    CHECK(total.latency_max_us <= s_max_latency_us);
+    CHECK(total.false_pos <= s_max_fp);
+
+    return test_exit("fall_replay");
+}
@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+/*
+ * Writes the fall-detection traces replayed by fall_replay: a night of
+ * ordinary sleep, a bed that gets knocked, and two families of falls. The
+ * person is modelled as a total load and a centre of gravity spread over
+ * the four cells; the IMU sees gravity, movement jitter and impacts. Rates
+ * match the firmware: IMU at 100 Hz, load cells at 80 SPS. The generator
+ * is seeded, so the traces are the same on every run.
+ *
+ *   fall_tracegen <dir>
+ *
+ * Trace format, one line per sample, in time order:
+ *   I,t_us,ax_mg,ay_mg,az_mg    IMU sample
+ *   L,t_us,w0,w1,w2,w3          load cells FL, FR, BL, BR
+ *   E,t_us,FALL                 labelled fall, at the impact
+ *   R,t_us                      RESET_FALL after an alert
+ *   # ...                       comment
+ */
+
+#define IMU_PERIOD_US   10000
+#define LC_PERIOD_US    12500
+#define PERSON_KG       72.0
+#define IMPACT_US       40000
+
+typedef struct {
+    FILE *f;
+    uint64_t rng;
+    int64_t t_us;
+    int64_t next_imu_us;
+    int64_t next_lc_us;
+    double total, x, y;
+    double jitter_mg;
+    int64_t spike_us;
+    double spike_mg;
+} gen_t;
+
+static double uniform(gen_t *g)
+{
+    g->rng = g->rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (double)(g->rng >> 11) / (double)(1ULL << 53);
+}
+
+static double range(gen_t *g, double lo, double hi)
+{
+    return lo + (hi - lo) * uniform(g);
+}
+
+static double gauss(gen_t *g, double sd)
+{
+    double u = uniform(g) + 1e-12, v = uniform(g);
+    return sd * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static void emit_imu(gen_t *g, int64_t t)
+{
+    double a[3] = { 0.0, 0.0, 1000.0 };
+
+    for (int i = 0; i < 3; i++) a[i] += gauss(g, 12.0 + g->jitter_mg);
+    if (g->spike_mg > 0 && t >= g->spike_us && t < g->spike_us + IMPACT_US) {
+        // A short triangular pulse, mostly vertical.
+        double k = 1.0 - fabs((double)(t - g->spike_us) * 2.0 / IMPACT_US - 1.0);
+        double extra = (g->spike_mg - 1000.0) * k;
+        a[2] += extra;
+        a[0] += 0.3 * extra;
+    }
+    fprintf(g->f, "I,%lld,%d,%d,%d\n", (long long)t, (int)lround(a[0]), (int)lround(a[1]), (int)lround(a[2]));
+}
+
+static void emit_lc(gen_t *g, int64_t t)
+{
+    static const int sx[4] = { -1, 1, -1, 1 };
+    static const int sy[4] = { 1, 1, -1, -1 };
+    int w[4];
+
+    for (int i = 0; i < 4; i++) {
+        double v = g->total / 4.0 * (1.0 + sx[i] * g->x + sy[i] * g->y);
+        w[i] = (int)lround(v + gauss(g, 0.4));
+    }
+    fprintf(g->f, "L,%lld,%d,%d,%d,%d\n", (long long)t, w[0], w[1], w[2], w[3]);
+}
+
+// Moves the load and CoG linearly to the targets over dur_us, writing the
+// samples that fall in that time.
+static void run(gen_t *g, int64_t dur_us, double total, double x, double y)
+{
+    double t0 = g->total, x0 = g->x, y0 = g->y;
+    int64_t start = g->t_us, end = g->t_us + dur_us;
+
+    while (1) {
+        int64_t t = g->next_imu_us < g->next_lc_us ? g->next_imu_us : g->next_lc_us;
+        if (t >= end) break;
+
+        double k = dur_us > 0 ? (double)(t - start) / dur_us : 1.0;
+        g->total = t0 + (total - t0) * k;
+        g->x = x0 + (x - x0) * k;
+        g->y = y0 + (y - y0) * k;
+
+        if (t == g->next_imu_us) {
+            emit_imu(g, t);
+            g->next_imu_us += IMU_PERIOD_US;
+        } else {
+            emit_lc(g, t);
+            g->next_lc_us += LC_PERIOD_US;
+        }
+    }
+    g->t_us = end;
+    g->total = total;
+    g->x = x;
+    g->y = y;
+}
+
+static void hold(gen_t *g, int64_t dur_us)
+{
+    run(g, dur_us, g->total, g->x, g->y);
+}
+
+static void impact(gen_t *g, double peak_mg, bool label)
+{
+    g->spike_us = g->t_us;
+    g->spike_mg = peak_mg;
+    if (label) fprintf(g->f, "E,%lld,FALL\n", (long long)g->t_us);
+}
+
+static void reset(gen_t *g)
+{
+    fprintf(g->f, "R,%lld\n", (long long)g->t_us);
+}
+
+static bool open_trace(gen_t *g, const char *dir, const char *name, uint64_t seed, const char *what)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/%s.csv", dir, name);
+    memset(g, 0, sizeof(*g));
+    g->f = fopen(path, "w");
+    if (g->f == NULL) {
+        perror(path);
+        return false;
+    }
+    g->rng = seed;
+    g->next_lc_us = IMU_PERIOD_US / 2;
+    fprintf(g->f, "# %s\n", what);
+    return true;
+}
+
+static void get_in(gen_t *g)
+{
+    double side = uniform(g) < 0.5 ? -1.0 : 1.0;
+
+    g->x = 0.8 * side;
+    g->y = 0.0;
+    g->jitter_mg = 60.0;
+    run(g, 2000000, PERSON_KG * 0.6, 0.8 * side, 0.1);
+    impact(g, range(g, 1200.0, 1600.0), false);
+    run(g, 2500000, PERSON_KG, range(g, -0.2, 0.2), range(g, -0.1, 0.1));
+    g->jitter_mg = 0.0;
+}
+
+static void get_out(gen_t *g)
+{
+    double side = uniform(g) < 0.5 ? -1.0 : 1.0;
+
+    g->jitter_mg = 50.0;
+    run(g, 2000000, PERSON_KG, 0.3, 0.4);
+    run(g, 2500000, PERSON_KG, 0.85 * side, 0.1);
+    run(g, 1500000, 0.0, 0.85 * side, 0.1);
+    g->jitter_mg = 0.0;
+    g->x = g->y = 0.0;
+}
+
+static void turn_over(gen_t *g)
+{
+    g->jitter_mg = range(g, 40.0, 120.0);
+    run(g, (int64_t)range(g, 1500000, 3000000), PERSON_KG, range(g, -0.35, 0.35), range(g, -0.2, 0.2));
+    g->jitter_mg = 0.0;
+}
+
+static void quiet_night(const char *dir)
+{
+    gen_t g;
+
+    if (!open_trace(&g, dir, "quiet_night", 1, "getting in, 40 minutes of sleep with turns and sitting up, getting out")) return;
+    hold(&g, 30000000);
+    get_in(&g);
+    for (int64_t slept = 0; slept < 2400000000LL;) {
+        int64_t still = (int64_t)range(&g, 60e6, 240e6);
+        hold(&g, still);
+        slept += still;
+        if (uniform(&g) < 0.15) {
+            g.jitter_mg = 80.0;
+            run(&g, 2000000, PERSON_KG, g.x, 0.45);
+            hold(&g, (int64_t)range(&g, 5e6, 30e6));
+            run(&g, 2000000, PERSON_KG, g.x, 0.0);
+            g.jitter_mg = 0.0;
+        } else {
+            turn_over(&g);
+        }
+    }
+    get_out(&g);
+    hold(&g, 30000000);
+    fclose(g.f);
+}
+
+// Knocks against the frame and things dropped on the mattress: impacts with
+// the load unchanged, occupied and empty.
+static void knocks(const char *dir)
+{
+    gen_t g;
+
+    if (!open_trace(&g, dir, "knocks", 2, "impacts on the bed without a fall")) return;
+    hold(&g, 10000000);
+    for (int i = 0; i < 5; i++) {
+        impact(&g, range(&g, 1900.0, 2600.0), false);
+        hold(&g, (int64_t)range(&g, 5e6, 15e6));
+    }
+    get_in(&g);
+    hold(&g, 20000000);
+    for (int i = 0; i < 20; i++) {
+        impact(&g, range(&g, 1900.0, 3000.0), false);
+        hold(&g, (int64_t)range(&g, 5e6, 20e6));
+        if (i % 5 == 4) turn_over(&g);
+    }
+    get_out(&g);
+    hold(&g, 20000000);
+    fclose(g.f);
+}
+
+// Rolling off: the CoG runs to an edge, the load goes, and the floor impact
+// reaches the frame a moment later.
+static void falls_roll(const char *dir)
+{
+    gen_t g;
+
+    if (!open_trace(&g, dir, "falls_roll", 3, "rolling off an edge, load lost before the impact")) return;
+    hold(&g, 5000000);
+    for (int i = 0; i < 16; i++) {
+        double side = i % 2 ? 1.0 : -1.0;
+        get_in(&g);
+        hold(&g, (int64_t)range(&g, 15e6, 40e6));
+        g.jitter_mg = 150.0;
+        run(&g, (int64_t)range(&g, 600000, 1200000), PERSON_KG, 0.9 * side, range(&g, -0.1, 0.1));
+        run(&g, (int64_t)range(&g, 150000, 300000), range(&g, 0.0, 10.0), 0.9 * side, g.y);
+        hold(&g, (int64_t)range(&g, 150000, 500000));
+        impact(&g, range(&g, 1900.0, 3000.0), true);
+        g.jitter_mg = 0.0;
+        hold(&g, 10000000);
+        run(&g, 500000, 0.0, 0.0, 0.0);
+        reset(&g);
+        hold(&g, 5000000);
+    }
+    fclose(g.f);
+}
+
+// Slumping against the rail: the impact and a partial loss of load arrive
+// together, with the CoG still well inside the edges.
+static void falls_slump(const char *dir)
+{
+    gen_t g;
+
+    if (!open_trace(&g, dir, "falls_slump", 4, "impact with a simultaneous partial loss of load")) return;
+    hold(&g, 5000000);
+    for (int i = 0; i < 16; i++) {
+        get_in(&g);
+        run(&g, 3000000, PERSON_KG, range(&g, -0.4, 0.4), 0.45);
+        hold(&g, (int64_t)range(&g, 10e6, 30e6));
+        impact(&g, range(&g, 2000.0, 2800.0), true);
+        g.jitter_mg = 150.0;
+        run(&g, 100000, PERSON_KG * range(&g, 0.2, 0.4), g.x, g.y);
+        hold(&g, 1000000);
+        run(&g, 1000000, 0.0, g.x, g.y);
+        g.jitter_mg = 0.0;
+        hold(&g, 10000000);
+        reset(&g);
+        g.x = g.y = 0.0;
+        hold(&g, 5000000);
+    }
+    fclose(g.f);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <dir>\n", argv[0]);
+        return 2;
+    }
+    mkdir(argv[1], 0755);
+
+    quiet_night(argv[1]);
+    knocks(argv[1]);
+    falls_roll(argv[1]);
+    falls_slump(argv[1]);
+    return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define NOINIT_ATTR
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef ESP_CPU_H
+#define ESP_CPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// On x86 the time-stamp counter stands in for CCOUNT; elsewhere the counter
+// runs at a nominal 1 GHz off the monotonic clock.
+uint32_t sim_cycle_count(void);
+int esp_cpu_get_core_id(void);
+
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#else
+    return sim_cycle_count();
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef ESP_NETIF_H
+#define ESP_NETIF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED,
+    IP_EVENT_GOT_IP6,
+    IP_EVENT_ETH_GOT_IP,
+    IP_EVENT_ETH_LOST_IP,
+} ip_event_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
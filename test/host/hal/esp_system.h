@@ -0,0 +1,19 @@
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+void esp_restart(void) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
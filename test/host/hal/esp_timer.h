@@ -0,0 +1,46 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+    ESP_TIMER_MAX,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+// Microseconds on the monotonic clock, starting at 1 s so that zero can keep
+// meaning "never" as it does on a freshly booted target.
+int64_t esp_timer_get_time(void);
+
+// Callbacks of every timer run one at a time on a single timer thread, as
+// they do on the esp_timer task.
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
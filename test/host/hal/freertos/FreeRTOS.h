@@ -0,0 +1,66 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "esp_attr.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdFAIL              pdFALSE
+#define pdPASS              pdTRUE
+#define errQUEUE_FULL       0
+#define errQUEUE_EMPTY      0
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+
+#define configTICK_RATE_HZ      100
+#define configMAX_PRIORITIES    25
+#define portNUM_PROCESSORS      2
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+// A critical section is a recursive mutex held with thread cancellation
+// deferred. "Masking interrupts" takes one global lock, which is what code
+// relying on it for atomicity against other contexts needs on the host.
+typedef struct {
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+
+void sim_critical_enter(portMUX_TYPE *mux);
+void sim_critical_exit(portMUX_TYPE *mux);
+UBaseType_t sim_irq_mask(void);
+void sim_irq_unmask(UBaseType_t state);
+
+#define portENTER_CRITICAL(mux)         sim_critical_enter(mux)
+#define portEXIT_CRITICAL(mux)          sim_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux)     sim_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)      sim_critical_exit(mux)
+#define portENTER_CRITICAL_SAFE(mux)    sim_critical_enter(mux)
+#define portEXIT_CRITICAL_SAFE(mux)     sim_critical_exit(mux)
+#define taskENTER_CRITICAL(mux)         sim_critical_enter(mux)
+#define taskEXIT_CRITICAL(mux)          sim_critical_exit(mux)
+#define portSET_INTERRUPT_MASK_FROM_ISR()       sim_irq_mask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(s)    sim_irq_unmask(s)
+#define portYIELD_FROM_ISR(...)         ((void)0)
+#define portYIELD()                     sched_yield()
+#define taskYIELD()                     sched_yield()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef FREERTOS_QUEUE_H
+#define FREERTOS_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSend(queue, item, ticks)  xQueueSendToBack((queue), (item), (ticks))
+
+static inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    BaseType_t ret = xQueueSendToBack(queue, item, 0);
+    if (woken && ret == pdTRUE) *woken = pdTRUE;
+    return ret;
+}
+
+static inline BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken)
+{
+    (void)woken;
+    return xQueueReceive(queue, item, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
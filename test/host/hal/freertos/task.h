@@ -0,0 +1,62 @@
+#ifndef FREERTOS_TASK_H
+#define FREERTOS_TASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sched.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+// Tasks are threads; priorities and core affinity are recorded but the host
+// scheduler decides. The core is what esp_cpu_get_core_id() reports.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id);
+#define xTaskCreate(fn, name, stack, arg, prio, handle) \
+    xTaskCreatePinnedToCore((fn), (name), (stack), (arg), (prio), (handle), tskNO_AFFINITY)
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xPortGetCoreID(void);
+
+BaseType_t xTaskGenericNotify(TaskHandle_t task, uint32_t value, eNotifyAction action, uint32_t *prev);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+#define xTaskNotify(task, value, action)    xTaskGenericNotify((task), (value), (action), NULL)
+#define xTaskNotifyGive(task)               xTaskGenericNotify((task), 0, eIncrement, NULL)
+
+static inline BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                                            BaseType_t *woken)
+{
+    BaseType_t ret = xTaskGenericNotify(task, value, action, NULL);
+    if (woken) *woken = pdTRUE;
+    return ret;
+}
+
+static inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskGenericNotify(task, 0, eIncrement, NULL);
+    if (woken) *woken = pdTRUE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HAL_DEDIC_GPIO_CPU_LL_H
+#define HAL_DEDIC_GPIO_CPU_LL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// The channels of every bundle map straight onto the simulated pins, so a
+// mask write moves all of its SCK lines in one step as the CPU would.
+void dedic_gpio_cpu_ll_write_mask(uint32_t mask, uint32_t value);
+void dedic_gpio_cpu_ll_write_all(uint32_t value);
+uint32_t dedic_gpio_cpu_ll_read_in(void);
+uint32_t dedic_gpio_cpu_ll_read_out(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef SIM_H
+#define SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/*
+ * Control side of the host HAL. Firmware sources only see the ESP-IDF
+ * headers next to this one; tests, the bench and the device models use this
+ * to drive pins, attach SPI devices, inspect the target heap, cut power to
+ * the flash and play the MQTT broker.
+ */
+
+// Target heap: every heap_caps_* allocation plus the RTOS objects the shim
+// creates on the firmware's behalf (task stacks, queues, SPI devices,
+// timers) are charged against a pool the size of the ESP32-S3's free DRAM.
+#define SIM_HEAP_POOL_SIZE  (320 * 1024)
+
+typedef struct {
+    size_t total;
+    size_t in_use;
+    size_t peak;
+    uint32_t allocs;
+    uint32_t frees;
+} sim_heap_stats_t;
+
+void sim_heap_get_stats(sim_heap_stats_t *stats);
+void sim_heap_note(long bytes);
+
+// GPIO: models drive their outputs onto firmware inputs with
+// sim_gpio_drive() and hear the firmware's outputs through a listener.
+// Listeners run on the writing thread, outside the GPIO lock; ISRs run on
+// the driving thread with the interrupt lock held.
+typedef void (*sim_gpio_listener_t)(void *ctx, int pin, int level);
+
+void sim_gpio_listen(int pin, sim_gpio_listener_t cb, void *ctx);
+void sim_gpio_drive(int pin, int level);
+int sim_gpio_get_output(int pin);
+bool sim_gpio_intr_enabled(int pin);
+
+// SPI: a model answers for the device whose CS pin is low when a
+// transaction runs. clock_hz is the rate the transaction was clocked at.
+// As on the target, a DMA buffer whose address or length is not a whole
+// number of words goes through a bounce buffer allocated for the
+// transaction; dma_bounces counts them.
+typedef void (*sim_spi_xfer_t)(void *ctx, const uint8_t *tx, uint8_t *rx, size_t len, int clock_hz);
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t queued;
+    uint64_t bytes;
+    uint32_t devices_added;
+    uint32_t devices_removed;
+    uint32_t no_cs;
+    uint32_t dma_bounces;
+} sim_spi_stats_t;
+
+void sim_spi_attach(int host, int cs_pin, sim_spi_xfer_t xfer, void *ctx);
+void sim_spi_detach(int host, int cs_pin);
+void sim_spi_get_stats(sim_spi_stats_t *stats);
+void sim_spi_reset_stats(void);
+
+// Device clock: periodic callbacks for the models, on a thread of their own
+// so conversions keep coming while esp_timer callbacks run.
+typedef struct esp_timer sim_clock_t;
+typedef void (*sim_clock_cb_t)(void *ctx, int64_t t_us);
+
+sim_clock_t *sim_clock_start(uint64_t period_us, sim_clock_cb_t cb, void *ctx);
+void sim_clock_stop(sim_clock_t *clock);
+
+// Flash: one "spiffs" data partition backed by a file, with NOR semantics
+// (a write can only clear bits) and a programmable power cut.
+typedef struct {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erases;
+    uint64_t bytes_written;
+    uint32_t bit_violations;
+    uint32_t max_sector_erases;
+    bool power_lost;
+} sim_flash_stats_t;
+
+esp_err_t sim_flash_open(const char *path, uint32_t size, bool wipe);
+void sim_flash_close(void);
+// The write that crosses the budget is cut short and every access after it
+// fails until power is restored, like a brown-out mid-program.
+void sim_flash_cut_after(long bytes);
+void sim_flash_power_restore(void);
+void sim_flash_get_stats(sim_flash_stats_t *stats);
+
+// MQTT broker stand-in. The client's events are delivered on a thread of
+// its own, as they are on the esp-mqtt task.
+void sim_broker_reset(void);
+void sim_broker_set_online(bool online);
+void sim_broker_set_session(bool persistent);
+uint32_t sim_broker_count(const char *topic);
+int sim_broker_last(const char *topic, char *buf, size_t len);
+int sim_broker_inject(const char *topic, const char *data, int len, int fragment);
+size_t sim_broker_outbox_bytes(void);
+bool sim_broker_wait_idle(uint32_t timeout_ms);
+
+void sim_sleep_us(uint64_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
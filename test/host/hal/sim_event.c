@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_event.h"
+#include "esp_netif.h"
+
+#define SIM_EVENT_MAX_HANDLERS  16
+
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} handler_entry_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static handler_entry_t s_handlers[SIM_EVENT_MAX_HANDLERS];
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_EVENT_MAX_HANDLERS; i++) {
+        if (s_handlers[i].handler == NULL) {
+            s_handlers[i] = (handler_entry_t){ event_base, event_id, event_handler, event_handler_arg };
+            ret = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id,
+                                       esp_event_handler_t event_handler)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_EVENT_MAX_HANDLERS; i++) {
+        handler_entry_t *h = &s_handlers[i];
+        if (h->handler == event_handler && h->base == event_base && h->id == event_id) h->handler = NULL;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait)
+{
+    (void)event_data_size;
+    (void)ticks_to_wait;
+    handler_entry_t matched[SIM_EVENT_MAX_HANDLERS];
+    int n = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_EVENT_MAX_HANDLERS; i++) {
+        handler_entry_t *h = &s_handlers[i];
+        if (h->handler == NULL) continue;
+        if (h->base != ESP_EVENT_ANY_BASE && h->base != event_base) continue;
+        if (h->id != ESP_EVENT_ANY_ID && h->id != event_id) continue;
+        matched[n++] = *h;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    for (int i = 0; i < n; i++) {
+        matched[i].handler(matched[i].arg, event_base, event_id, (void *)event_data);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "sim.h"
+
+#define SIM_FLASH_SECTOR    4096
+#define SIM_FLASH_MAX_SECTORS 1024
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *s_file = NULL;
+static esp_partition_t s_part = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+    .address = 0x110000,
+    .erase_size = SIM_FLASH_SECTOR,
+    .label = "spiffs",
+};
+static sim_flash_stats_t s_stats;
+static uint32_t s_erase_count[SIM_FLASH_MAX_SECTORS];
+static long s_cut_budget = -1;
+
+esp_err_t sim_flash_open(const char *path, uint32_t size, bool wipe)
+{
+    if (size == 0 || size % SIM_FLASH_SECTOR || size / SIM_FLASH_SECTOR > SIM_FLASH_MAX_SECTORS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    sim_flash_close();
+
+    pthread_mutex_lock(&s_lock);
+    s_file = wipe ? NULL : fopen(path, "r+b");
+    if (s_file == NULL) {
+        s_file = fopen(path, "w+b");
+        if (s_file == NULL) {
+            pthread_mutex_unlock(&s_lock);
+            return ESP_FAIL;
+        }
+        uint8_t blank[SIM_FLASH_SECTOR];
+        memset(blank, 0xFF, sizeof(blank));
+        for (uint32_t off = 0; off < size; off += SIM_FLASH_SECTOR) fwrite(blank, 1, sizeof(blank), s_file);
+        fflush(s_file);
+    }
+    s_part.size = size;
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_erase_count, 0, sizeof(s_erase_count));
+    s_cut_budget = -1;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+void sim_flash_close(void)
+{
+    pthread_mutex_lock(&s_lock);
+    if (s_file) fclose(s_file);
+    s_file = NULL;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_flash_cut_after(long bytes)
+{
+    pthread_mutex_lock(&s_lock);
+    s_cut_budget = bytes;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_flash_power_restore(void)
+{
+    pthread_mutex_lock(&s_lock);
+    s_cut_budget = -1;
+    s_stats.power_lost = false;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_flash_get_stats(sim_flash_stats_t *stats)
+{
+    pthread_mutex_lock(&s_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    const esp_partition_t *found = NULL;
+
+    pthread_mutex_lock(&s_lock);
+    if (s_file && (type == ESP_PARTITION_TYPE_ANY || type == s_part.type)
+        && (subtype == ESP_PARTITION_SUBTYPE_ANY || subtype == s_part.subtype)
+        && (label == NULL || strcmp(label, s_part.label) == 0)) {
+        found = &s_part;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return found;
+}
+
+static bool in_range(const esp_partition_t *p, size_t off, size_t size)
+{
+    return p == &s_part && s_file != NULL && off <= s_part.size && size <= s_part.size - off;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&s_lock);
+    if (!in_range(partition, src_offset, size)) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else if (s_stats.power_lost) {
+        ret = ESP_FAIL;
+    } else {
+        fseek(s_file, (long)src_offset, SEEK_SET);
+        if (fread(dst, 1, size, s_file) != size) ret = ESP_FAIL;
+        s_stats.reads++;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+// Programs size bytes, or as many as the power-cut budget allows; returns
+// how many reached the flash.
+static size_t program(size_t off, const uint8_t *src, size_t size)
+{
+    uint8_t old[256];
+    size_t done = 0;
+
+    if (s_cut_budget >= 0 && (long)size > s_cut_budget) size = (size_t)s_cut_budget;
+
+    while (done < size) {
+        size_t n = size - done < sizeof(old) ? size - done : sizeof(old);
+        fseek(s_file, (long)(off + done), SEEK_SET);
+        if (fread(old, 1, n, s_file) != n) break;
+        for (size_t i = 0; i < n; i++) {
+            uint8_t want = src[done + i];
+            if (want & ~old[i]) s_stats.bit_violations++;
+            old[i] &= want;
+        }
+        fseek(s_file, (long)(off + done), SEEK_SET);
+        fwrite(old, 1, n, s_file);
+        done += n;
+    }
+    fflush(s_file);
+
+    if (s_cut_budget >= 0) s_cut_budget -= (long)done;
+    return done;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&s_lock);
+    if (!in_range(partition, dst_offset, size)) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else if (s_stats.power_lost) {
+        ret = ESP_FAIL;
+    } else {
+        size_t done = program(dst_offset, src, size);
+        s_stats.writes++;
+        s_stats.bytes_written += done;
+        if (done < size) {
+            s_stats.power_lost = true;
+            ret = ESP_FAIL;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&s_lock);
+    if (!in_range(partition, offset, size) || offset % SIM_FLASH_SECTOR || size % SIM_FLASH_SECTOR) {
+        ret = ESP_ERR_INVALID_ARG;
+    } else if (s_stats.power_lost || s_cut_budget == 0) {
+        s_stats.power_lost = true;
+        ret = ESP_FAIL;
+    } else {
+        uint8_t blank[SIM_FLASH_SECTOR];
+        memset(blank, 0xFF, sizeof(blank));
+        fseek(s_file, (long)offset, SEEK_SET);
+        for (size_t off = 0; off < size; off += SIM_FLASH_SECTOR) {
+            fwrite(blank, 1, sizeof(blank), s_file);
+            uint32_t n = ++s_erase_count[(offset + off) / SIM_FLASH_SECTOR];
+            if (n > s_stats.max_sector_erases) s_stats.max_sector_erases = n;
+        }
+        fflush(s_file);
+        s_stats.erases++;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
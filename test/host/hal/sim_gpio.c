@@ -0,0 +1,524 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "driver/gpio.h"
+#include "driver/dedic_gpio.h"
+#include "hal/dedic_gpio_cpu_ll.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "sim.h"
+
+// A level interrupt whose handler never masks it would hang the target;
+// here it gives up after this many back-to-back runs.
+#define SIM_LEVEL_ISR_MAX_RUNS  1000
+
+typedef struct {
+    uint8_t out;
+    uint8_t in;
+    bool driven;
+    gpio_mode_t mode;
+    gpio_int_type_t intr_type;
+    bool intr_en;
+    gpio_isr_t isr;
+    void *isr_arg;
+    sim_gpio_listener_t listener;
+    void *listener_ctx;
+} sim_pin_t;
+
+typedef struct {
+    int pin;
+    int level;
+} pin_change_t;
+
+static pthread_mutex_t s_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static sim_pin_t s_pins[SOC_GPIO_PIN_COUNT];
+static bool s_isr_service = false;
+
+static inline bool valid_pin(int pin)
+{
+    return pin >= 0 && pin < SOC_GPIO_PIN_COUNT;
+}
+
+// Pins nobody drives read back what the pad outputs.
+static inline int level_of(const sim_pin_t *p)
+{
+    return p->driven ? p->in : p->out;
+}
+
+static bool level_fires(const sim_pin_t *p)
+{
+    if (!p->intr_en || p->isr == NULL || !s_isr_service) return false;
+    return (p->intr_type == GPIO_INTR_LOW_LEVEL && level_of(p) == 0)
+        || (p->intr_type == GPIO_INTR_HIGH_LEVEL && level_of(p) == 1);
+}
+
+static bool edge_fires(const sim_pin_t *p, int old_level)
+{
+    int level = level_of(p);
+
+    if (!p->intr_en || p->isr == NULL || !s_isr_service || level == old_level) return false;
+    switch (p->intr_type) {
+        case GPIO_INTR_POSEDGE: return level == 1;
+        case GPIO_INTR_NEGEDGE: return level == 0;
+        case GPIO_INTR_ANYEDGE: return true;
+        default:                return level_fires(p);
+    }
+}
+
+// Handlers run with interrupts masked, which serializes them across every
+// thread that can raise one.
+static void dispatch_isr(int pin, bool edge)
+{
+    UBaseType_t state = sim_irq_mask();
+
+    for (int run = 0; run < SIM_LEVEL_ISR_MAX_RUNS; run++) {
+        pthread_mutex_lock(&s_lock);
+        sim_pin_t *p = &s_pins[pin];
+        bool fire = edge ? (p->intr_en && p->isr != NULL) : level_fires(p);
+        gpio_isr_t isr = p->isr;
+        void *arg = p->isr_arg;
+        pthread_mutex_unlock(&s_lock);
+
+        if (!fire) break;
+        isr(arg);
+        if (edge) break;
+    }
+
+    sim_irq_unmask(state);
+}
+
+static void notify_changes(const pin_change_t *changes, int n)
+{
+    for (int i = 0; i < n; i++) {
+        sim_pin_t *p = &s_pins[changes[i].pin];
+        if (p->listener) p->listener(p->listener_ctx, changes[i].pin, changes[i].level);
+    }
+}
+
+// Applies a new output level to each pin in the masks at once; listeners
+// and interrupts follow after the lock is dropped.
+static void set_outputs(uint64_t mask, uint64_t levels)
+{
+    pin_change_t changes[SOC_GPIO_PIN_COUNT];
+    int fired[SOC_GPIO_PIN_COUNT];
+    int n = 0, nf = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int pin = 0; pin < SOC_GPIO_PIN_COUNT; pin++) {
+        if (!(mask & (1ULL << pin))) continue;
+
+        sim_pin_t *p = &s_pins[pin];
+        int level = (int)((levels >> pin) & 1);
+        if (p->out == level) continue;
+
+        int old = level_of(p);
+        p->out = (uint8_t)level;
+        changes[n].pin = pin;
+        changes[n].level = level;
+        n++;
+        if (edge_fires(p, old)) fired[nf++] = pin;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    notify_changes(changes, n);
+    for (int i = 0; i < nf; i++) dispatch_isr(fired[i], s_pins[fired[i]].intr_type <= GPIO_INTR_ANYEDGE);
+}
+
+void sim_gpio_listen(int pin, sim_gpio_listener_t cb, void *ctx)
+{
+    if (!valid_pin(pin)) return;
+
+    pthread_mutex_lock(&s_lock);
+    s_pins[pin].listener = cb;
+    s_pins[pin].listener_ctx = ctx;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_gpio_drive(int pin, int level)
+{
+    if (!valid_pin(pin)) return;
+
+    pthread_mutex_lock(&s_lock);
+    sim_pin_t *p = &s_pins[pin];
+    int old = level_of(p);
+    p->in = (uint8_t)(level != 0);
+    p->driven = true;
+    bool fire = edge_fires(p, old);
+    bool edge = p->intr_type <= GPIO_INTR_ANYEDGE;
+    pthread_mutex_unlock(&s_lock);
+
+    if (fire) dispatch_isr(pin, edge);
+}
+
+int sim_gpio_get_output(int pin)
+{
+    if (!valid_pin(pin)) return 0;
+
+    pthread_mutex_lock(&s_lock);
+    int level = s_pins[pin].out;
+    pthread_mutex_unlock(&s_lock);
+    return level;
+}
+
+bool sim_gpio_intr_enabled(int pin)
+{
+    if (!valid_pin(pin)) return false;
+
+    pthread_mutex_lock(&s_lock);
+    bool en = s_pins[pin].intr_en;
+    pthread_mutex_unlock(&s_lock);
+    return en;
+}
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    if (cfg == NULL || cfg->pin_bit_mask == 0 || (cfg->pin_bit_mask >> SOC_GPIO_PIN_COUNT)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int pin = 0; pin < SOC_GPIO_PIN_COUNT; pin++) {
+        if (!(cfg->pin_bit_mask & (1ULL << pin))) continue;
+
+        gpio_set_direction(pin, cfg->mode);
+        gpio_set_intr_type(pin, cfg->intr_type);
+        if (cfg->intr_type != GPIO_INTR_DISABLE) {
+            gpio_intr_enable(pin);
+        } else {
+            gpio_intr_disable(pin);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    s_pins[pin].mode = GPIO_MODE_INPUT;
+    s_pins[pin].intr_type = GPIO_INTR_DISABLE;
+    s_pins[pin].intr_en = false;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    s_pins[pin].mode = mode;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    set_outputs(1ULL << pin, level ? 1ULL << pin : 0);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    if (!valid_pin(pin)) return 0;
+
+    pthread_mutex_lock(&s_lock);
+    int level = level_of(&s_pins[pin]);
+    pthread_mutex_unlock(&s_lock);
+    return level;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t intr_type)
+{
+    if (!valid_pin(pin) || intr_type >= GPIO_INTR_MAX) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    s_pins[pin].intr_type = intr_type;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+// Enabling a level interrupt whose level already holds fires it straight
+// away, as the pending status would on the target.
+esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    s_pins[pin].intr_en = true;
+    bool fire = level_fires(&s_pins[pin]);
+    pthread_mutex_unlock(&s_lock);
+
+    if (fire) dispatch_isr(pin, false);
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    s_pins[pin].intr_en = false;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&s_lock);
+    if (s_isr_service) ret = ESP_ERR_INVALID_STATE;
+    s_isr_service = true;
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+void gpio_uninstall_isr_service(void)
+{
+    UBaseType_t state = sim_irq_mask();
+    pthread_mutex_lock(&s_lock);
+    s_isr_service = false;
+    for (int pin = 0; pin < SOC_GPIO_PIN_COUNT; pin++) s_pins[pin].isr = NULL;
+    pthread_mutex_unlock(&s_lock);
+    sim_irq_unmask(state);
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t isr_handler, void *args)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    UBaseType_t state = sim_irq_mask();
+    pthread_mutex_lock(&s_lock);
+    esp_err_t ret = s_isr_service ? ESP_OK : ESP_ERR_INVALID_STATE;
+    if (ret == ESP_OK) {
+        s_pins[pin].isr = isr_handler;
+        s_pins[pin].isr_arg = args;
+    }
+    pthread_mutex_unlock(&s_lock);
+    sim_irq_unmask(state);
+    return ret;
+}
+
+// Taking the interrupt mask first means a handler running on another thread
+// has returned before this does.
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin)
+{
+    if (!valid_pin(pin)) return ESP_ERR_INVALID_ARG;
+
+    UBaseType_t state = sim_irq_mask();
+    pthread_mutex_lock(&s_lock);
+    esp_err_t ret = s_isr_service ? ESP_OK : ESP_ERR_INVALID_STATE;
+    s_pins[pin].isr = NULL;
+    s_pins[pin].isr_arg = NULL;
+    pthread_mutex_unlock(&s_lock);
+    sim_irq_unmask(state);
+    return ret;
+}
+
+static uint32_t read_bank(int first)
+{
+    uint32_t v = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < 32 && first + i < SOC_GPIO_PIN_COUNT; i++) {
+        v |= (uint32_t)level_of(&s_pins[first + i]) << i;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return v;
+}
+
+static uint32_t out_bank(int first)
+{
+    uint32_t v = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < 32 && first + i < SOC_GPIO_PIN_COUNT; i++) {
+        v |= (uint32_t)s_pins[first + i].out << i;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return v;
+}
+
+void sim_reg_write(uint32_t addr, uint32_t value)
+{
+    uint64_t v = value;
+
+    switch (addr) {
+        case GPIO_OUT_REG:       set_outputs(0xFFFFFFFFULL, v); break;
+        case GPIO_OUT_W1TS_REG:  set_outputs(v, v); break;
+        case GPIO_OUT_W1TC_REG:  set_outputs(v, 0); break;
+        case GPIO_OUT1_REG:      set_outputs(0xFFFFFFFFULL << 32, v << 32); break;
+        case GPIO_OUT1_W1TS_REG: set_outputs(v << 32, v << 32); break;
+        case GPIO_OUT1_W1TC_REG: set_outputs(v << 32, 0); break;
+        default: break;
+    }
+}
+
+uint32_t sim_reg_read(uint32_t addr)
+{
+    switch (addr) {
+        case GPIO_IN_REG:   return read_bank(0);
+        case GPIO_IN1_REG:  return read_bank(32);
+        case GPIO_OUT_REG:  return out_bank(0);
+        case GPIO_OUT1_REG: return out_bank(32);
+        default:            return 0;
+    }
+}
+
+struct dedic_gpio_bundle_t {
+    int pins[SOC_DEDIC_GPIO_OUT_CHANNELS_NUM];
+    size_t count;
+    bool out;
+    bool in;
+    uint32_t out_offset;
+    uint32_t in_offset;
+};
+
+static int s_out_chan[SOC_DEDIC_GPIO_OUT_CHANNELS_NUM];
+static int s_in_chan[SOC_DEDIC_GPIO_IN_CHANNELS_NUM];
+static uint32_t s_out_used = 0;
+static uint32_t s_in_used = 0;
+
+static bool claim_channels(uint32_t *used, size_t count, size_t total, uint32_t *offset)
+{
+    uint32_t want = (1UL << count) - 1;
+
+    for (uint32_t off = 0; off + count <= total; off++) {
+        if (!(*used & (want << off))) {
+            *used |= want << off;
+            *offset = off;
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t dedic_gpio_new_bundle(const dedic_gpio_bundle_config_t *config, dedic_gpio_bundle_handle_t *ret_bundle)
+{
+    if (config == NULL || ret_bundle == NULL || config->array_size == 0
+        || config->array_size > SOC_DEDIC_GPIO_OUT_CHANNELS_NUM
+        || (!config->flags.in_en && !config->flags.out_en)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct dedic_gpio_bundle_t *b = calloc(1, sizeof(*b));
+    if (b == NULL) return ESP_ERR_NO_MEM;
+
+    b->count = config->array_size;
+    b->out = config->flags.out_en;
+    b->in = config->flags.in_en;
+    memcpy(b->pins, config->gpio_array, b->count * sizeof(int));
+
+    pthread_mutex_lock(&s_lock);
+    bool ok = true;
+    if (b->out) ok = claim_channels(&s_out_used, b->count, SOC_DEDIC_GPIO_OUT_CHANNELS_NUM, &b->out_offset);
+    if (ok && b->in && !claim_channels(&s_in_used, b->count, SOC_DEDIC_GPIO_IN_CHANNELS_NUM, &b->in_offset)) {
+        if (b->out) s_out_used &= ~(((1UL << b->count) - 1) << b->out_offset);
+        ok = false;
+    }
+    if (ok) {
+        for (size_t i = 0; i < b->count; i++) {
+            if (b->out) s_out_chan[b->out_offset + i] = b->pins[i];
+            if (b->in) s_in_chan[b->in_offset + i] = b->pins[i];
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    if (!ok) {
+        free(b);
+        return ESP_ERR_NOT_FOUND;
+    }
+    *ret_bundle = b;
+    return ESP_OK;
+}
+
+esp_err_t dedic_gpio_del_bundle(dedic_gpio_bundle_handle_t bundle)
+{
+    if (bundle == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    uint32_t m = (1UL << bundle->count) - 1;
+    if (bundle->out) s_out_used &= ~(m << bundle->out_offset);
+    if (bundle->in) s_in_used &= ~(m << bundle->in_offset);
+    pthread_mutex_unlock(&s_lock);
+    free(bundle);
+    return ESP_OK;
+}
+
+esp_err_t dedic_gpio_get_out_mask(dedic_gpio_bundle_handle_t bundle, uint32_t *mask)
+{
+    if (bundle == NULL || mask == NULL || !bundle->out) return ESP_ERR_INVALID_ARG;
+    *mask = ((1UL << bundle->count) - 1) << bundle->out_offset;
+    return ESP_OK;
+}
+
+esp_err_t dedic_gpio_get_in_mask(dedic_gpio_bundle_handle_t bundle, uint32_t *mask)
+{
+    if (bundle == NULL || mask == NULL || !bundle->in) return ESP_ERR_INVALID_ARG;
+    *mask = ((1UL << bundle->count) - 1) << bundle->in_offset;
+    return ESP_OK;
+}
+
+esp_err_t dedic_gpio_get_out_offset(dedic_gpio_bundle_handle_t bundle, uint32_t *offset)
+{
+    if (bundle == NULL || offset == NULL || !bundle->out) return ESP_ERR_INVALID_ARG;
+    *offset = bundle->out_offset;
+    return ESP_OK;
+}
+
+esp_err_t dedic_gpio_get_in_offset(dedic_gpio_bundle_handle_t bundle, uint32_t *offset)
+{
+    if (bundle == NULL || offset == NULL || !bundle->in) return ESP_ERR_INVALID_ARG;
+    *offset = bundle->in_offset;
+    return ESP_OK;
+}
+
+void dedic_gpio_cpu_ll_write_mask(uint32_t mask, uint32_t value)
+{
+    uint64_t pins = 0, levels = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int ch = 0; ch < SOC_DEDIC_GPIO_OUT_CHANNELS_NUM; ch++) {
+        if (!(mask & (1UL << ch)) || !(s_out_used & (1UL << ch))) continue;
+        pins |= 1ULL << s_out_chan[ch];
+        if (value & (1UL << ch)) levels |= 1ULL << s_out_chan[ch];
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    set_outputs(pins, levels);
+}
+
+void dedic_gpio_cpu_ll_write_all(uint32_t value)
+{
+    dedic_gpio_cpu_ll_write_mask((1UL << SOC_DEDIC_GPIO_OUT_CHANNELS_NUM) - 1, value);
+}
+
+uint32_t dedic_gpio_cpu_ll_read_in(void)
+{
+    uint32_t v = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int ch = 0; ch < SOC_DEDIC_GPIO_IN_CHANNELS_NUM; ch++) {
+        if (s_in_used & (1UL << ch)) v |= (uint32_t)level_of(&s_pins[s_in_chan[ch]]) << ch;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return v;
+}
+
+uint32_t dedic_gpio_cpu_ll_read_out(void)
+{
+    uint32_t v = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int ch = 0; ch < SOC_DEDIC_GPIO_OUT_CHANNELS_NUM; ch++) {
+        if (s_out_used & (1UL << ch)) v |= (uint32_t)s_pins[s_out_chan[ch]].out << ch;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return v;
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "sim.h"
+
+#define HDR_SIZE    16
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_heap_stats_t s_stats = { .total = SIM_HEAP_POOL_SIZE };
+
+static bool charge(size_t size)
+{
+    bool ok;
+
+    pthread_mutex_lock(&s_lock);
+    ok = s_stats.in_use + size <= s_stats.total;
+    if (ok) {
+        s_stats.in_use += size;
+        s_stats.allocs++;
+        if (s_stats.in_use > s_stats.peak) s_stats.peak = s_stats.in_use;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ok;
+}
+
+static void refund(size_t size)
+{
+    pthread_mutex_lock(&s_lock);
+    s_stats.in_use -= size;
+    s_stats.frees++;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_heap_note(long bytes)
+{
+    if (bytes >= 0) {
+        charge((size_t)bytes);
+    } else {
+        refund((size_t)-bytes);
+    }
+}
+
+void sim_heap_get_stats(sim_heap_stats_t *stats)
+{
+    pthread_mutex_lock(&s_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
+
+// Blocks carry their size and the offset back to the host allocation just
+// ahead of the payload, so any alignment can be freed the same way.
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+    (void)caps;
+    if (alignment < sizeof(void *)) alignment = sizeof(void *);
+    if (alignment & (alignment - 1)) return NULL;
+    if (!charge(size)) return NULL;
+
+    uint8_t *raw = malloc(size + alignment + HDR_SIZE);
+    if (raw == NULL) {
+        refund(size);
+        return NULL;
+    }
+
+    uintptr_t p = ((uintptr_t)raw + HDR_SIZE + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    size_t *hdr = (size_t *)(p - HDR_SIZE);
+    hdr[0] = size;
+    hdr[1] = p - (uintptr_t)raw;
+    return (void *)p;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    return heap_caps_aligned_alloc(4, size, caps);
+}
+
+void *heap_caps_aligned_calloc(size_t alignment, size_t n, size_t size, uint32_t caps)
+{
+    if (size != 0 && n > SIZE_MAX / size) return NULL;
+
+    void *p = heap_caps_aligned_alloc(alignment, n * size, caps);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return heap_caps_aligned_calloc(4, n, size, caps);
+}
+
+void heap_caps_free(void *ptr)
+{
+    if (ptr == NULL) return;
+
+    size_t *hdr = (size_t *)((uintptr_t)ptr - HDR_SIZE);
+    refund(hdr[0]);
+    free((uint8_t *)ptr - hdr[1]);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    sim_heap_stats_t st;
+    sim_heap_get_stats(&st);
+    return st.total - st.in_use;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    (void)caps;
+    sim_heap_stats_t st;
+    sim_heap_get_stats(&st);
+    return st.total - st.peak;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+}
@@ -0,0 +1,86 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+static esp_log_level_t s_level;
+static pthread_once_t s_level_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void init_level(void)
+{
+    const char *env = getenv("SIM_LOG");
+
+    s_level = ESP_LOG_WARN;
+    if (env == NULL) return;
+    switch (env[0]) {
+        case 'n': s_level = ESP_LOG_NONE; break;
+        case 'e': s_level = ESP_LOG_ERROR; break;
+        case 'w': s_level = ESP_LOG_WARN; break;
+        case 'i': s_level = ESP_LOG_INFO; break;
+        case 'd': s_level = ESP_LOG_DEBUG; break;
+        case 'v': s_level = ESP_LOG_VERBOSE; break;
+        default: break;
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    pthread_once(&s_level_once, init_level);
+    s_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    va_list ap;
+
+    pthread_once(&s_level_once, init_level);
+    if (level > s_level) return;
+
+    pthread_mutex_lock(&s_lock);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&s_lock);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:                    return "ESP_OK";
+        case ESP_FAIL:                  return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NOT_FINISHED:      return "ESP_ERR_NOT_FINISHED";
+        default:                        return "UNKNOWN ERROR";
+    }
+}
+
+void sim_error_check_failed(esp_err_t rc, const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, expr);
+    abort();
+}
+
+void esp_restart(void)
+{
+    fprintf(stderr, "esp_restart() called\n");
+    exit(3);
+}
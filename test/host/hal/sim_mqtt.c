@@ -0,0 +1,547 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "mqtt_client.h"
+#include "sim.h"
+
+#define SIM_MQTT_CLIENT_BYTES   6144
+#define SIM_MQTT_MAX_TOPICS     32
+#define SIM_MQTT_MAX_SUBS       8
+
+// The firmware links the broker's CA in as a binary blob.
+__asm__(".section .rodata\n"
+        ".global _binary_root_ca_pem_start\n"
+        ".global _binary_root_ca_pem_end\n"
+        "_binary_root_ca_pem_start:\n"
+        ".ascii \"-----BEGIN CERTIFICATE-----\\nsim\\n-----END CERTIFICATE-----\\n\"\n"
+        ".byte 0\n"
+        "_binary_root_ca_pem_end:\n"
+        ".previous\n");
+
+typedef struct msg {
+    struct msg *next;
+    esp_mqtt_event_id_t event_id;
+    int msg_id;
+    int qos;
+    int session_present;
+    char *topic;
+    char *data;
+    int len;
+    int offset;
+    int total;
+    bool deliver;
+} msg_t;
+
+typedef struct {
+    char *topic;
+    uint32_t count;
+    char *last;
+    int last_len;
+} topic_log_t;
+
+struct esp_mqtt_client {
+    esp_mqtt_client_config_t cfg;
+    esp_event_handler_t handler;
+    void *handler_arg;
+    bool started;
+    bool connected;
+    int next_msg_id;
+    msg_t *outbox;
+    msg_t **outbox_tail;
+    size_t outbox_bytes;
+};
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+static struct esp_mqtt_client *s_client = NULL;
+
+static msg_t *s_events = NULL;
+static msg_t **s_events_tail = &s_events;
+static bool s_dispatching = false;
+
+static bool s_online = true;
+static bool s_persistent = true;
+static bool s_has_session = false;
+static char *s_subs[SIM_MQTT_MAX_SUBS];
+static topic_log_t s_log[SIM_MQTT_MAX_TOPICS];
+static esp_mqtt_error_codes_t s_error = { .error_type = MQTT_ERROR_TYPE_TCP_TRANSPORT };
+
+static char *dup_bytes(const char *src, int len)
+{
+    char *p = malloc((size_t)len + 1);
+    if (len) memcpy(p, src, (size_t)len);
+    p[len] = '\0';
+    return p;
+}
+
+static void free_msg(msg_t *m)
+{
+    free(m->topic);
+    free(m->data);
+    free(m);
+}
+
+static msg_t *new_msg(esp_mqtt_event_id_t id)
+{
+    msg_t *m = calloc(1, sizeof(*m));
+    m->event_id = id;
+    return m;
+}
+
+static void post(msg_t *m)
+{
+    *s_events_tail = m;
+    s_events_tail = &m->next;
+    pthread_cond_broadcast(&s_cond);
+}
+
+static void log_publish(const char *topic, const char *data, int len)
+{
+    for (int i = 0; i < SIM_MQTT_MAX_TOPICS; i++) {
+        topic_log_t *t = &s_log[i];
+        if (t->topic == NULL) t->topic = dup_bytes(topic, (int)strlen(topic));
+        if (strcmp(t->topic, topic) != 0) continue;
+
+        t->count++;
+        free(t->last);
+        t->last = dup_bytes(data, len);
+        t->last_len = len;
+        return;
+    }
+}
+
+// Messages reach the broker from the client's task, as they would after the
+// socket write; QoS 1 and 2 are acknowledged right after.
+static void *event_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&s_lock);
+    while (1) {
+        while (s_events == NULL) pthread_cond_wait(&s_cond, &s_lock);
+
+        msg_t *m = s_events;
+        s_events = m->next;
+        if (s_events == NULL) s_events_tail = &s_events;
+
+        struct esp_mqtt_client *client = s_client;
+        if (m->deliver) {
+            if (client && client->connected && s_online) {
+                log_publish(m->topic, m->data, m->len);
+                if (m->qos > 0) {
+                    msg_t *ack = new_msg(MQTT_EVENT_PUBLISHED);
+                    ack->msg_id = m->msg_id;
+                    post(ack);
+                }
+            }
+            free_msg(m);
+            continue;
+        }
+
+        s_dispatching = true;
+        pthread_mutex_unlock(&s_lock);
+
+        if (client && client->handler) {
+            esp_mqtt_event_t ev = {
+                .event_id = m->event_id,
+                .client = client,
+                .data = m->data,
+                .data_len = m->len,
+                .total_data_len = m->total,
+                .current_data_offset = m->offset,
+                .topic = m->topic,
+                .topic_len = m->topic ? (int)strlen(m->topic) : 0,
+                .msg_id = m->msg_id,
+                .session_present = m->session_present,
+                .error_handle = &s_error,
+                .qos = m->qos,
+            };
+            client->handler(client->handler_arg, "MQTT_EVENTS", m->event_id, &ev);
+        }
+        free_msg(m);
+
+        pthread_mutex_lock(&s_lock);
+        s_dispatching = false;
+        pthread_cond_broadcast(&s_cond);
+    }
+    return NULL;
+}
+
+static void start_event_thread(void)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, event_main, NULL);
+    pthread_detach(thread);
+}
+
+static void queue_delivery(const char *topic, const char *data, int len, int qos, int msg_id)
+{
+    msg_t *m = new_msg(MQTT_EVENT_ANY);
+    m->deliver = true;
+    m->topic = dup_bytes(topic, (int)strlen(topic));
+    m->data = dup_bytes(data, len);
+    m->len = len;
+    m->qos = qos;
+    m->msg_id = msg_id;
+    post(m);
+}
+
+static void try_connect(struct esp_mqtt_client *c)
+{
+    if (!c->started || c->connected) return;
+
+    if (!s_online) {
+        post(new_msg(MQTT_EVENT_ERROR));
+        post(new_msg(MQTT_EVENT_DISCONNECTED));
+        return;
+    }
+
+    msg_t *m = new_msg(MQTT_EVENT_CONNECTED);
+    m->session_present = s_persistent && s_has_session && c->cfg.session.disable_clean_session;
+    if (!m->session_present) {
+        for (int i = 0; i < SIM_MQTT_MAX_SUBS; i++) {
+            free(s_subs[i]);
+            s_subs[i] = NULL;
+        }
+    }
+    s_has_session = true;
+    c->connected = true;
+    post(m);
+
+    while (c->outbox) {
+        msg_t *o = c->outbox;
+        c->outbox = o->next;
+        queue_delivery(o->topic, o->data, o->len, o->qos, o->msg_id);
+        free_msg(o);
+    }
+    c->outbox_tail = &c->outbox;
+    c->outbox_bytes = 0;
+}
+
+static void drop_connection(struct esp_mqtt_client *c)
+{
+    if (!c->connected) return;
+    c->connected = false;
+    post(new_msg(MQTT_EVENT_DISCONNECTED));
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    pthread_once(&s_once, start_event_thread);
+
+    struct esp_mqtt_client *c = calloc(1, sizeof(*c));
+    if (c == NULL) return NULL;
+
+    c->cfg = *config;
+    c->outbox_tail = &c->outbox;
+    c->next_msg_id = 1;
+    sim_heap_note(SIM_MQTT_CLIENT_BYTES);
+
+    pthread_mutex_lock(&s_lock);
+    s_client = c;
+    pthread_mutex_unlock(&s_lock);
+    return c;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    (void)event;
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    client->handler = event_handler;
+    client->handler_arg = event_handler_arg;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    esp_err_t ret = client->started ? ESP_FAIL : ESP_OK;
+    client->started = true;
+    if (ret == ESP_OK) try_connect(client);
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    try_connect(client);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    drop_connection(client);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    client->started = false;
+    client->connected = false;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_lock);
+    while (s_events || s_dispatching) pthread_cond_wait(&s_cond, &s_lock);
+    if (s_client == client) s_client = NULL;
+    while (client->outbox) {
+        msg_t *o = client->outbox;
+        client->outbox = o->next;
+        free_msg(o);
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    sim_heap_note(-SIM_MQTT_CLIENT_BYTES);
+    free(client);
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    if (client == NULL) return -1;
+
+    pthread_mutex_lock(&s_lock);
+    int id = -1;
+    if (client->connected) {
+        for (int i = 0; i < SIM_MQTT_MAX_SUBS; i++) {
+            if (s_subs[i] == NULL || strcmp(s_subs[i], topic) == 0) {
+                if (s_subs[i] == NULL) s_subs[i] = dup_bytes(topic, (int)strlen(topic));
+                id = client->next_msg_id++;
+                msg_t *m = new_msg(MQTT_EVENT_SUBSCRIBED);
+                m->msg_id = id;
+                m->qos = qos;
+                post(m);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return id;
+}
+
+int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char *topic)
+{
+    if (client == NULL) return -1;
+
+    pthread_mutex_lock(&s_lock);
+    int id = -1;
+    if (client->connected) {
+        for (int i = 0; i < SIM_MQTT_MAX_SUBS; i++) {
+            if (s_subs[i] && strcmp(s_subs[i], topic) == 0) {
+                free(s_subs[i]);
+                s_subs[i] = NULL;
+            }
+        }
+        id = client->next_msg_id++;
+        msg_t *m = new_msg(MQTT_EVENT_UNSUBSCRIBED);
+        m->msg_id = id;
+        post(m);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return id;
+}
+
+// Offline, QoS 1/2 messages and stored QoS 0 ones wait in the outbox, up to
+// outbox.limit bytes, and go out on the next connect.
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain, bool store)
+{
+    (void)retain;
+    if (client == NULL || topic == NULL) return -1;
+    if (len <= 0) len = data ? (int)strlen(data) : 0;
+
+    pthread_mutex_lock(&s_lock);
+    int id = qos > 0 ? client->next_msg_id++ : 0;
+
+    if (client->connected) {
+        if (qos > 0 || store) queue_delivery(topic, data, len, qos, id);
+    } else if (qos > 0 || store) {
+        if (client->cfg.outbox.limit && client->outbox_bytes + (size_t)len > client->cfg.outbox.limit) {
+            id = -2;
+        } else {
+            msg_t *m = new_msg(MQTT_EVENT_ANY);
+            m->topic = dup_bytes(topic, (int)strlen(topic));
+            m->data = dup_bytes(data, len);
+            m->len = len;
+            m->qos = qos;
+            m->msg_id = id;
+            *client->outbox_tail = m;
+            client->outbox_tail = &m->next;
+            client->outbox_bytes += (size_t)len;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return id;
+}
+
+// Sends right away when connected; QoS 0 is dropped otherwise.
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain)
+{
+    if (client == NULL || topic == NULL) return -1;
+    if (qos == 0 && !client->connected) return -1;
+    return esp_mqtt_client_enqueue(client, topic, data, len, qos, retain, true);
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) return 0;
+
+    pthread_mutex_lock(&s_lock);
+    int n = (int)client->outbox_bytes;
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+void sim_broker_reset(void)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_MQTT_MAX_TOPICS; i++) {
+        free(s_log[i].topic);
+        free(s_log[i].last);
+        memset(&s_log[i], 0, sizeof(s_log[i]));
+    }
+    s_online = true;
+    s_persistent = true;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_broker_set_online(bool online)
+{
+    pthread_mutex_lock(&s_lock);
+    s_online = online;
+    if (s_client) {
+        if (!online) {
+            drop_connection(s_client);
+        } else if (!s_client->cfg.network.disable_auto_reconnect) {
+            try_connect(s_client);
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_broker_set_session(bool persistent)
+{
+    pthread_mutex_lock(&s_lock);
+    s_persistent = persistent;
+    if (!persistent) s_has_session = false;
+    pthread_mutex_unlock(&s_lock);
+}
+
+uint32_t sim_broker_count(const char *topic)
+{
+    uint32_t n = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_MQTT_MAX_TOPICS; i++) {
+        if (s_log[i].topic && strcmp(s_log[i].topic, topic) == 0) n = s_log[i].count;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+int sim_broker_last(const char *topic, char *buf, size_t len)
+{
+    int n = -1;
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_MQTT_MAX_TOPICS; i++) {
+        topic_log_t *t = &s_log[i];
+        if (t->topic == NULL || strcmp(t->topic, topic) != 0 || t->last == NULL) continue;
+
+        n = t->last_len;
+        if (len) {
+            size_t copy = (size_t)n < len - 1 ? (size_t)n : len - 1;
+            memcpy(buf, t->last, copy);
+            buf[copy] = '\0';
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+// Publishes to a topic the client subscribed to, split into DATA events of
+// at most fragment bytes as the client does with messages over its buffer.
+int sim_broker_inject(const char *topic, const char *data, int len, int fragment)
+{
+    int events = -1;
+
+    if (len <= 0) len = (int)strlen(data);
+    if (fragment <= 0) fragment = len;
+
+    pthread_mutex_lock(&s_lock);
+    bool subscribed = false;
+    for (int i = 0; i < SIM_MQTT_MAX_SUBS; i++) {
+        if (s_subs[i] && strcmp(s_subs[i], topic) == 0) subscribed = true;
+    }
+    if (s_client && s_client->connected && subscribed) {
+        events = 0;
+        for (int off = 0; off < len || (len == 0 && events == 0); off += fragment) {
+            int n = len - off < fragment ? len - off : fragment;
+            msg_t *m = new_msg(MQTT_EVENT_DATA);
+            if (off == 0) m->topic = dup_bytes(topic, (int)strlen(topic));
+            m->data = dup_bytes(data + off, n);
+            m->len = n;
+            m->offset = off;
+            m->total = len;
+            m->qos = 1;
+            post(m);
+            events++;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return events;
+}
+
+size_t sim_broker_outbox_bytes(void)
+{
+    pthread_mutex_lock(&s_lock);
+    size_t n = s_client ? s_client->outbox_bytes : 0;
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
+
+bool sim_broker_wait_idle(uint32_t timeout_ms)
+{
+    struct timespec ts;
+    bool idle;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    while ((s_events || s_dispatching) && pthread_cond_timedwait(&s_cond, &s_lock, &ts) == 0) {
+    }
+    idle = !s_events && !s_dispatching;
+    pthread_mutex_unlock(&s_lock);
+    return idle;
+}
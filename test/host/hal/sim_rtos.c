@@ -0,0 +1,443 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+// What a task or queue costs on the target besides its stack or storage.
+#define SIM_TCB_BYTES       344
+#define SIM_QUEUE_BYTES     80
+
+struct sim_task {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t value;
+    bool pending;
+    bool foreign;
+    int core;
+    uint32_t stack;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+};
+
+struct sim_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *buf;
+    UBaseType_t item_size;
+    UBaseType_t length;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static __thread struct sim_task *tls_task = NULL;
+static __thread int tls_crit_depth = 0;
+static __thread int tls_crit_cancel = PTHREAD_CANCEL_ENABLE;
+
+static void init_cond(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void deadline_after(TickType_t ticks, struct timespec *ts)
+{
+    uint64_t ns = (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ);
+
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ns += (uint64_t)ts->tv_nsec;
+    ts->tv_sec += (time_t)(ns / 1000000000ULL);
+    ts->tv_nsec = (long)(ns % 1000000000ULL);
+}
+
+static void unlock_cleanup(void *lock)
+{
+    pthread_mutex_unlock(lock);
+}
+
+// Waits on cond until pred holds or the ticks run out. Returns false on
+// timeout. The mutex is held on entry and exit, and released if the thread
+// is deleted while waiting.
+static bool wait_for(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks,
+                     bool (*pred)(void *), void *ctx)
+{
+    struct timespec ts;
+    volatile bool ok = true;
+
+    if (ticks != portMAX_DELAY) deadline_after(ticks, &ts);
+
+    pthread_cleanup_push(unlock_cleanup, lock);
+    while (!pred(ctx)) {
+        if (ticks == 0) {
+            ok = false;
+            break;
+        }
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(cond, lock);
+        } else if (pthread_cond_timedwait(cond, lock, &ts) == ETIMEDOUT) {
+            ok = pred(ctx);
+            break;
+        }
+    }
+    pthread_cleanup_pop(0);
+    return ok;
+}
+
+void sim_critical_enter(portMUX_TYPE *mux)
+{
+    if (tls_crit_depth++ == 0) pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &tls_crit_cancel);
+    pthread_mutex_lock(&mux->mutex);
+}
+
+void sim_critical_exit(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&mux->mutex);
+    if (--tls_crit_depth == 0) pthread_setcancelstate(tls_crit_cancel, NULL);
+}
+
+static portMUX_TYPE s_irq_mux = { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP };
+
+UBaseType_t sim_irq_mask(void)
+{
+    sim_critical_enter(&s_irq_mux);
+    return 0;
+}
+
+void sim_irq_unmask(UBaseType_t state)
+{
+    (void)state;
+    sim_critical_exit(&s_irq_mux);
+}
+
+static struct sim_task *task_alloc(const char *name, uint32_t stack, int core, bool foreign)
+{
+    struct sim_task *t = calloc(1, sizeof(*t));
+    if (t == NULL) return NULL;
+
+    pthread_mutex_init(&t->lock, NULL);
+    init_cond(&t->cond);
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->stack = stack;
+    t->core = core;
+    t->foreign = foreign;
+    return t;
+}
+
+static struct sim_task *current_task(void)
+{
+    if (tls_task == NULL) {
+        // Threads the shim did not start (main, timer services, models)
+        // get a handle on first use so they can be notified too.
+        tls_task = task_alloc("host", 0, 0, true);
+        tls_task->thread = pthread_self();
+    }
+    return tls_task;
+}
+
+static void *task_entry(void *arg)
+{
+    struct sim_task *t = arg;
+
+    tls_task = t;
+    t->fn(t->arg);
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id)
+{
+    (void)priority;
+    struct sim_task *t = task_alloc(name, stack_depth,
+                                    (core_id >= 0 && core_id < portNUM_PROCESSORS) ? core_id : 0, false);
+    if (t == NULL) return pdFAIL;
+
+    t->fn = fn;
+    t->arg = arg;
+    if (created_task) *created_task = t;
+    sim_heap_note((long)stack_depth + SIM_TCB_BYTES);
+
+    if (pthread_create(&t->thread, NULL, task_entry, t) != 0) {
+        sim_heap_note(-((long)stack_depth + SIM_TCB_BYTES));
+        if (created_task) *created_task = NULL;
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+// Task structs are never freed: handles of deleted tasks stay safe to
+// compare, as firmware sometimes does.
+void vTaskDelete(TaskHandle_t task)
+{
+    struct sim_task *self = current_task();
+
+    if (task == NULL) task = self;
+    if (task->foreign) return;
+
+    sim_heap_note(-((long)task->stack + SIM_TCB_BYTES));
+    if (task == self) {
+        pthread_detach(pthread_self());
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    sim_sleep_us((uint64_t)ticks * (1000000 / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task();
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    if (task == NULL) task = current_task();
+    return task->name;
+}
+
+// Host threads have no watermark to read back; report the configured stack.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    if (task == NULL) task = current_task();
+    return task->stack;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return tls_task ? tls_task->core : 0;
+}
+
+int esp_cpu_get_core_id(void)
+{
+    return tls_task ? tls_task->core : 0;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t task, uint32_t value, eNotifyAction action, uint32_t *prev)
+{
+    BaseType_t ret = pdPASS;
+
+    pthread_mutex_lock(&task->lock);
+    if (prev) *prev = task->value;
+    switch (action) {
+        case eSetBits:
+            task->value |= value;
+            break;
+        case eIncrement:
+            task->value++;
+            break;
+        case eSetValueWithOverwrite:
+            task->value = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (task->pending) ret = pdFAIL;
+            else task->value = value;
+            break;
+        case eNoAction:
+            break;
+    }
+    if (ret == pdPASS) {
+        task->pending = true;
+        pthread_cond_broadcast(&task->cond);
+    }
+    pthread_mutex_unlock(&task->lock);
+    return ret;
+}
+
+static bool has_count(void *ctx)
+{
+    return ((struct sim_task *)ctx)->value != 0;
+}
+
+static bool has_pending(void *ctx)
+{
+    return ((struct sim_task *)ctx)->pending;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct sim_task *t = current_task();
+    uint32_t value;
+
+    pthread_mutex_lock(&t->lock);
+    wait_for(&t->cond, &t->lock, ticks, has_count, t);
+    value = t->value;
+    if (value != 0) {
+        t->value = clear_on_exit ? 0 : value - 1;
+    }
+    t->pending = false;
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct sim_task *t = current_task();
+    BaseType_t ret;
+
+    pthread_mutex_lock(&t->lock);
+    if (!t->pending) t->value &= ~clear_on_entry;
+    ret = wait_for(&t->cond, &t->lock, ticks, has_pending, t) ? pdTRUE : pdFALSE;
+    if (value) *value = t->value;
+    if (ret == pdTRUE) {
+        t->value &= ~clear_on_exit;
+        t->pending = false;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return ret;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct sim_queue *q = calloc(1, sizeof(*q));
+    if (q == NULL) return NULL;
+
+    q->buf = calloc(length, item_size);
+    if (q->buf == NULL) {
+        free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    init_cond(&q->not_empty);
+    init_cond(&q->not_full);
+    q->length = length;
+    q->item_size = item_size;
+    sim_heap_note((long)length * item_size + SIM_QUEUE_BYTES);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (q == NULL) return;
+    sim_heap_note(-((long)q->length * q->item_size + SIM_QUEUE_BYTES));
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->buf);
+    free(q);
+}
+
+static bool has_space(void *ctx)
+{
+    struct sim_queue *q = ctx;
+    return q->count < q->length;
+}
+
+static bool has_item(void *ctx)
+{
+    return ((struct sim_queue *)ctx)->count > 0;
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+    pthread_mutex_lock(&q->lock);
+    if (!wait_for(&q->not_full, &q->lock, ticks, has_space, q)) {
+        pthread_mutex_unlock(&q->lock);
+        return errQUEUE_FULL;
+    }
+
+    UBaseType_t slot;
+    if (front) {
+        q->head = (q->head + q->length - 1) % q->length;
+        slot = q->head;
+    } else {
+        slot = (q->head + q->count) % q->length;
+    }
+    memcpy(q->buf + (size_t)slot * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_send(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_send(q, item, ticks, true);
+}
+
+static BaseType_t queue_take(QueueHandle_t q, void *item, TickType_t ticks, bool remove)
+{
+    pthread_mutex_lock(&q->lock);
+    if (!wait_for(&q->not_empty, &q->lock, ticks, has_item, q)) {
+        pthread_mutex_unlock(&q->lock);
+        return errQUEUE_EMPTY;
+    }
+
+    memcpy(item, q->buf + (size_t)q->head * q->item_size, q->item_size);
+    if (remove) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return queue_take(q, item, ticks, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return queue_take(q, item, ticks, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head = 0;
+    q->count = 0;
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->length - q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
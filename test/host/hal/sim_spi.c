@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "soc/soc_caps.h"
+#include "sim.h"
+
+#define SIM_SPI_MAX_MODELS      8
+#define SIM_SPI_MAX_QUEUE       8
+#define SIM_SPI_DEVICE_BYTES    200
+#define SIM_SPI_DMA_ALIGN       4
+// CS setup/hold and the driver's own overhead around each transaction.
+#define SIM_SPI_SETUP_NS        1500
+#define SIM_SPI_SPIN_NS         50000
+
+struct spi_device_t {
+    spi_host_device_t host;
+    spi_device_interface_config_t cfg;
+    spi_transaction_t *queue[SIM_SPI_MAX_QUEUE];
+    int64_t done_ns[SIM_SPI_MAX_QUEUE];
+    int head;
+    int count;
+};
+
+typedef struct {
+    pthread_mutex_t lock;
+    bool initialized;
+    int64_t free_ns;
+    uint8_t scratch[4096];
+} sim_bus_t;
+
+typedef struct {
+    int host;
+    int cs_pin;
+    sim_spi_xfer_t xfer;
+    void *ctx;
+} sim_model_t;
+
+static sim_bus_t s_bus[SPI_HOST_MAX] = {
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_model_t s_models[SIM_SPI_MAX_MODELS];
+// The GPIO matrix routes a hardware CS pin to one device: the last one
+// added with it.
+static struct spi_device_t *s_cs_owner[SOC_GPIO_PIN_COUNT];
+static sim_spi_stats_t s_stats;
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void wait_until(int64_t t_ns)
+{
+    int64_t left = t_ns - mono_ns();
+
+    if (left > SIM_SPI_SPIN_NS) sim_sleep_us((uint64_t)(left - SIM_SPI_SPIN_NS) / 1000);
+    while (mono_ns() < t_ns) {
+    }
+}
+
+void sim_spi_attach(int host, int cs_pin, sim_spi_xfer_t xfer, void *ctx)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_SPI_MAX_MODELS; i++) {
+        if (s_models[i].xfer == NULL || (s_models[i].host == host && s_models[i].cs_pin == cs_pin)) {
+            s_models[i] = (sim_model_t){ host, cs_pin, xfer, ctx };
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_spi_detach(int host, int cs_pin)
+{
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_SPI_MAX_MODELS; i++) {
+        if (s_models[i].host == host && s_models[i].cs_pin == cs_pin) s_models[i].xfer = NULL;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_spi_get_stats(sim_spi_stats_t *stats)
+{
+    pthread_mutex_lock(&s_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
+
+void sim_spi_reset_stats(void)
+{
+    pthread_mutex_lock(&s_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    pthread_mutex_unlock(&s_lock);
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+    (void)dma_chan;
+    if (host_id <= SPI1_HOST || host_id >= SPI_HOST_MAX || bus_config == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_bus[host_id].lock);
+    esp_err_t ret = s_bus[host_id].initialized ? ESP_ERR_INVALID_STATE : ESP_OK;
+    s_bus[host_id].initialized = true;
+    pthread_mutex_unlock(&s_bus[host_id].lock);
+    return ret;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    if (host_id <= SPI1_HOST || host_id >= SPI_HOST_MAX) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&s_bus[host_id].lock);
+    s_bus[host_id].initialized = false;
+    pthread_mutex_unlock(&s_bus[host_id].lock);
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+    if (host_id <= SPI1_HOST || host_id >= SPI_HOST_MAX || dev_config == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dev_config->clock_speed_hz <= 0 || dev_config->queue_size > SIM_SPI_MAX_QUEUE) return ESP_ERR_INVALID_ARG;
+    if (!s_bus[host_id].initialized) return ESP_ERR_INVALID_STATE;
+
+    struct spi_device_t *dev = calloc(1, sizeof(*dev));
+    if (dev == NULL) return ESP_ERR_NO_MEM;
+
+    dev->host = host_id;
+    dev->cfg = *dev_config;
+    if (dev->cfg.queue_size <= 0) dev->cfg.queue_size = 1;
+
+    int cs = dev->cfg.spics_io_num;
+    if (cs >= 0 && cs < SOC_GPIO_PIN_COUNT) {
+        gpio_set_direction(cs, GPIO_MODE_OUTPUT);
+        gpio_set_level(cs, 1);
+    }
+
+    pthread_mutex_lock(&s_lock);
+    if (cs >= 0 && cs < SOC_GPIO_PIN_COUNT) s_cs_owner[cs] = dev;
+    s_stats.devices_added++;
+    pthread_mutex_unlock(&s_lock);
+
+    sim_heap_note(SIM_SPI_DEVICE_BYTES);
+    *handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    if (handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (handle->count) return ESP_ERR_INVALID_STATE;
+
+    pthread_mutex_lock(&s_lock);
+    int cs = handle->cfg.spics_io_num;
+    if (cs >= 0 && cs < SOC_GPIO_PIN_COUNT && s_cs_owner[cs] == handle) s_cs_owner[cs] = NULL;
+    s_stats.devices_removed++;
+    pthread_mutex_unlock(&s_lock);
+
+    sim_heap_note(-SIM_SPI_DEVICE_BYTES);
+    free(handle);
+    return ESP_OK;
+}
+
+// spi_master copies a DMA buffer that is not word-aligned in address and
+// length through one it allocates, on every transaction.
+static void *dma_bounce(const void *buf, size_t len)
+{
+    if ((((uintptr_t)buf | len) & (SIM_SPI_DMA_ALIGN - 1)) == 0) return NULL;
+
+    pthread_mutex_lock(&s_lock);
+    s_stats.dma_bounces++;
+    pthread_mutex_unlock(&s_lock);
+    return heap_caps_aligned_alloc(SIM_SPI_DMA_ALIGN, (len + SIM_SPI_DMA_ALIGN - 1) & ~(SIM_SPI_DMA_ALIGN - 1),
+                                   MALLOC_CAP_DMA);
+}
+
+// Exchanges the data with whichever model sees its CS low and returns the
+// time the bus needs for it. The bus lock is held by the caller.
+static int64_t exchange(spi_device_handle_t dev, spi_transaction_t *t)
+{
+    uint8_t *scratch = s_bus[dev->host].scratch;
+    size_t bits = t->length;
+    size_t len = (bits + 7) / 8;
+    int cs = dev->cfg.spics_io_num;
+    bool auto_cs;
+
+    pthread_mutex_lock(&s_lock);
+    auto_cs = cs >= 0 && cs < SOC_GPIO_PIN_COUNT && s_cs_owner[cs] == dev;
+    pthread_mutex_unlock(&s_lock);
+
+    if (auto_cs) gpio_set_level(cs, 0);
+    if (dev->cfg.pre_cb) dev->cfg.pre_cb(t);
+
+    const uint8_t *tx = (t->flags & SPI_TRANS_USE_TXDATA) ? t->tx_data : t->tx_buffer;
+    uint8_t *rx = (t->flags & SPI_TRANS_USE_RXDATA) ? t->rx_data : t->rx_buffer;
+    void *tx_bounce = NULL, *rx_bounce = NULL;
+    if (!(t->flags & SPI_TRANS_USE_TXDATA) && tx != NULL && (tx_bounce = dma_bounce(tx, len)) != NULL) {
+        memcpy(tx_bounce, tx, len);
+        tx = tx_bounce;
+    }
+    if (!(t->flags & SPI_TRANS_USE_RXDATA) && rx != NULL) rx_bounce = dma_bounce(rx, len);
+    uint8_t *rx_user = rx;
+    if (rx_bounce != NULL) rx = rx_bounce;
+    if (rx == NULL) rx = scratch;
+    if (tx == NULL) {
+        memset(scratch, 0, len);
+        tx = scratch;
+    }
+
+    sim_model_t model = { 0 };
+    int selected = 0;
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < SIM_SPI_MAX_MODELS; i++) {
+        if (s_models[i].xfer && s_models[i].host == (int)dev->host && sim_gpio_get_output(s_models[i].cs_pin) == 0) {
+            model = s_models[i];
+            selected++;
+        }
+    }
+    s_stats.transactions++;
+    s_stats.bytes += len;
+    if (selected != 1) s_stats.no_cs++;
+    pthread_mutex_unlock(&s_lock);
+
+    if (selected == 1) {
+        model.xfer(model.ctx, tx, rx, len, dev->cfg.clock_speed_hz);
+    } else {
+        memset(rx, 0xFF, len);
+    }
+
+    if (rx_bounce != NULL) memcpy(rx_user, rx_bounce, len);
+    heap_caps_free(rx_bounce);
+    heap_caps_free(tx_bounce);
+
+    if (dev->cfg.post_cb) dev->cfg.post_cb(t);
+    if (auto_cs) gpio_set_level(cs, 1);
+
+    return (int64_t)bits * 1000000000LL / dev->cfg.clock_speed_hz + SIM_SPI_SETUP_NS;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    if (handle == NULL || trans_desc == NULL) return ESP_ERR_INVALID_ARG;
+
+    int cancel;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel);
+    sim_bus_t *bus = &s_bus[handle->host];
+
+    pthread_mutex_lock(&bus->lock);
+    wait_until(bus->free_ns);
+    int64_t start = mono_ns();
+    int64_t duration = exchange(handle, trans_desc);
+    bus->free_ns = start + duration;
+    wait_until(bus->free_ns);
+    pthread_mutex_unlock(&bus->lock);
+
+    pthread_setcancelstate(cancel, NULL);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc, TickType_t ticks_to_wait)
+{
+    if (handle == NULL || trans_desc == NULL) return ESP_ERR_INVALID_ARG;
+
+    int64_t deadline = mono_ns() + (int64_t)ticks_to_wait * (1000000000LL / configTICK_RATE_HZ);
+    while (handle->count >= handle->cfg.queue_size) {
+        if (ticks_to_wait != portMAX_DELAY && mono_ns() >= deadline) return ESP_ERR_TIMEOUT;
+        sim_sleep_us(100);
+    }
+
+    int cancel;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel);
+    sim_bus_t *bus = &s_bus[handle->host];
+
+    pthread_mutex_lock(&bus->lock);
+    int64_t now = mono_ns();
+    int64_t start = bus->free_ns > now ? bus->free_ns : now;
+    bus->free_ns = start + exchange(handle, trans_desc);
+
+    int slot = (handle->head + handle->count) % SIM_SPI_MAX_QUEUE;
+    handle->queue[slot] = trans_desc;
+    handle->done_ns[slot] = bus->free_ns;
+    handle->count++;
+    pthread_mutex_unlock(&bus->lock);
+
+    pthread_mutex_lock(&s_lock);
+    s_stats.queued++;
+    pthread_mutex_unlock(&s_lock);
+
+    pthread_setcancelstate(cancel, NULL);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc, TickType_t ticks_to_wait)
+{
+    if (handle == NULL || trans_desc == NULL) return ESP_ERR_INVALID_ARG;
+
+    int64_t deadline = mono_ns() + (int64_t)ticks_to_wait * (1000000000LL / configTICK_RATE_HZ);
+    if (handle->count == 0) {
+        if (ticks_to_wait != portMAX_DELAY) wait_until(deadline);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    int64_t done = handle->done_ns[handle->head];
+    if (ticks_to_wait != portMAX_DELAY && done > deadline) {
+        wait_until(deadline);
+        return ESP_ERR_TIMEOUT;
+    }
+    wait_until(done);
+
+    *trans_desc = handle->queue[handle->head];
+    handle->head = (handle->head + 1) % SIM_SPI_MAX_QUEUE;
+    handle->count--;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    spi_transaction_t *done;
+
+    esp_err_t ret = spi_device_queue_trans(handle, trans_desc, portMAX_DELAY);
+    if (ret != ESP_OK) return ret;
+    return spi_device_get_trans_result(handle, &done, portMAX_DELAY);
+}
@@ -0,0 +1,325 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_cpu.h"
+#include "sim.h"
+
+#define SIM_TIMER_BYTES     64
+#define SIM_BOOT_OFFSET_US  1000000
+// A periodic timer that falls this many periods behind drops the backlog
+// instead of firing it in a burst.
+#define SIM_TIMER_MAX_LAG   5
+
+static int64_t s_base_ns;
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+__attribute__((constructor)) static void time_init(void)
+{
+    s_base_ns = mono_ns();
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return (mono_ns() - s_base_ns) / 1000 + SIM_BOOT_OFFSET_US;
+}
+
+uint32_t sim_cycle_count(void)
+{
+    return (uint32_t)mono_ns();
+}
+
+static uint32_t s_ticks_per_us = 1000;
+static pthread_once_t s_calibrate_once = PTHREAD_ONCE_INIT;
+
+static void calibrate(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    int64_t t0 = mono_ns();
+    uint64_t c0 = __builtin_ia32_rdtsc();
+    while (mono_ns() - t0 < 20000000LL) {
+    }
+    uint64_t c1 = __builtin_ia32_rdtsc();
+    int64_t t1 = mono_ns();
+    s_ticks_per_us = (uint32_t)((c1 - c0) * 1000 / (uint64_t)(t1 - t0));
+    if (s_ticks_per_us == 0) s_ticks_per_us = 1;
+#endif
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    pthread_once(&s_calibrate_once, calibrate);
+    return s_ticks_per_us;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    int64_t end = mono_ns() + (int64_t)us * 1000;
+
+    pthread_testcancel();
+    while (mono_ns() < end) {
+    }
+}
+
+void sim_sleep_us(uint64_t us)
+{
+    struct timespec ts = {
+        .tv_sec = (time_t)(us / 1000000),
+        .tv_nsec = (long)(us % 1000000) * 1000,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) {
+    }
+}
+
+/*
+ * A timer service is one thread walking a list of armed timers in due
+ * order, so callbacks of one service never overlap, as on the esp_timer
+ * task. Callbacks run with the service unlocked; stop and delete from
+ * inside a callback are fine.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_once_t once;
+    pthread_t thread;
+    struct esp_timer *armed;
+    struct esp_timer *running;
+} timer_service_t;
+
+struct esp_timer {
+    timer_service_t *svc;
+    esp_timer_cb_t callback;
+    void *arg;
+    sim_clock_cb_t clock_cb;
+    void *clock_ctx;
+    int64_t due_us;
+    uint64_t period_us;
+    bool is_armed;
+    bool deleted;
+    struct esp_timer *next;
+};
+
+static void *service_main(void *arg);
+
+static timer_service_t s_esp_timers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT,
+};
+static timer_service_t s_device_clock = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT,
+};
+
+static void start_service(timer_service_t *svc)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&svc->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_create(&svc->thread, NULL, service_main, svc);
+    pthread_detach(svc->thread);
+}
+
+static void start_esp_timers(void)
+{
+    start_service(&s_esp_timers);
+}
+
+static void start_device_clock(void)
+{
+    start_service(&s_device_clock);
+}
+
+static void unlink_timer(timer_service_t *svc, struct esp_timer *t)
+{
+    for (struct esp_timer **p = &svc->armed; *p; p = &(*p)->next) {
+        if (*p == t) {
+            *p = t->next;
+            break;
+        }
+    }
+    t->next = NULL;
+    t->is_armed = false;
+}
+
+static void insert_timer(timer_service_t *svc, struct esp_timer *t)
+{
+    struct esp_timer **p = &svc->armed;
+
+    while (*p && (*p)->due_us <= t->due_us) p = &(*p)->next;
+    t->next = *p;
+    *p = t;
+    t->is_armed = true;
+}
+
+static void *service_main(void *arg)
+{
+    timer_service_t *svc = arg;
+
+    pthread_mutex_lock(&svc->lock);
+    while (1) {
+        struct esp_timer *t = svc->armed;
+        if (t == NULL) {
+            pthread_cond_wait(&svc->cond, &svc->lock);
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (t->due_us > now) {
+            int64_t ns = s_base_ns + (t->due_us - SIM_BOOT_OFFSET_US) * 1000;
+            struct timespec ts = { .tv_sec = (time_t)(ns / 1000000000LL), .tv_nsec = (long)(ns % 1000000000LL) };
+            pthread_cond_timedwait(&svc->cond, &svc->lock, &ts);
+            continue;
+        }
+
+        int64_t due = t->due_us;
+        unlink_timer(svc, t);
+        if (t->period_us) {
+            t->due_us += (int64_t)t->period_us;
+            if (now - t->due_us > (int64_t)t->period_us * SIM_TIMER_MAX_LAG) {
+                t->due_us = now + (int64_t)t->period_us;
+            }
+            insert_timer(svc, t);
+        }
+
+        svc->running = t;
+        pthread_mutex_unlock(&svc->lock);
+        if (t->clock_cb) t->clock_cb(t->clock_ctx, due);
+        else t->callback(t->arg);
+        pthread_mutex_lock(&svc->lock);
+        svc->running = NULL;
+
+        if (t->deleted) free(t);
+        pthread_cond_broadcast(&svc->cond);
+    }
+    return NULL;
+}
+
+static struct esp_timer *timer_new(timer_service_t *svc)
+{
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (t) t->svc = svc;
+    return t;
+}
+
+static void timer_arm(struct esp_timer *t, uint64_t timeout_us, uint64_t period_us)
+{
+    timer_service_t *svc = t->svc;
+
+    pthread_mutex_lock(&svc->lock);
+    t->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+    t->period_us = period_us;
+    insert_timer(svc, t);
+    pthread_cond_broadcast(&svc->cond);
+    pthread_mutex_unlock(&svc->lock);
+}
+
+// Waits out a running callback unless called from it.
+static void timer_free(struct esp_timer *t)
+{
+    timer_service_t *svc = t->svc;
+
+    pthread_mutex_lock(&svc->lock);
+    if (t->is_armed) unlink_timer(svc, t);
+    if (svc->running == t && pthread_equal(pthread_self(), svc->thread)) {
+        t->deleted = true;
+        pthread_mutex_unlock(&svc->lock);
+        return;
+    }
+    while (svc->running == t) pthread_cond_wait(&svc->cond, &svc->lock);
+    pthread_mutex_unlock(&svc->lock);
+    free(t);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_once(&s_esp_timers.once, start_esp_timers);
+    struct esp_timer *t = timer_new(&s_esp_timers);
+    if (t == NULL) return ESP_ERR_NO_MEM;
+
+    t->callback = args->callback;
+    t->arg = args->arg;
+    sim_heap_note(SIM_TIMER_BYTES);
+    *out_handle = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (esp_timer_is_active(timer)) return ESP_ERR_INVALID_STATE;
+    timer_arm(timer, timeout_us, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer == NULL || period == 0) return ESP_ERR_INVALID_ARG;
+    if (esp_timer_is_active(timer)) return ESP_ERR_INVALID_STATE;
+    timer_arm(timer, period, period);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+
+    timer_service_t *svc = timer->svc;
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+
+    pthread_mutex_lock(&svc->lock);
+    if (timer->is_armed) {
+        unlink_timer(svc, timer);
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&svc->lock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (esp_timer_is_active(timer)) return ESP_ERR_INVALID_STATE;
+    sim_heap_note(-SIM_TIMER_BYTES);
+    timer_free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    timer_service_t *svc = timer->svc;
+
+    pthread_mutex_lock(&svc->lock);
+    bool armed = timer->is_armed;
+    pthread_mutex_unlock(&svc->lock);
+    return armed;
+}
+
+sim_clock_t *sim_clock_start(uint64_t period_us, sim_clock_cb_t cb, void *ctx)
+{
+    pthread_once(&s_device_clock.once, start_device_clock);
+    struct esp_timer *t = timer_new(&s_device_clock);
+    if (t == NULL) return NULL;
+
+    t->clock_cb = cb;
+    t->clock_ctx = ctx;
+    timer_arm(t, period_us, period_us);
+    return t;
+}
+
+void sim_clock_stop(sim_clock_t *clock)
+{
+    if (clock) timer_free(clock);
+}
@@ -0,0 +1,24 @@
+#ifndef SOC_SOC_H
+#define SOC_SOC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define DR_REG_GPIO_BASE    0x60004000
+
+// Register accesses land in the GPIO simulation; there is no memory behind
+// these addresses on the host.
+void sim_reg_write(uint32_t addr, uint32_t value);
+uint32_t sim_reg_read(uint32_t addr);
+
+#define REG_WRITE(addr, value)  sim_reg_write((uint32_t)(addr), (uint32_t)(value))
+#define REG_READ(addr)          sim_reg_read((uint32_t)(addr))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
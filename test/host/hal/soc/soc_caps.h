@@ -0,0 +1,9 @@
+#ifndef SOC_SOC_CAPS_H
+#define SOC_SOC_CAPS_H
+
+#define SOC_GPIO_PIN_COUNT              49
+#define SOC_DEDICATED_GPIO_SUPPORTED    1
+#define SOC_DEDIC_GPIO_OUT_CHANNELS_NUM 8
+#define SOC_DEDIC_GPIO_IN_CHANNELS_NUM  8
+
+#endif
@@ -0,0 +1,240 @@
+#include <string.h>
+#include <pthread.h>
+#include "sim_hx711.h"
+#include "sim.h"
+#include "esp_timer.h"
+
+#define HX_DATA_BITS        24
+#define HX_MAX_PULSES       27
+#define HX_SETTLE_PERIODS   4
+// Conversions keep a fixed schedule; the clock ticks this many times per
+// period so one due while a frame is being clocked out lands just after it.
+#define HX_TICKS_PER_PERIOD 8
+// A frame left hanging this long is taken as abandoned, and SCK held high
+// this long powers down even mid-frame, gain pulses included. Below it, a
+// stretched pulse inside a frame is counted but not acted on: a host thread
+// can be held off for several milliseconds, far longer than the target ever
+// would hold SCK.
+#define HX_STALL_US         20000
+
+typedef struct {
+    pthread_mutex_t lock;
+    bool attached;
+    int dout;
+    int sck;
+    uint32_t period_us;
+    sim_clock_t *clock;
+
+    int32_t raw;
+    sim_hx711_source_t source;
+    void *source_ctx;
+    bool stalled;
+
+    uint32_t shift;
+    bool ready;
+    int pulses;
+    int sel;
+    int next_sel;
+    bool sck_high;
+    int64_t sck_rise_us;
+    int64_t last_edge_us;
+    bool powered;
+    int64_t next_conv_us;
+    sim_hx711_stats_t stats;
+} sim_hx_t;
+
+static sim_hx_t s_hx[SIM_HX711_MAX] = {
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static void power_down(sim_hx_t *hx)
+{
+    hx->powered = false;
+    hx->ready = false;
+    hx->pulses = 0;
+    hx->stats.powerdowns++;
+    sim_gpio_drive(hx->dout, 1);
+}
+
+static void on_sck(void *ctx, int pin, int level)
+{
+    (void)pin;
+    sim_hx_t *hx = ctx;
+    int64_t now = esp_timer_get_time();
+
+    pthread_mutex_lock(&hx->lock);
+    hx->last_edge_us = now;
+
+    if (level) {
+        hx->sck_high = true;
+        hx->sck_rise_us = now;
+        if (!hx->powered || (hx->pulses == 0 && !hx->ready)) goto out;
+
+        hx->pulses++;
+        if (hx->pulses <= HX_DATA_BITS) {
+            sim_gpio_drive(hx->dout, (int)((hx->shift >> (HX_DATA_BITS - hx->pulses)) & 1));
+        } else if (hx->pulses == HX_DATA_BITS + 1) {
+            hx->ready = false;
+            hx->stats.frames++;
+            sim_gpio_drive(hx->dout, 1);
+        } else if (hx->pulses > HX_MAX_PULSES) {
+            hx->stats.protocol_errors++;
+        }
+    } else {
+        int64_t high_us = now - hx->sck_rise_us;
+        hx->sck_high = false;
+
+        if (!hx->powered) {
+            hx->powered = true;
+            hx->sel = HX_DATA_BITS + 1;
+            hx->next_sel = HX_DATA_BITS + 1;
+            hx->pulses = 0;
+            hx->ready = false;
+            hx->next_conv_us = now + (int64_t)HX_SETTLE_PERIODS * hx->period_us;
+            goto out;
+        }
+
+        if (hx->pulses > 0 && high_us > SIM_HX711_PD_US) hx->stats.long_pulses++;
+        if (hx->pulses > HX_DATA_BITS && hx->pulses <= HX_MAX_PULSES) hx->next_sel = hx->pulses;
+    }
+out:
+    pthread_mutex_unlock(&hx->lock);
+}
+
+static void on_tick(void *ctx, int64_t t_us)
+{
+    sim_hx_t *hx = ctx;
+    int64_t now = esp_timer_get_time();
+
+    pthread_mutex_lock(&hx->lock);
+    if (!hx->attached) goto out;
+
+    bool in_frame = hx->pulses > 0 && hx->pulses <= HX_DATA_BITS;
+    if (hx->powered && hx->sck_high) {
+        int64_t high_us = now - hx->sck_rise_us;
+        if ((hx->pulses == 0 && high_us > SIM_HX711_PD_US) || high_us > HX_STALL_US) {
+            power_down(hx);
+            goto out;
+        }
+    }
+    if (!hx->powered || hx->stalled || now < hx->next_conv_us) goto out;
+
+    if (in_frame) {
+        if (now - hx->last_edge_us < HX_STALL_US) {
+            hx->stats.late_reads++;
+            goto out;
+        }
+        hx->stats.protocol_errors++;
+        hx->pulses = 0;
+    }
+
+    if (hx->pulses > HX_DATA_BITS) {
+        hx->sel = hx->next_sel;
+        hx->stats.last_pulses = (uint8_t)hx->pulses;
+        hx->pulses = 0;
+    } else if (hx->ready) {
+        hx->stats.overruns++;
+    }
+
+    hx->next_conv_us += hx->period_us;
+    if (hx->next_conv_us <= now) hx->next_conv_us = now + hx->period_us;
+
+    int32_t v = hx->source ? hx->source(hx->source_ctx, t_us, hx->sel) : hx->raw;
+    if (v > 0x7FFFFF) v = 0x7FFFFF;
+    if (v < -0x800000) v = -0x800000;
+
+    hx->shift = (uint32_t)v & 0xFFFFFF;
+    hx->ready = true;
+    hx->stats.conversions++;
+    sim_gpio_drive(hx->dout, 0);
+out:
+    pthread_mutex_unlock(&hx->lock);
+}
+
+void sim_hx711_attach(int idx, int dout_pin, int sck_pin, int sps)
+{
+    if (idx < 0 || idx >= SIM_HX711_MAX || sps <= 0) return;
+    sim_hx711_detach(idx);
+
+    sim_hx_t *hx = &s_hx[idx];
+    pthread_mutex_lock(&hx->lock);
+    hx->dout = dout_pin;
+    hx->sck = sck_pin;
+    hx->period_us = 1000000 / (uint32_t)sps;
+    hx->ready = false;
+    hx->pulses = 0;
+    hx->sel = HX_DATA_BITS + 1;
+    hx->next_sel = HX_DATA_BITS + 1;
+    hx->sck_high = sim_gpio_get_output(sck_pin);
+    hx->sck_rise_us = esp_timer_get_time();
+    hx->powered = true;
+    hx->next_conv_us = esp_timer_get_time() + hx->period_us;
+    hx->stalled = false;
+    memset(&hx->stats, 0, sizeof(hx->stats));
+    hx->attached = true;
+    sim_gpio_drive(dout_pin, 1);
+    pthread_mutex_unlock(&hx->lock);
+
+    sim_gpio_listen(sck_pin, on_sck, hx);
+    hx->clock = sim_clock_start(hx->period_us / HX_TICKS_PER_PERIOD, on_tick, hx);
+}
+
+// The clock is stopped with the model unlocked: a tick may be waiting on it.
+void sim_hx711_detach(int idx)
+{
+    if (idx < 0 || idx >= SIM_HX711_MAX) return;
+
+    sim_hx_t *hx = &s_hx[idx];
+    pthread_mutex_lock(&hx->lock);
+    bool attached = hx->attached;
+    sim_clock_t *clock = hx->clock;
+    hx->attached = false;
+    hx->clock = NULL;
+    pthread_mutex_unlock(&hx->lock);
+
+    if (!attached) return;
+    sim_clock_stop(clock);
+    sim_gpio_listen(hx->sck, NULL, NULL);
+}
+
+void sim_hx711_set_raw(int idx, int32_t raw)
+{
+    if (idx < 0 || idx >= SIM_HX711_MAX) return;
+
+    pthread_mutex_lock(&s_hx[idx].lock);
+    s_hx[idx].raw = raw;
+    pthread_mutex_unlock(&s_hx[idx].lock);
+}
+
+void sim_hx711_set_source(int idx, sim_hx711_source_t cb, void *ctx)
+{
+    if (idx < 0 || idx >= SIM_HX711_MAX) return;
+
+    pthread_mutex_lock(&s_hx[idx].lock);
+    s_hx[idx].source = cb;
+    s_hx[idx].source_ctx = ctx;
+    pthread_mutex_unlock(&s_hx[idx].lock);
+}
+
+void sim_hx711_set_stalled(int idx, bool stalled)
+{
+    if (idx < 0 || idx >= SIM_HX711_MAX) return;
+
+    pthread_mutex_lock(&s_hx[idx].lock);
+    s_hx[idx].stalled = stalled;
+    pthread_mutex_unlock(&s_hx[idx].lock);
+}
+
+void sim_hx711_get_stats(int idx, sim_hx711_stats_t *stats)
+{
+    if (idx < 0 || idx >= SIM_HX711_MAX) return;
+
+    pthread_mutex_lock(&s_hx[idx].lock);
+    *stats = s_hx[idx].stats;
+    stats->sel = (uint8_t)s_hx[idx].sel;
+    stats->powered = s_hx[idx].powered;
+    pthread_mutex_unlock(&s_hx[idx].lock);
+}
@@ -0,0 +1,48 @@
+#ifndef SIM_HX711_H
+#define SIM_HX711_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_HX711_MAX       4
+#define SIM_HX711_PD_US     60
+
+/*
+ * HX711 as seen from its two pins. A conversion completes every period and
+ * pulls DOUT low; each SCK rising edge shifts out the next bit, MSB first,
+ * and the 25th sets DOUT high again. The pulse count of a frame (25, 26 or
+ * 27) selects channel A/128, B/32 or A/64 for the conversion after next.
+ * SCK held high past 60 us powers the chip down; the falling edge powers it
+ * back up at A/128 with the output settling for four periods.
+ */
+typedef int32_t (*sim_hx711_source_t)(void *ctx, int64_t t_us, int sel);
+
+typedef struct {
+    uint32_t conversions;
+    uint32_t frames;
+    uint32_t overruns;
+    uint32_t late_reads;
+    uint32_t protocol_errors;
+    uint32_t powerdowns;
+    uint32_t long_pulses;
+    uint8_t last_pulses;
+    uint8_t sel;
+    bool powered;
+} sim_hx711_stats_t;
+
+void sim_hx711_attach(int idx, int dout_pin, int sck_pin, int sps);
+void sim_hx711_detach(int idx);
+void sim_hx711_set_raw(int idx, int32_t raw);
+void sim_hx711_set_source(int idx, sim_hx711_source_t cb, void *ctx);
+void sim_hx711_set_stalled(int idx, bool stalled);
+void sim_hx711_get_stats(int idx, sim_hx711_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
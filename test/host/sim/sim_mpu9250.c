@@ -0,0 +1,415 @@
+#include <string.h>
+#include <pthread.h>
+#include "sim_mpu9250.h"
+#include "sim.h"
+
+#define REG_SMPLRT_DIV      0x19
+#define REG_CONFIG          0x1A
+#define REG_ACCEL_CONFIG_2  0x1D
+#define REG_LP_ACCEL_ODR    0x1E
+#define REG_WOM_THR         0x1F
+#define REG_FIFO_EN         0x23
+#define REG_I2C_SLV0_ADDR   0x25
+#define REG_I2C_SLV0_REG    0x26
+#define REG_I2C_SLV0_CTRL   0x27
+#define REG_INT_ENABLE      0x38
+#define REG_INT_STATUS      0x3A
+#define REG_ACCEL_XOUT_H    0x3B
+#define REG_EXT_SENS_DATA   0x49
+#define REG_I2C_SLV0_DO     0x63
+#define REG_USER_CTRL       0x6A
+#define REG_PWR_MGMT_1      0x6B
+#define REG_FIFO_COUNTH     0x72
+#define REG_FIFO_COUNTL     0x73
+#define REG_FIFO_R_W        0x74
+#define REG_WHO_AM_I        0x75
+
+#define WHO_AM_I_VALUE      0x70
+#define FIFO_SIZE           512
+#define CLOCK_HZ_CONFIG     1000000
+#define INT_PULSE_US        50
+
+#define AK_ADDR             0x0C
+#define AK_WIA_VALUE        0x48
+#define AK_REG_HXL          0x03
+#define AK_REG_ST2          0x09
+#define AK_REG_CNTL1        0x0A
+#define AK_REG_CNTL2        0x0B
+#define AK_REG_ASAX         0x10
+
+typedef struct {
+    pthread_mutex_t lock;
+    bool attached;
+    int host;
+    int cs_pin;
+    int int_pin;
+    sim_clock_t *clock;
+
+    sim_mpu9250_source_t source;
+    void *source_ctx;
+
+    uint8_t reg[128];
+    uint8_t fifo[FIFO_SIZE];
+    uint16_t fifo_head;
+    uint16_t fifo_count;
+    uint32_t tick;
+    int16_t wom_ref[3];
+    bool wom_armed;
+
+    bool mag_present;
+    bool mag_hofl;
+    uint8_t ak_asa[3];
+    uint8_t ak_cntl1;
+    uint8_t ak_data[7];
+
+    sim_mpu9250_stats_t stats;
+} sim_mpu_t;
+
+static sim_mpu_t s_mpu = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void reset_registers(sim_mpu_t *m)
+{
+    memset(m->reg, 0, sizeof(m->reg));
+    m->reg[REG_PWR_MGMT_1] = 0x01;
+    m->reg[REG_WHO_AM_I] = WHO_AM_I_VALUE;
+    m->fifo_head = 0;
+    m->fifo_count = 0;
+    m->wom_armed = false;
+}
+
+static bool is_fast_read_reg(uint8_t reg)
+{
+    return (reg >= REG_INT_STATUS && reg <= REG_EXT_SENS_DATA + 23)
+        || (reg >= REG_FIFO_COUNTH && reg <= REG_FIFO_R_W);
+}
+
+static uint8_t fifo_pop(sim_mpu_t *m)
+{
+    if (m->fifo_count == 0) {
+        m->stats.fifo_underruns++;
+        return 0xFF;
+    }
+    uint8_t b = m->fifo[m->fifo_head];
+    m->fifo_head = (uint16_t)((m->fifo_head + 1) % FIFO_SIZE);
+    m->fifo_count--;
+    return b;
+}
+
+static uint8_t read_reg(sim_mpu_t *m, uint8_t reg)
+{
+    uint8_t v;
+
+    switch (reg) {
+    case REG_FIFO_R_W:
+        return fifo_pop(m);
+    case REG_FIFO_COUNTH:
+        return (uint8_t)(m->fifo_count >> 8);
+    case REG_FIFO_COUNTL:
+        return (uint8_t)m->fifo_count;
+    case REG_INT_STATUS:
+        v = m->reg[REG_INT_STATUS];
+        m->reg[REG_INT_STATUS] = 0;
+        return v;
+    default:
+        return m->reg[reg & 0x7F];
+    }
+}
+
+static void write_reg(sim_mpu_t *m, uint8_t reg, uint8_t v)
+{
+    switch (reg) {
+    case REG_WHO_AM_I:
+    case REG_INT_STATUS:
+    case REG_FIFO_COUNTH:
+    case REG_FIFO_COUNTL:
+        return;
+    case REG_PWR_MGMT_1:
+        if (v & 0x80) {
+            reset_registers(m);
+            return;
+        }
+        break;
+    case REG_USER_CTRL:
+        if (v & 0x04) {
+            m->fifo_head = 0;
+            m->fifo_count = 0;
+            v &= (uint8_t)~0x04;
+        }
+        break;
+    default:
+        break;
+    }
+    m->reg[reg] = v;
+}
+
+static void on_xfer(void *ctx, const uint8_t *tx, uint8_t *rx, size_t len, int clock_hz)
+{
+    sim_mpu_t *m = ctx;
+
+    if (len == 0) return;
+
+    pthread_mutex_lock(&m->lock);
+    uint8_t reg = tx[0] & 0x7F;
+    rx[0] = 0xFF;
+
+    if (tx[0] & 0x80) {
+        m->stats.reads++;
+        if (clock_hz > CLOCK_HZ_CONFIG && !is_fast_read_reg(reg)) m->stats.clock_violations++;
+        for (size_t i = 1; i < len; i++) {
+            rx[i] = read_reg(m, reg);
+            if (reg != REG_FIFO_R_W) reg = (uint8_t)((reg + 1) & 0x7F);
+        }
+    } else {
+        m->stats.writes++;
+        if (clock_hz > CLOCK_HZ_CONFIG) m->stats.clock_violations++;
+        for (size_t i = 1; i < len; i++) {
+            rx[i] = 0xFF;
+            write_reg(m, reg, tx[i]);
+            reg = (uint8_t)((reg + 1) & 0x7F);
+        }
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+// Inverse of the driver's sensitivity adjustment, so a decoded sample comes
+// back as the value the source asked for, give or take a count.
+static int16_t ak_raw(int16_t v, uint8_t asa)
+{
+    int32_t r = (int32_t)v * 256 / (asa + 128);
+    if (r > INT16_MAX) return INT16_MAX;
+    if (r < INT16_MIN) return INT16_MIN;
+    return (int16_t)r;
+}
+
+static void put_le16(uint8_t *p, int16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+static uint8_t ak_read(sim_mpu_t *m, uint8_t reg)
+{
+    if (reg == 0x00) return AK_WIA_VALUE;
+    if (reg >= AK_REG_HXL && reg <= AK_REG_ST2) return m->ak_data[reg - AK_REG_HXL];
+    if (reg == AK_REG_CNTL1) return m->ak_cntl1;
+    if (reg >= AK_REG_ASAX && reg < AK_REG_ASAX + 3) {
+        return (m->ak_cntl1 & 0x0F) == 0x0F ? m->ak_asa[reg - AK_REG_ASAX] : 0x00;
+    }
+    return 0x00;
+}
+
+static void ak_write(sim_mpu_t *m, uint8_t reg, uint8_t v)
+{
+    if (reg == AK_REG_CNTL1) {
+        m->ak_cntl1 = v;
+    } else if (reg == AK_REG_CNTL2 && (v & 0x01)) {
+        m->ak_cntl1 = 0;
+        memset(m->ak_data, 0, sizeof(m->ak_data));
+    }
+}
+
+// Slave 0 runs once per sample, as the I2C master does with WAIT_FOR_ES.
+static void run_slave0(sim_mpu_t *m)
+{
+    uint8_t ctrl = m->reg[REG_I2C_SLV0_CTRL];
+    uint8_t addr = m->reg[REG_I2C_SLV0_ADDR];
+    uint8_t reg = m->reg[REG_I2C_SLV0_REG];
+
+    if (!(m->reg[REG_USER_CTRL] & 0x20) || !(ctrl & 0x80)) return;
+    if (!m->mag_present || (addr & 0x7F) != AK_ADDR) return;
+
+    if (addr & 0x80) {
+        int n = ctrl & 0x0F;
+        for (int i = 0; i < n && REG_EXT_SENS_DATA + i < REG_I2C_SLV0_DO; i++) {
+            m->reg[REG_EXT_SENS_DATA + i] = ak_read(m, (uint8_t)(reg + i));
+        }
+    } else {
+        ak_write(m, reg, m->reg[REG_I2C_SLV0_DO]);
+    }
+}
+
+static void fifo_push(sim_mpu_t *m, const uint8_t *p, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (m->fifo_count == FIFO_SIZE) {
+            if (m->reg[REG_CONFIG] & 0x40) {
+                m->reg[REG_INT_STATUS] |= 0x10;
+                m->stats.fifo_overflows++;
+                return;
+            }
+            m->fifo_head = (uint16_t)((m->fifo_head + 1) % FIFO_SIZE);
+            m->fifo_count--;
+            m->reg[REG_INT_STATUS] |= 0x10;
+            m->stats.fifo_overflows++;
+        }
+        m->fifo[(m->fifo_head + m->fifo_count) % FIFO_SIZE] = p[i];
+        m->fifo_count++;
+    }
+}
+
+static bool sample(sim_mpu_t *m, int64_t t_us)
+{
+    sim_mpu9250_frame_t f = { 0 };
+    uint8_t *r = &m->reg[REG_ACCEL_XOUT_H];
+
+    if (m->source) m->source(m->source_ctx, t_us, &f);
+    for (int i = 0; i < 3; i++) {
+        r[2 * i] = (uint8_t)((uint16_t)f.accel[i] >> 8);
+        r[2 * i + 1] = (uint8_t)f.accel[i];
+        r[8 + 2 * i] = (uint8_t)((uint16_t)f.gyro[i] >> 8);
+        r[8 + 2 * i + 1] = (uint8_t)f.gyro[i];
+    }
+    r[6] = (uint8_t)((uint16_t)f.temp >> 8);
+    r[7] = (uint8_t)f.temp;
+
+    if ((m->ak_cntl1 & 0x0F) == 0x06) {
+        put_le16(&m->ak_data[0], ak_raw(f.mag[1], m->ak_asa[0]));
+        put_le16(&m->ak_data[2], ak_raw(f.mag[0], m->ak_asa[1]));
+        put_le16(&m->ak_data[4], ak_raw((int16_t)-f.mag[2], m->ak_asa[2]));
+        m->ak_data[6] = (uint8_t)(0x10 | (m->mag_hofl ? 0x08 : 0x00));
+    }
+    run_slave0(m);
+    m->stats.samples++;
+
+    if (m->reg[REG_USER_CTRL] & 0x40) {
+        uint8_t en = m->reg[REG_FIFO_EN];
+        if (en & 0x08) fifo_push(m, &r[0], 6);
+        if (en & 0x80) fifo_push(m, &r[6], 2);
+        if (en & 0x70) fifo_push(m, &r[8], 6);
+        if (en & 0x01) fifo_push(m, &m->reg[REG_EXT_SENS_DATA], m->reg[REG_I2C_SLV0_CTRL] & 0x0F);
+    }
+
+    m->reg[REG_INT_STATUS] |= 0x01;
+    return m->reg[REG_INT_ENABLE] & 0x01;
+}
+
+// Low-power cycling: the accel alone wakes at LP_ACCEL_ODR and the motion
+// comparator checks each reading against the one before it.
+static bool cycle_sample(sim_mpu_t *m, int64_t t_us)
+{
+    sim_mpu9250_frame_t f = { 0 };
+    bool hit = false;
+
+    if (!(m->reg[REG_ACCEL_CONFIG_2] & 0x08)) m->stats.lp_misconfig++;
+    if (m->source) m->source(m->source_ctx, t_us, &f);
+    m->stats.samples++;
+
+    int32_t thr = (int32_t)m->reg[REG_WOM_THR] * 4 * 16384 / 1000;
+    if (m->wom_armed) {
+        for (int i = 0; i < 3; i++) {
+            int32_t d = (int32_t)f.accel[i] - m->wom_ref[i];
+            if (d > thr || d < -thr) hit = true;
+        }
+    }
+    memcpy(m->wom_ref, f.accel, sizeof(m->wom_ref));
+    m->wom_armed = true;
+
+    if (!hit || !(m->reg[REG_INT_ENABLE] & 0x40)) return false;
+    m->reg[REG_INT_STATUS] |= 0x40;
+    m->stats.wom_events++;
+    return true;
+}
+
+static void on_tick(void *ctx, int64_t t_us)
+{
+    sim_mpu_t *m = ctx;
+    bool pulse = false;
+    int pin;
+
+    pthread_mutex_lock(&m->lock);
+    if (!m->attached) {
+        pthread_mutex_unlock(&m->lock);
+        return;
+    }
+
+    uint8_t pwr = m->reg[REG_PWR_MGMT_1];
+    m->tick++;
+    if (pwr & 0x40) {
+        m->wom_armed = false;
+    } else if (pwr & 0x20) {
+        uint32_t period_ms = 4096u >> (m->reg[REG_LP_ACCEL_ODR] & 0x0F);
+        if (period_ms == 0) period_ms = 1;
+        if (m->tick % period_ms == 0) pulse = cycle_sample(m, t_us);
+    } else {
+        m->wom_armed = false;
+        if (m->tick % (m->reg[REG_SMPLRT_DIV] + 1u) == 0) pulse = sample(m, t_us);
+    }
+    if (pulse) m->stats.int_pulses++;
+    m->stats.fifo_count = m->fifo_count;
+    pin = m->int_pin;
+    pthread_mutex_unlock(&m->lock);
+
+    // INT is a pulse; it is driven with the model unlocked since the ISR it
+    // raises may read back over SPI.
+    if (pulse && pin >= 0) {
+        sim_gpio_drive(pin, 1);
+        sim_sleep_us(INT_PULSE_US);
+        sim_gpio_drive(pin, 0);
+    }
+}
+
+void sim_mpu9250_attach(int host, int cs_pin, int int_pin)
+{
+    sim_mpu9250_detach();
+
+    pthread_mutex_lock(&s_mpu.lock);
+    s_mpu.host = host;
+    s_mpu.cs_pin = cs_pin;
+    s_mpu.int_pin = int_pin;
+    reset_registers(&s_mpu);
+    s_mpu.tick = 0;
+    s_mpu.ak_cntl1 = 0;
+    memset(s_mpu.ak_data, 0, sizeof(s_mpu.ak_data));
+    memset(&s_mpu.stats, 0, sizeof(s_mpu.stats));
+    s_mpu.attached = true;
+    pthread_mutex_unlock(&s_mpu.lock);
+
+    if (int_pin >= 0) sim_gpio_drive(int_pin, 0);
+    sim_spi_attach(host, cs_pin, on_xfer, &s_mpu);
+    s_mpu.clock = sim_clock_start(1000, on_tick, &s_mpu);
+}
+
+void sim_mpu9250_detach(void)
+{
+    pthread_mutex_lock(&s_mpu.lock);
+    bool attached = s_mpu.attached;
+    sim_clock_t *clock = s_mpu.clock;
+    s_mpu.attached = false;
+    s_mpu.clock = NULL;
+    pthread_mutex_unlock(&s_mpu.lock);
+
+    if (!attached) return;
+    sim_clock_stop(clock);
+    sim_spi_detach(s_mpu.host, s_mpu.cs_pin);
+}
+
+void sim_mpu9250_set_source(sim_mpu9250_source_t cb, void *ctx)
+{
+    pthread_mutex_lock(&s_mpu.lock);
+    s_mpu.source = cb;
+    s_mpu.source_ctx = ctx;
+    pthread_mutex_unlock(&s_mpu.lock);
+}
+
+void sim_mpu9250_set_mag(bool present, const uint8_t asa[3])
+{
+    pthread_mutex_lock(&s_mpu.lock);
+    s_mpu.mag_present = present;
+    if (asa) memcpy(s_mpu.ak_asa, asa, sizeof(s_mpu.ak_asa));
+    pthread_mutex_unlock(&s_mpu.lock);
+}
+
+void sim_mpu9250_set_hofl(bool overflow)
+{
+    pthread_mutex_lock(&s_mpu.lock);
+    s_mpu.mag_hofl = overflow;
+    pthread_mutex_unlock(&s_mpu.lock);
+}
+
+void sim_mpu9250_get_stats(sim_mpu9250_stats_t *stats)
+{
+    pthread_mutex_lock(&s_mpu.lock);
+    *stats = s_mpu.stats;
+    stats->fifo_count = s_mpu.fifo_count;
+    pthread_mutex_unlock(&s_mpu.lock);
+}
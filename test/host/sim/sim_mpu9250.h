@@ -0,0 +1,55 @@
+#ifndef SIM_MPU9250_H
+#define SIM_MPU9250_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * MPU9250 register model on an SPI CS pin, with its AK8963 behind the
+ * internal I2C master. Samples are produced on the 1 kHz internal clock
+ * divided by SMPLRT_DIV and land in the sensor registers, the FIFO (in
+ * register order, stopping when full if CONFIG asks for it) and, through
+ * slave 0, EXT_SENS_DATA. INT pulses on raw data ready or wake-on-motion.
+ * Config registers only accept a 1 MHz clock; clock_violations counts
+ * accesses that would have been garbled on the part.
+ */
+typedef struct {
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t temp;
+    // In the accel frame and sensitivity-adjusted, i.e. what the driver
+    // should decode; the model converts it to AK8963 axes and raw counts.
+    int16_t mag[3];
+} sim_mpu9250_frame_t;
+
+typedef void (*sim_mpu9250_source_t)(void *ctx, int64_t t_us, sim_mpu9250_frame_t *frame);
+
+typedef struct {
+    uint32_t samples;
+    uint32_t fifo_overflows;
+    uint32_t fifo_underruns;
+    uint32_t int_pulses;
+    uint32_t wom_events;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t clock_violations;
+    uint32_t lp_misconfig;
+    uint16_t fifo_count;
+} sim_mpu9250_stats_t;
+
+void sim_mpu9250_attach(int host, int cs_pin, int int_pin);
+void sim_mpu9250_detach(void);
+void sim_mpu9250_set_source(sim_mpu9250_source_t cb, void *ctx);
+void sim_mpu9250_set_mag(bool present, const uint8_t asa[3]);
+void sim_mpu9250_set_hofl(bool overflow);
+void sim_mpu9250_get_stats(sim_mpu9250_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+#include <math.h>
+#include "test_util.h"
+#include "ahrs.h"
+
+/*
+ * The orientation filter on synthetic poses at the IMU rate: gravity alone
+ * must bring roll and pitch to a static tilt, the gyro alone must integrate
+ * a yaw rate, the integral term must soak up a gyro bias, and the mag must
+ * pull yaw to the heading without ever moving roll or pitch.
+ */
+
+#define PERIOD_US       10000
+#define FIELD_H         200.0
+#define FIELD_V         -400.0
+
+typedef struct {
+    double roll, pitch, yaw;
+} pose_t;
+
+static double rad(double deg)
+{
+    return deg * M_PI / 180.0;
+}
+
+// Earth vectors seen by a sensor at roll, pitch and yaw (Z-Y-X): the
+// transpose of Rz(yaw) Ry(pitch) Rx(roll) applied to each.
+static void to_sensor(const pose_t *p, const double e[3], double s[3])
+{
+    double cr = cos(rad(p->roll)), sr = sin(rad(p->roll));
+    double cp = cos(rad(p->pitch)), sp = sin(rad(p->pitch));
+    double cy = cos(rad(p->yaw)), sy = sin(rad(p->yaw));
+    double u[3], v[3];
+
+    u[0] = cy * e[0] + sy * e[1];
+    u[1] = -sy * e[0] + cy * e[1];
+    u[2] = e[2];
+    v[0] = cp * u[0] - sp * u[2];
+    v[1] = u[1];
+    v[2] = sp * u[0] + cp * u[2];
+    s[0] = v[0];
+    s[1] = cr * v[1] + sr * v[2];
+    s[2] = -sr * v[1] + cr * v[2];
+}
+
+static void accel_at(const pose_t *p, int32_t mg[3])
+{
+    static const double up[3] = { 0.0, 0.0, 1000.0 };
+    double s[3];
+
+    to_sensor(p, up, s);
+    for (int i = 0; i < 3; i++) mg[i] = (int32_t)lround(s[i]);
+}
+
+static void mag_at(const pose_t *p, int16_t mag[3])
+{
+    static const double field[3] = { FIELD_H, 0.0, FIELD_V };
+    double s[3];
+
+    to_sensor(p, field, s);
+    for (int i = 0; i < 3; i++) mag[i] = (int16_t)lround(s[i]);
+}
+
+static int32_t wrap_cdeg(int32_t a)
+{
+    while (a > 18000) a -= 36000;
+    while (a <= -18000) a += 36000;
+    return a;
+}
+
+static void run(ahrs_t *f, int64_t *t, int steps, const int32_t gyro[3], const int32_t accel[3],
+                const int16_t *mag)
+{
+    for (int k = 0; k < steps; k++) {
+        *t += PERIOD_US;
+        ahrs_update(f, *t, gyro, accel, mag);
+    }
+}
+
+// The integral winds up while a large initial error settles and takes
+// minutes to unwind, so the settling tests run the proportional path alone.
+static void test_static_tilt(void)
+{
+    static const int32_t still[3] = { 0, 0, 0 };
+    pose_t pose = { .roll = 30.0, .pitch = -20.0 };
+    int32_t accel[3];
+    int16_t euler[3];
+    ahrs_t f;
+    int64_t t = 1;
+
+    ahrs_init(&f, AHRS_KP_Q16, 0);
+    accel_at(&pose, accel);
+    run(&f, &t, 3000, still, accel, NULL);
+
+    ahrs_get_euler(&f, euler);
+    CHECK_NEAR(euler[0], 3000, 50);
+    CHECK_NEAR(euler[1], -2000, 50);
+}
+
+static void test_yaw_rate(void)
+{
+    static const int32_t spin[3] = { 0, 0, 10000 };
+    static const int32_t level[3] = { 0, 0, 1000 };
+    int16_t euler[3];
+    ahrs_t f;
+    int64_t t = 1;
+
+    ahrs_init(&f, AHRS_KP_Q16, AHRS_KI_Q16);
+    run(&f, &t, 900, spin, level, NULL);
+
+    ahrs_get_euler(&f, euler);
+    CHECK_NEAR(euler[2], 9000, 50);
+    CHECK_NEAR(euler[0], 0, 10);
+    CHECK_NEAR(euler[1], 0, 10);
+}
+
+static void test_gyro_bias(void)
+{
+    static const int32_t bias[3] = { 500, -300, 0 };
+    static const int32_t level[3] = { 0, 0, 1000 };
+    int16_t euler[3];
+    ahrs_t f;
+    int64_t t = 1;
+
+    ahrs_init(&f, AHRS_KP_Q16, AHRS_KI_Q16);
+    run(&f, &t, 3000, bias, level, NULL);
+    ahrs_get_euler(&f, euler);
+    int32_t roll_p = euler[0];
+
+    run(&f, &t, 60000, bias, level, NULL);
+    ahrs_get_euler(&f, euler);
+    CHECK(abs(roll_p) > 50);
+    CHECK_NEAR(euler[0], 0, 20);
+    CHECK_NEAR(euler[1], 0, 20);
+}
+
+// Two filters settle from level onto the same tilted pose, one with the
+// mag and one without. The mag is there to turn yaw to the heading; roll
+// and pitch must follow the same path in both.
+static void test_mag_heading_only(void)
+{
+    static const int32_t still[3] = { 0, 0, 0 };
+    pose_t pose = { .roll = 25.0, .pitch = 15.0, .yaw = 60.0 };
+    int32_t accel[3];
+    int16_t mag[3], with[3], without[3];
+    int32_t tilt_diff = 0;
+    ahrs_t fm, fg;
+    int64_t t = 1;
+
+    accel_at(&pose, accel);
+    mag_at(&pose, mag);
+    ahrs_init(&fm, AHRS_KP_Q16, 0);
+    ahrs_init(&fg, AHRS_KP_Q16, 0);
+
+    for (int k = 0; k < 6000; k++) {
+        t += PERIOD_US;
+        ahrs_update(&fm, t, still, accel, mag);
+        ahrs_update(&fg, t, still, accel, NULL);
+        ahrs_get_euler(&fm, with);
+        ahrs_get_euler(&fg, without);
+        for (int i = 0; i < 2; i++) {
+            int32_t d = abs(with[i] - without[i]);
+            if (d > tilt_diff) tilt_diff = d;
+        }
+    }
+    printf("mag: yaw %d cdeg, largest tilt difference %d cdeg\n", with[2], tilt_diff);
+
+    CHECK_NEAR(with[0], 2500, 50);
+    CHECK_NEAR(with[1], 1500, 50);
+    CHECK_NEAR(wrap_cdeg(with[2] - 6000), 0, 100);
+    CHECK(tilt_diff <= 50);
+}
+
+int main(void)
+{
+    test_static_tilt();
+    test_yaw_rate();
+    test_gyro_bias();
+    test_mag_heading_only();
+    return test_exit("test_ahrs");
+}
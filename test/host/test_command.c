@@ -0,0 +1,107 @@
+#include <string.h>
+#include "test_util.h"
+#include "sim.h"
+#include "command.h"
+
+/*
+ * Reassembly of fragmented MQTT payloads in command_feed() and the trip
+ * through the queue to the command task: whole payloads, payloads split
+ * across events, a message abandoned halfway and followed by a new one,
+ * fragments out of sequence, and payloads too long for the arena. Text
+ * frames from the WebSocket go through command_submit() and count in the
+ * same stats.
+ */
+
+static volatile int s_calls;
+static command_t s_last;
+
+static esp_err_t on_scale(const command_t *cmd)
+{
+    s_last = *cmd;
+    __atomic_add_fetch(&s_calls, 1, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+static bool wait_calls(int n)
+{
+    for (int i = 0; i < 200; i++) {
+        if (__atomic_load_n(&s_calls, __ATOMIC_ACQUIRE) >= n) return true;
+        sim_sleep_us(1000);
+    }
+    return false;
+}
+
+// Splits msg at the given cut points and feeds the pieces in order.
+static esp_err_t feed_split(const char *msg, const int *cuts, int ncuts)
+{
+    int total = (int)strlen(msg);
+    int start = 0;
+    esp_err_t ret = ESP_OK;
+
+    for (int i = 0; i <= ncuts; i++) {
+        int end = i < ncuts ? cuts[i] : total;
+        ret = command_feed(msg + start, end - start, start, total);
+        start = end;
+    }
+    return ret;
+}
+
+static void check_scale(int calls, int32_t ch, float scale)
+{
+    CHECK(wait_calls(calls));
+    CHECK_EQ(s_last.id, CMD_SET_SCALE);
+    CHECK_EQ(s_last.argc, 2);
+    CHECK_EQ(s_last.args[0].i, ch);
+    CHECK_NEAR(s_last.args[1].f * 1000, scale * 1000, 1);
+}
+
+int main(void)
+{
+    static const char long_msg[] = "SET_SCALE 3 0.125";
+    static const int cuts[] = { 4, 10, 12 };
+    command_stats_t st;
+    int calls = 0;
+
+    command_register(CMD_SET_SCALE, on_scale);
+    CHECK_EQ(command_start(), ESP_OK);
+
+    CHECK_EQ(command_feed("SET_SCALE 1 431.5", 17, 0, 17), ESP_OK);
+    check_scale(++calls, 1, 431.5f);
+
+    CHECK_EQ(feed_split(long_msg, cuts, 3), ESP_OK);
+    check_scale(++calls, 3, 0.125f);
+
+    // The rest of this one never arrives; the next message starts afresh.
+    CHECK_EQ(command_feed("SET_SCALE 2 9", 9, 0, 13), ESP_OK);
+    CHECK_EQ(feed_split("SET_SCALE 0 2.5", cuts, 2), ESP_OK);
+    check_scale(++calls, 0, 2.5f);
+
+    // A gap in the offsets drops the message without wedging the arena.
+    CHECK_EQ(command_feed("SET_SCALE", 9, 0, 15), ESP_OK);
+    CHECK_EQ(command_feed("2.5", 3, 12, 15), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(feed_split("SET_SCALE 2 7", cuts, 1), ESP_OK);
+    check_scale(++calls, 2, 7.0f);
+
+    char big[CMD_ARENA_SIZE + 16];
+    memset(big, ' ', sizeof(big));
+    CHECK_EQ(command_feed(big, 64, 0, (int)sizeof(big)), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(command_feed(big + 64, 64, 64, (int)sizeof(big)), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(feed_split(long_msg, cuts, 3), ESP_OK);
+    check_scale(++calls, 3, 0.125f);
+
+    CHECK(command_feed("BOGUS 1", 7, 0, 7) != ESP_OK);
+
+    CHECK_EQ(command_submit("SET_SCALE 1 3.0", 15), ESP_OK);
+    check_scale(++calls, 1, 3.0f);
+    CHECK(command_submit("SET_SCALE", 9) != ESP_OK);
+
+    // executed is counted after the handler returns.
+    sim_sleep_us(20000);
+    command_get_stats(&st);
+    CHECK_EQ(st.received, calls + 2);
+    CHECK_EQ(st.parse_errors, 2);
+    CHECK_EQ(st.oversize, 1);
+    CHECK_EQ(st.executed, calls);
+
+    return test_exit("test_command");
+}
@@ -0,0 +1,236 @@
+#include <string.h>
+#include "test_util.h"
+#include "sim.h"
+#include "sim_hx711.h"
+#include "esp_timer.h"
+#include "app_config.h"
+#include "drv_loadcell.h"
+
+/*
+ * drv_loadcell against four HX711 models: 24-bit decode and sign
+ * extension at the range limits, the 25/26/27-pulse gain selection per
+ * cell, on both the GPIO register and dedicated GPIO backends, and the
+ * interrupt-driven acquisition path including power-down.
+ */
+
+static const gpio_num_t s_dout[LC_MAX_CHANNELS] = {
+    FRONT_LEFT_DT_PIN, FRONT_RIGHT_DT_PIN, BACK_LEFT_DT_PIN, BACK_RIGHT_DT_PIN,
+};
+static const gpio_num_t s_sck[LC_MAX_CHANNELS] = {
+    FRONT_LEFT_SCK_PIN, FRONT_RIGHT_SCK_PIN, BACK_LEFT_SCK_PIN, BACK_RIGHT_SCK_PIN,
+};
+
+static loadcell_t s_cells[LC_MAX_CHANNELS];
+static loadcell_t *s_ptrs[LC_MAX_CHANNELS];
+static volatile int32_t s_value[LC_MAX_CHANNELS];
+static volatile bool s_tag_gain;
+
+// In gain mode each conversion reports the pulse count that selected it.
+static int32_t source(void *ctx, int64_t t_us, int sel)
+{
+    int idx = (int)(intptr_t)ctx;
+    return s_tag_gain ? sel * 1000 + idx : s_value[idx];
+}
+
+// The host can stall a thread for longer than the driver's ready window;
+// a read that timed out is retried, as the timeout path has its own test.
+static int32_t read_one(loadcell_t *cell)
+{
+    int32_t raw = LC_ERROR_CODE;
+
+    for (int tries = 0; tries < 3 && raw == LC_ERROR_CODE; tries++) raw = loadcell_read_raw(cell);
+    return raw;
+}
+
+static esp_err_t read_all(int32_t raw[])
+{
+    esp_err_t err = ESP_ERR_TIMEOUT;
+
+    for (int tries = 0; tries < 3 && err == ESP_ERR_TIMEOUT; tries++) {
+        err = loadcell_read_raw_multi(s_ptrs, LC_MAX_CHANNELS, raw);
+    }
+    return err;
+}
+
+static void check_models_clean(void)
+{
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        sim_hx711_stats_t st;
+        sim_hx711_get_stats(ch, &st);
+        CHECK_EQ(st.protocol_errors, 0);
+        CHECK_EQ(st.powerdowns, 0);
+        CHECK(st.powered);
+    }
+}
+
+static void test_decode(void)
+{
+    static const int32_t values[] = {
+        0, 1, -1, 0x7FFFFF, -0x800000, 0x123456, -0x123456, 0x400000, -2,
+    };
+
+    s_tag_gain = false;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        s_value[0] = values[i];
+        // The first frame may hold a conversion made before the change.
+        read_one(&s_cells[0]);
+        CHECK_EQ(read_one(&s_cells[0]), values[i]);
+    }
+
+    // Out of range on the input saturates, as the ADC does.
+    s_value[0] = 0x1000000;
+    read_one(&s_cells[0]);
+    CHECK_EQ(read_one(&s_cells[0]), 0x7FFFFF);
+}
+
+static void test_decode_multi(void)
+{
+    int32_t raw[LC_MAX_CHANNELS];
+
+    s_tag_gain = false;
+    s_value[0] = -0x800000;
+    s_value[1] = 0x7FFFFF;
+    s_value[2] = -12345;
+    s_value[3] = 0x00FF00;
+    CHECK_EQ(read_all(raw), ESP_OK);
+    CHECK_EQ(read_all(raw), ESP_OK);
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) CHECK_EQ(raw[ch], s_value[ch]);
+}
+
+// A gain takes effect on the conversion after the frame that selected it,
+// and each cell drops out of the shared SCK once it has had its own count.
+static void test_gain(void)
+{
+    static const hx711_gain_t gains[] = { HX711_GAIN_A_128, HX711_GAIN_B_32, HX711_GAIN_A_64 };
+    int32_t raw[LC_MAX_CHANNELS];
+
+    s_tag_gain = true;
+    for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+        CHECK_EQ(loadcell_configure(&s_cells[0], gains[g], HX711_SPS_HIGH), ESP_OK);
+        read_one(&s_cells[0]);
+        CHECK_EQ(read_one(&s_cells[0]), gains[g] * 1000);
+
+        sim_hx711_stats_t st;
+        sim_hx711_get_stats(0, &st);
+        CHECK_EQ(st.last_pulses, gains[g]);
+        CHECK_EQ(st.sel, gains[g]);
+    }
+
+    const hx711_gain_t mixed[LC_MAX_CHANNELS] = {
+        HX711_GAIN_A_64, HX711_GAIN_A_128, HX711_GAIN_B_32, HX711_GAIN_A_64,
+    };
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) loadcell_configure(&s_cells[ch], mixed[ch], HX711_SPS_HIGH);
+    read_all(raw);
+    CHECK_EQ(read_all(raw), ESP_OK);
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        sim_hx711_stats_t st;
+        sim_hx711_get_stats(ch, &st);
+        CHECK_EQ(raw[ch], mixed[ch] * 1000 + ch);
+        CHECK_EQ(st.last_pulses, mixed[ch]);
+    }
+
+    CHECK_EQ(loadcell_configure(&s_cells[0], (hx711_gain_t)24, HX711_SPS_HIGH), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(loadcell_configure(&s_cells[0], HX711_GAIN_A_128, 20), ESP_ERR_INVALID_ARG);
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) loadcell_configure(&s_cells[ch], HX711_GAIN_A_128, HX711_SPS_HIGH);
+}
+
+static void test_timeout(void)
+{
+    uint32_t before = s_cells[0].timeouts;
+
+    sim_hx711_set_stalled(0, true);
+    loadcell_read_raw(&s_cells[0]);
+    CHECK_EQ(loadcell_read_raw(&s_cells[0]), LC_ERROR_CODE);
+    CHECK(s_cells[0].timeouts > before);
+    sim_hx711_set_stalled(0, false);
+}
+
+static void run_backend(loadcell_backend_t backend)
+{
+    CHECK_EQ(loadcell_init_backend(s_ptrs, LC_MAX_CHANNELS, backend), ESP_OK);
+    test_decode();
+    test_decode_multi();
+    test_gain();
+    test_timeout();
+    check_models_clean();
+}
+
+static bool receive_all(QueueHandle_t queue, int frames, int64_t last_us[])
+{
+    loadcell_sample_t s;
+
+    for (int n = 0; n < frames * LC_MAX_CHANNELS; n++) {
+        if (xQueueReceive(queue, &s, pdMS_TO_TICKS(200)) != pdTRUE) return false;
+        CHECK(s.channel < LC_MAX_CHANNELS);
+        if (s.channel >= LC_MAX_CHANNELS) continue;
+        CHECK_EQ(s.raw, s_value[s.channel]);
+        CHECK(s.timestamp_us > last_us[s.channel]);
+        CHECK(s.timestamp_us <= esp_timer_get_time());
+        last_us[s.channel] = s.timestamp_us;
+    }
+    return true;
+}
+
+static void test_async(void)
+{
+    QueueHandle_t queue = xQueueCreate(16, sizeof(loadcell_sample_t));
+    int64_t last_us[LC_MAX_CHANNELS] = { 0 };
+
+    s_tag_gain = false;
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) s_value[ch] = -0x400000 + ch * 0x200000;
+
+    CHECK_EQ(loadcell_init_backend(s_ptrs, LC_MAX_CHANNELS, LC_BACKEND_DEDIC_GPIO), ESP_OK);
+    CHECK_EQ(loadcell_start_async(s_ptrs, LC_MAX_CHANNELS, queue), ESP_OK);
+    CHECK_EQ(loadcell_start_async(s_ptrs, LC_MAX_CHANNELS, queue), ESP_ERR_INVALID_STATE);
+
+    // Let a conversion made before the values were set drain out.
+    xQueueReset(queue);
+    sim_sleep_us(30000);
+    xQueueReset(queue);
+    CHECK(receive_all(queue, 10, last_us));
+    CHECK_EQ(loadcell_async_dropped(), 0);
+
+    loadcell_set_power(false);
+    sim_sleep_us(50000);
+    CHECK(!loadcell_is_powered());
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        sim_hx711_stats_t st;
+        sim_hx711_get_stats(ch, &st);
+        CHECK(!st.powered);
+        CHECK_EQ(st.powerdowns, 1);
+    }
+    xQueueReset(queue);
+    loadcell_sample_t s;
+    CHECK(xQueueReceive(queue, &s, pdMS_TO_TICKS(50)) != pdTRUE);
+
+    loadcell_set_power(true);
+    CHECK(receive_all(queue, 3, last_us));
+    CHECK(loadcell_is_powered());
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        sim_hx711_stats_t st;
+        sim_hx711_get_stats(ch, &st);
+        CHECK(st.powered);
+        CHECK_EQ(st.protocol_errors, 0);
+    }
+
+    loadcell_stop_async();
+    vQueueDelete(queue);
+}
+
+int main(void)
+{
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) {
+        sim_hx711_attach(ch, s_dout[ch], s_sck[ch], HX711_SPS_HIGH);
+        sim_hx711_set_source(ch, source, (void *)(intptr_t)ch);
+        CHECK_EQ(loadcell_init(&s_cells[ch], s_dout[ch], s_sck[ch]), ESP_OK);
+        CHECK_EQ(loadcell_configure(&s_cells[ch], HX711_GAIN_A_128, HX711_SPS_HIGH), ESP_OK);
+        s_ptrs[ch] = &s_cells[ch];
+    }
+
+    run_backend(LC_BACKEND_GPIO);
+    run_backend(LC_BACKEND_DEDIC_GPIO);
+    test_async();
+
+    for (int ch = 0; ch < LC_MAX_CHANNELS; ch++) sim_hx711_detach(ch);
+    return test_exit("test_hx711");
+}
@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+#include "sim.h"
+#include "sim_mpu9250.h"
+#include "esp_timer.h"
+#include "app_config.h"
+#include "drv_mpu.h"
+
+/*
+ * Long-running check that the MPU read paths allocate nothing once
+ * mpu_init() has returned: polled bursts, queued reads and FIFO drains run
+ * against the model while the target heap's allocation count, usage and
+ * low-water mark are watched.
+ *
+ *   test_mpu_heap [reads]
+ */
+
+static void source(void *ctx, int64_t t_us, sim_mpu9250_frame_t *f)
+{
+    int16_t n = (int16_t)((t_us / 1000) % 9 - 4);
+
+    f->accel[0] = n;
+    f->accel[1] = 100;
+    f->accel[2] = 16384;
+    f->gyro[0] = 131;
+    f->gyro[2] = n;
+    f->mag[0] = 120;
+    f->mag[1] = -60;
+    f->mag[2] = -350;
+}
+
+static void check_heap_unchanged(const char *phase, const sim_heap_stats_t *before, uint32_t dma_allocs,
+                                 const MPU9250_t *dev)
+{
+    sim_heap_stats_t after;
+    sim_heap_get_stats(&after);
+
+    if (after.allocs != before->allocs || after.in_use != before->in_use || after.peak != before->peak) {
+        fprintf(stderr, "%s: allocs %u -> %u, in_use %zu -> %zu, peak %zu -> %zu\n", phase,
+                before->allocs, after.allocs, before->in_use, after.in_use, before->peak, after.peak);
+    }
+    CHECK_EQ(after.allocs, before->allocs);
+    CHECK_EQ(after.frees, before->frees);
+    CHECK_EQ(after.in_use, before->in_use);
+    CHECK_EQ(after.peak, before->peak);
+    CHECK_EQ(mpu_dma_allocs(dev), dma_allocs);
+}
+
+int main(int argc, char **argv)
+{
+    static MPU9250_t dev;
+    static const uint8_t asa[3] = { 0x80, 0x90, 0x70 };
+    uint32_t reads = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 20000;
+    spi_bus_config_t buscfg = {
+        .miso_io_num = MPU_PIN_NUM_MISO,
+        .mosi_io_num = MPU_PIN_NUM_MOSI,
+        .sclk_io_num = MPU_PIN_NUM_CLK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = MPU_FIFO_BURST_MAX + 1,
+    };
+    sim_heap_stats_t base;
+
+    sim_mpu9250_attach(MPU_SPI_HOST, MPU_PIN_NUM_CS, MPU_PIN_NUM_INT);
+    sim_mpu9250_set_source(source, NULL);
+    sim_mpu9250_set_mag(true, asa);
+
+    CHECK_EQ(spi_bus_initialize(MPU_SPI_HOST, &buscfg, SPI_DMA_CH_AUTO), ESP_OK);
+    CHECK_EQ(mpu_attach(&dev, MPU_SPI_HOST, MPU_PIN_NUM_CS), ESP_OK);
+    CHECK_EQ(mpu_init(&dev), ESP_OK);
+    CHECK(dev.mag_present);
+
+    uint32_t dma_allocs = mpu_dma_allocs(&dev);
+    CHECK_EQ(dma_allocs, 3);
+    sim_heap_get_stats(&base);
+
+    for (uint32_t k = 0; k < reads; k++) {
+        CHECK_EQ(mpu_read_all(&dev), ESP_OK);
+    }
+    CHECK_EQ(dev.accel_raw[1], 100);
+    CHECK_EQ(dev.accel_raw[2], 16384);
+    CHECK_EQ(dev.gyro_mdps[0], 1000);
+    check_heap_unchanged("polled", &base, dma_allocs, &dev);
+
+    for (uint32_t k = 0; k < reads; k++) {
+        CHECK_EQ(mpu_read_async_start(&dev), ESP_OK);
+        if (k & 1) CHECK_EQ(mpu_read_async_start(&dev), ESP_OK);
+        while (dev.async_pending) CHECK_EQ(mpu_read_async_finish(&dev, portMAX_DELAY), ESP_OK);
+    }
+    CHECK_EQ(dev.accel_raw[1], 100);
+    check_heap_unchanged("async", &base, dma_allocs, &dev);
+
+    // The drain task's stack is the FIFO's only allocation, made at start.
+    CHECK_EQ(mpu_fifo_start(&dev, MPU_PIN_NUM_INT), ESP_OK);
+    sim_heap_stats_t fifo_base;
+    sim_heap_get_stats(&fifo_base);
+
+    mpu_sample_t s;
+    uint32_t popped = 0;
+    int64_t end = esp_timer_get_time() + 2000000;
+    while (esp_timer_get_time() < end) {
+        while (mpu_fifo_pop(&dev, &s)) {
+            CHECK_EQ(s.accel[2], 16384);
+            CHECK_EQ(s.gyro[0], 131);
+            popped++;
+        }
+        sim_sleep_us(5000);
+    }
+    CHECK(popped >= 150);
+    CHECK_EQ(dev.fifo_overflows, 0);
+    check_heap_unchanged("fifo", &fifo_base, dma_allocs, &dev);
+    mpu_fifo_stop(&dev);
+
+    // Both clocks stay attached for the life of the driver, and every
+    // transaction reached the part with CS asserted at a clock it accepts,
+    // none needed a bounce buffer and no drain read past the FIFO's bytes.
+    sim_spi_stats_t spi;
+    sim_mpu9250_stats_t model;
+    sim_spi_get_stats(&spi);
+    sim_mpu9250_get_stats(&model);
+    CHECK_EQ(spi.devices_added, 2);
+    CHECK_EQ(spi.devices_removed, 0);
+    CHECK_EQ(spi.no_cs, 0);
+    CHECK_EQ(spi.dma_bounces, 0);
+    CHECK_EQ(model.fifo_underruns, 0);
+    CHECK_EQ(model.clock_violations, 0);
+    CHECK_EQ(sim_gpio_get_output(MPU_PIN_NUM_CS), 1);
+
+    printf("%u polled, %u queued, %u FIFO samples; heap in use %zu, %u allocs\n",
+           reads, reads + reads / 2, popped, base.in_use, base.allocs);
+
+    mpu_deinit(&dev);
+    sim_mpu9250_detach();
+    return test_exit("test_mpu_heap");
+}
@@ -0,0 +1,144 @@
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "test_util.h"
+#include "spsc_ring.h"
+#include "sensor_record.h"
+
+/*
+ * The sample ring between two threads, sized as in main.c. A producer
+ * paced at 1 kHz against a consumer that drains in 10 ms batches must
+ * lose nothing. Unpaced, the producer spins on a full ring instead, which
+ * keeps both sides hammering the indices. Every field of a record is
+ * derived from its sequence number, so a torn copy shows up as a mismatch.
+ */
+
+#define RING_LEN        128
+#define RATE_HZ         1000
+#define DRAIN_PERIOD_MS 10
+
+typedef struct {
+    spsc_ring_t ring;
+    sensor_record_t buf[RING_LEN];
+    uint32_t count;
+    bool paced;
+    volatile bool done;
+    uint32_t popped;
+    uint32_t gaps;
+    uint32_t torn;
+    uint32_t reordered;
+} stress_t;
+
+static void fill(sensor_record_t *rec, uint32_t seq)
+{
+    rec->timestamp_us = (int64_t)seq * (1000000 / RATE_HZ);
+    for (int k = 0; k < SENSOR_RECORD_CHANNELS; k++) rec->weight[k] = (int16_t)(seq * 7u + k);
+    for (int k = 0; k < 3; k++) rec->accel_filtered[k] = (int32_t)(seq * 2654435761u + k);
+}
+
+static bool intact(const sensor_record_t *rec, uint32_t *seq)
+{
+    sensor_record_t want;
+
+    *seq = (uint32_t)(rec->timestamp_us / (1000000 / RATE_HZ));
+    fill(&want, *seq);
+    return memcmp(&want, rec, sizeof(want)) == 0;
+}
+
+static void sleep_until(int64_t t_ns)
+{
+    struct timespec ts = { .tv_sec = t_ns / 1000000000LL, .tv_nsec = t_ns % 1000000000LL };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {}
+}
+
+static void *producer(void *arg)
+{
+    stress_t *s = arg;
+    sensor_record_t rec;
+    int64_t next = test_now_ns();
+
+    for (uint32_t seq = 0; seq < s->count; seq++) {
+        if (s->paced) {
+            next += 1000000000LL / RATE_HZ;
+            sleep_until(next);
+        }
+        fill(&rec, seq);
+        while (!spsc_ring_push(&s->ring, &rec)) {
+            if (s->paced) break;
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&s->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void drain(stress_t *s, uint32_t *expect)
+{
+    sensor_record_t rec;
+    uint32_t seq;
+
+    while (spsc_ring_pop(&s->ring, &rec)) {
+        s->popped++;
+        if (!intact(&rec, &seq)) {
+            s->torn++;
+            continue;
+        }
+        if (seq < *expect) s->reordered++;
+        else if (seq > *expect) s->gaps++;
+        *expect = seq + 1;
+    }
+}
+
+static void *consumer(void *arg)
+{
+    stress_t *s = arg;
+    uint32_t expect = 0;
+
+    while (!__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)) {
+        if (s->paced) {
+            struct timespec ts = { .tv_nsec = DRAIN_PERIOD_MS * 1000000L };
+            nanosleep(&ts, NULL);
+        } else {
+            sched_yield();
+        }
+        drain(s, &expect);
+    }
+    drain(s, &expect);
+    return NULL;
+}
+
+static void run(stress_t *s, uint32_t count, bool paced)
+{
+    pthread_t prod, cons;
+
+    memset(s, 0, sizeof(*s));
+    CHECK(spsc_ring_init(&s->ring, s->buf, sizeof(sensor_record_t), RING_LEN));
+    s->count = count;
+    s->paced = paced;
+
+    pthread_create(&cons, NULL, consumer, s);
+    pthread_create(&prod, NULL, producer, s);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    CHECK_EQ(s->torn, 0);
+    CHECK_EQ(s->reordered, 0);
+    CHECK_EQ(s->gaps, 0);
+    CHECK_EQ(s->popped, count);
+    CHECK_EQ(spsc_ring_count(&s->ring), 0);
+}
+
+int main(int argc, char **argv)
+{
+    static stress_t s;
+    uint32_t seconds = argc > 1 ? (uint32_t)atoi(argv[1]) : 3;
+
+    run(&s, seconds * RATE_HZ, true);
+    CHECK_EQ(s.ring.dropped, 0);
+    printf("paced: %u records, %u dropped\n", s.popped, s.ring.dropped);
+
+    run(&s, 1000000, false);
+    printf("unpaced: %u records, %u full-ring retries\n", s.popped, s.ring.dropped);
+
+    return test_exit("test_spsc");
+}
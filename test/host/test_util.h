@@ -0,0 +1,58 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Shared by the host tests and the bench. A failed CHECK reports and
+ * carries on so one run shows every broken expectation; test_exit() turns
+ * the count into the process status ctest looks at.
+ */
+static int s_test_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        s_test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", \
+                __FILE__, __LINE__, #a, #b, _a, _b); \
+        s_test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b, tol) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (llabs(_a - _b) > (long long)(tol)) { \
+        fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s ~ %s (%lld vs %lld, tol %lld)\n", \
+                __FILE__, __LINE__, #a, #b, _a, _b, (long long)(tol)); \
+        s_test_failures++; \
+    } \
+} while (0)
+
+static inline int test_exit(const char *name)
+{
+    if (s_test_failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, s_test_failures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+static inline int64_t test_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#endif